@@ -28,6 +28,23 @@ FLP_USF_POS  :=   66
 FLP_ELF_POS  :=  322
 FLP_TOC_POS  := 2878
 
+# COMPRESS=1 stores kernel and ramdisk compressed on the floppy image,
+# dasboot decompresses them while loading. Programs booted by dasboot
+# set LZPACK to the packing tool.
+COMPRESS    ?= 0
+ifeq ($(COMPRESS),1)
+RAMDISKOPT   = -z
+endif
+
+# IRQBENCH=1 makes the interrupt stub of libkernel measure the
+# interrupts-off windows and elfexec report the longest one on the
+# serial port, with and without deferred timer work, before it
+# starts the program.
+IRQBENCH    ?= 0
+ifeq ($(IRQBENCH),1)
+ASOPT       += --defsym IRQ_BENCH=1
+endif
+
 
 define update-image
     @if [ ! -f $1 ]; then \
@@ -36,7 +53,12 @@ define update-image
     @echo DD $1
     @if [ -f $(BOOTLOADER) ]; then \
         dd $(DDOPT) if=$(BOOTLOADER) of=$1 ; \
-        dd $(DDOPT) if=$2 of=$1 seek=$3 ; \
+        if [ "$(COMPRESS)" = "1" ] && [ -n "$(LZPACK)" ]; then \
+            $(LZPACK) $2 $2.lz && \
+            dd $(DDOPT) if=$2.lz of=$1 seek=$3 ; \
+        else \
+            dd $(DDOPT) if=$2 of=$1 seek=$3 ; \
+        fi; \
     else \
         echo "Error: file" $(BOOTLOADER) "does not exist" ; \
         rm -f $1 ; \
@@ -9,6 +9,8 @@
         .align  4
 extsec: .word   0
 seccnt: .word   0
+lzsrc:  .long   0                       # address of the compressed stream
+lzsize: .long   0                       # its size, 0 if stored
 
         .section        .text
         .code16
@@ -59,23 +61,36 @@ load_extmem:
         mov     $TOC_ADDR, %esi         # TOC linear address
         movw    $0, loadloc             # TOC segment offset
         movw    $TOC_ADDR>>4, loadloc+2 # TOC segment address
-        pushw   $TOC_SECT
-        call    read_one_sector
-        pushw   $TOC_SECT+1
-        call    read_one_sector
+        pushw   $2                      # number of sectors
+        pushw   $TOC_SECT               # first logical sector
+        call    read_sectors
         cmpl    $0x444d4152, (%esi)     # check 'RAMD'
         jne     .Lend
         cmpl    $0x204b5349, 4(%esi)    # check 'ISK '
         jne     .Lend
         movw    20(%esi), %dx           # read start sector
         movl    12(%esi), %ebx          # read size in bytes
+        mov     $EXT_ADDR, %edi
+
+        #----------------------------------------------------------
+        # a compressed ramdisk (flag 1 at offset 22) is read to the
+        # offset at 28 above its final location and decompressed in
+        # place afterwards, its compressed size is at offset 24
+        #----------------------------------------------------------
+        movl    $0, lzsize
+        testb   $1, 22(%esi)
+        jz      .Lstored
+        movl    24(%esi), %ebx
+        movl    %ebx, lzsize
+        addl    28(%esi), %edi
+        movl    %edi, lzsrc
+.Lstored:
         dec     %ebx                    # and convert size
         shr     $9, %ebx                # into number of sectors
         inc     %ebx
         movw    %bx, extsec
         movw    $0, seccnt
 
-        mov     $EXT_ADDR, %edi
 .Loutloop:
         #----------------------------------------------------------
         # read block of sectors (max 64 kB) into buffer
@@ -88,14 +103,13 @@ load_extmem:
         sub     %cx, %bx                # adjust number of remaing sectors
         addw    %cx, seccnt
         #----------------------------------------------------------
-        # read sectors from floppy disk into buffer one single
-        # sector at a time
+        # read sectors from floppy disk into buffer a track at a
+        # time, the buffer starts at a 64 KiB boundary
         #----------------------------------------------------------
-.Lreadloop:
-        push    %dx                     # put parameter on stack
-        call    read_one_sector
-        inc     %dx
-        loop    .Lreadloop
+        push    %cx                     # number of sectors
+        push    %dx                     # first logical sector
+        call    read_sectors
+        add     %cx, %dx
 
         mov     $BUF_SIZE/4, %ecx
         mov     $BUF_ADDR, %esi
@@ -109,6 +123,12 @@ load_extmem:
 
         cmp     $0, %bx
         ja      .Loutloop
+
+        mov     lzsize, %ecx
+        jecxz   .Lend
+        mov     lzsrc, %esi
+        mov     $EXT_ADDR, %edi
+        call    lz_decode
 .Lend:
         sti
 
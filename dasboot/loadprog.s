@@ -12,18 +12,53 @@ load_prog:
         push    %di
 
         #----------------------------------------------------------
-        # read sectors from floppy disk into memory one single
-        # sector at a time
+        # read the first sector holding the signature
         #----------------------------------------------------------
         les     progloc, %di            # point ES:DI to program location
         mov     %es, %ax
         movw    %ax, loadloc+2
-        pushw   $66                     # put parameter on stack
-        call    read_one_sector
+        pushw   $1                      # number of sectors
+        pushw   $66                     # first logical sector
+        call    read_sectors
+
+        #----------------------------------------------------------
+        # a compressed image starts with a header sector 'DHBZ'
+        # holding the image size (4), the stream size (8) and the
+        # offset above the program location (12) the stream from
+        # sector 67 on is read to, it is decompressed in place
+        #----------------------------------------------------------
+        movb    $0, packed
+        cmpl    $0x5a424844, %es:(%di)  # check signature = 'DHBZ'
+        jne     .Lsig
+        pushal
+        mov     %es:8(%di), %ecx        # stream size
+        mov     %es:12(%di), %esi       # stream offset
+        mov     %es, %ax
+        mov     %esi, %edx
+        shr     $4, %edx
+        add     %dx, %ax
+        movw    %ax, loadloc+2
+        movw    %di, loadloc
+        lea     511(%ecx), %edx         # stream size in sectors
+        shr     $9, %edx
+        push    %dx                     # number of sectors
+        pushw   $67                     # first logical sector
+        call    read_sectors
+
+        movzwl  %di, %edi               # linear program location
+        xor     %eax, %eax
+        mov     %es, %ax
+        shl     $4, %eax
+        add     %eax, %edi
+        add     %edi, %esi
+        call    lz_decode
+        popal
+        movb    $1, packed
 
         #----------------------------------------------------------
         # check for our application signature
         #----------------------------------------------------------
+.Lsig:
         mov     %es:8(%di), %ax         # load segment start address
         cmpw    $0x4844, %es:(%di)      # check signature word 1 = 'DH'
         jne     .Linvsig                #   no, invalid signature
@@ -63,17 +98,17 @@ load_prog:
         and     $0xffffffe0, %edx
         shr     $9, %edx
         #inc     %dx
+        cmpb    $0, packed              # already complete if compressed
+        jne     .Lloaded
 
-        mov     $67, %bx
-.Lreadloop:
-        pushw   $1                      # message length
-        pushw   $dot                    # message offset
-        call    showmsg
-        push    %bx                     # put parameter on stack
-        call    read_one_sector
-        inc     %bx
-        cmp     %dx, %bx
-        jbe     .Lreadloop
+        #----------------------------------------------------------
+        # read the remaining sectors 67 to DX a track at a time
+        #----------------------------------------------------------
+        sub     $66, %dx
+        push    %dx                     # number of sectors
+        pushw   $67                     # first logical sector
+        call    read_sectors
+.Lloaded:
 
         pushw   $crlf_len               # message length
         pushw   $crlf                   # message offset
@@ -98,6 +133,7 @@ load_prog:
         .align      4
 #------------------------------------------------------------------
 progloc:        .word   0x0000, 0x1000          # offset, segment
+packed:         .byte   0                       # image was compressed
 #------------------------------------------------------------------
 ldmsg:          .ascii  "Loading "
                 .equ    ldmsg_len, (.-ldmsg)
@@ -105,6 +141,5 @@ sigmsg:         .ascii  "Signature error"
 crlf:           .ascii  "\r\n\r\n"
                 .equ    crlf_len, (.-crlf)
                 .equ    sigmsg_len, (.-sigmsg)
-dot:            .ascii   "."
 #------------------------------------------------------------------
 
@@ -0,0 +1,92 @@
+
+        .section        .text
+        .code16
+
+#------------------------------------------------------------------
+# lz_decode - decompress an LZ stream in "unreal mode"
+#
+# Parameters:
+#   - ESI   linear address of the compressed stream
+#   - ECX   size of the compressed stream in bytes
+#   - EDI   linear address of the output
+#
+# The stream has the format written by tools/lz.c, a list of
+# sequences made of a token (literal count in the high nibble,
+# match length - 4 in the low nibble, a nibble of 15 continued by
+# bytes up to a byte != 255), the literals and a 16 bit offset of
+# the match. The last sequence only holds literals.
+#
+# All accesses go through DS with 32 bit addresses, DS must have a
+# base of 0 and a 4 GiB limit. The output may overlap the end of
+# the input as long as it never passes the read position, which the
+# packing tools ensure by placing the stream at an offset.
+#------------------------------------------------------------------
+        .type           lz_decode, @function
+        .global         lz_decode
+        .align  8
+lz_decode:
+        pushal
+        lea     (%esi,%ecx), %ebp       # end of the stream
+.Lseq:
+        cmp     %ebp, %esi
+        jae     .Ldone
+        movzbl  (%esi), %edx            # token
+        inc     %esi
+
+        #----------------------------------------------------------
+        # copy the literals
+        #----------------------------------------------------------
+        mov     %edx, %ecx
+        shr     $4, %ecx
+        cmp     $15, %ecx
+        jne     .Llit
+.Llitlen:
+        movzbl  (%esi), %eax
+        inc     %esi
+        add     %eax, %ecx
+        cmp     $255, %eax
+        je      .Llitlen
+.Llit:
+        jecxz   .Llitdone
+.Llitcopy:
+        mov     (%esi), %al
+        mov     %al, (%edi)
+        inc     %esi
+        inc     %edi
+        dec     %ecx
+        jnz     .Llitcopy
+.Llitdone:
+        cmp     %ebp, %esi              # last sequence has no match
+        jae     .Ldone
+
+        #----------------------------------------------------------
+        # copy the match byte by byte, it may overlap the output
+        #----------------------------------------------------------
+        movzwl  (%esi), %ebx            # match offset
+        add     $2, %esi
+        mov     %edx, %ecx
+        and     $15, %ecx
+        cmp     $15, %ecx
+        jne     .Lmatch
+.Lmatchlen:
+        movzbl  (%esi), %eax
+        inc     %esi
+        add     %eax, %ecx
+        cmp     $255, %eax
+        je      .Lmatchlen
+.Lmatch:
+        add     $4, %ecx
+        mov     %edi, %edx
+        sub     %ebx, %edx
+.Lmatchcopy:
+        mov     (%edx), %al
+        mov     %al, (%edi)
+        inc     %edx
+        inc     %edi
+        dec     %ecx
+        jnz     .Lmatchcopy
+        jmp     .Lseq
+.Ldone:
+        popal
+        ret
+
@@ -0,0 +1,163 @@
+
+        .equ    SECTORS_PER_TRACK, 18   # 1.44 MB floppy disk
+        .equ    DMA_SECTORS, 0x10000>>9 # sectors in a 64 KiB DMA page
+
+        .section        .data
+        .align  4
+disk_sectors:   .word   0               # sectors read
+disk_reads:     .word   0               # BIOS read calls
+disk_ticks:     .word   0               # BIOS timer ticks at start
+diskmsg:        .ascii  "    0 sectors,     0 reads,     0 ticks\r\n\r\n"
+                .equ    diskmsg_len, (.-diskmsg)
+dot:            .ascii  "."
+
+        .section        .text
+        .code16
+
+#------------------------------------------------------------------
+# read_sectors - read a run of sectors to loadloc
+#
+# Parameters:
+#   - "logical" sector number   [bp+4]
+#   - number of sectors         [bp+6]
+#
+# The run is split into as few BIOS calls as possible: a call reads
+# up to the end of the track and never crosses a 64 KiB boundary of
+# the buffer, where the floppy DMA would wrap around. The load
+# addresses are multiples of 512, so a sector never straddles such a
+# boundary. Prints one dot per BIOS call.
+#------------------------------------------------------------------
+        .type           read_sectors, @function
+        .global         read_sectors
+        .align  8
+read_sectors:
+        enter   $0, $0
+        pusha
+
+        mov     4(%bp), %bx             # next logical sector
+        mov     6(%bp), %si             # sectors left
+.Lrsloop:
+        test    %si, %si
+        jz      .Lrsdone
+
+        #----------------------------------------------------------
+        # CX = sectors up to the end of the track
+        #----------------------------------------------------------
+        mov     %bx, %ax
+        xor     %dx, %dx
+        mov     $SECTORS_PER_TRACK, %cx
+        div     %cx
+        sub     %dx, %cx
+
+        #----------------------------------------------------------
+        # AX = sectors up to the next 64 KiB boundary, computed from
+        # the low 16 bits of the linear buffer address
+        #----------------------------------------------------------
+        mov     loadloc+2, %ax
+        shl     $4, %ax
+        add     loadloc, %ax
+        neg     %ax
+        jz      .Lrsdma                 # at the boundary, 64 KiB fit
+        shr     $9, %ax
+        jmp     .Lrsmin
+.Lrsdma:
+        mov     $DMA_SECTORS, %ax
+.Lrsmin:
+        cmp     %ax, %cx
+        cmova   %ax, %cx
+        cmp     %si, %cx
+        cmova   %si, %cx
+
+        push    %cx                     # number of sectors
+        push    %bx                     # first logical sector
+        call    read_track
+        add     %cx, disk_sectors
+        incw    disk_reads
+
+        pushw   $1                      # message length
+        pushw   $dot                    # message offset
+        call    showmsg
+
+        add     %cx, %bx
+        sub     %cx, %si
+        jmp     .Lrsloop
+.Lrsdone:
+        popa
+        leave
+        ret     $4
+
+
+#------------------------------------------------------------------
+# disk_stat_start - clear the disk counters and remember the BIOS
+#                   timer tick count
+#------------------------------------------------------------------
+        .type           disk_stat_start, @function
+        .global         disk_stat_start
+        .align  8
+disk_stat_start:
+        pusha
+        xor     %ah, %ah                # read system timer ticks
+        int     $0x1a                   #   into CX:DX
+        mov     %dx, disk_ticks
+        movw    $0, disk_sectors
+        movw    $0, disk_reads
+        popa
+        ret
+
+
+#------------------------------------------------------------------
+# disk_stat_show - print sectors, BIOS read calls and timer ticks
+#                  (55 ms each) since disk_stat_start
+#------------------------------------------------------------------
+        .type           disk_stat_show, @function
+        .global         disk_stat_show
+        .align  8
+disk_stat_show:
+        pusha
+
+        xor     %ah, %ah                # read system timer ticks
+        int     $0x1a                   #   into CX:DX
+        mov     %dx, %ax
+        sub     disk_ticks, %ax
+        lea     diskmsg+32, %di
+        call    .Ldec5
+
+        mov     disk_reads, %ax
+        lea     diskmsg+19, %di
+        call    .Ldec5
+
+        mov     disk_sectors, %ax
+        lea     diskmsg+4, %di
+        call    .Ldec5
+
+        pushw   $diskmsg_len            # message length
+        pushw   $diskmsg                # message offset
+        call    showmsg
+
+        popa
+        ret
+
+        #----------------------------------------------------------
+        # convert AX to decimal digits ending at DI, right-aligned
+        # in a field of five characters
+        #----------------------------------------------------------
+.Ldec5:
+        mov     $5, %cx
+        mov     $10, %bx
+.Ldecloop:
+        xor     %dx, %dx
+        divw    %bx
+        add     $'0', %dl
+        mov     %dl, (%di)
+        dec     %di
+        dec     %cx
+        test    %ax, %ax
+        jnz     .Ldecloop
+.Ldecpad:
+        jcxz    .Ldecdone
+        movb    $' ', (%di)
+        dec     %di
+        dec     %cx
+        jmp     .Ldecpad
+.Ldecdone:
+        ret
@@ -46,6 +46,8 @@
         .code16
         .section        .text
 
+        .include "boottime.inc"
+
         .global _start
 _start:
         #----------------------------------------------------------
@@ -75,6 +77,17 @@ _start:
         mov     %ax, %ds                # with DS register
         mov     %ax, %es                #   also ES register
 
+        #----------------------------------------------------------
+        # start a new boot-timing table (see boottime.inc)
+        #----------------------------------------------------------
+        mov     $BOOT_TIMES, %di
+        mov     $BOOT_TIMES_LEN/2, %cx
+        xor     %ax, %ax
+        cld
+        rep     stosw
+        movl    $BOOT_TIMES_SIG, BOOT_TIMES
+        BOOT_STAMP BT_STAGE0
+
         #----------------------------------------------------------
         # enable external interrupts
         #----------------------------------------------------------
@@ -117,8 +130,9 @@ _start:
         #----------------------------------------------------------
 
         #----------------------------------------------------------
-        # read sectors from floppy disk into memory one single
-        # sector at a time
+        # read stage1 from floppy disk into memory with a single
+        # BIOS call, it follows the boot sector on the first track
+        # (at most 17 sectors)
         #----------------------------------------------------------
         mov     $go_stage1, %dx
         shr     $4, %dx
@@ -130,20 +144,9 @@ _start:
         shr     $9, %dx
         inc     %dx
         mov     %dx, numsec
-        mov     $1, %bx
-.Lreadloop:
-        pushw   $1                      # message length
-        pushw   $dot                    # message offset
-        call    showmsg
-        push    %bx                     # put parameter on stack
-        call    read_one_sector
-        inc     %bx
-        cmp     %dx, %bx
-        jbe     .Lreadloop
-
-        pushw   $2                      # message length
-        pushw   $crlf                   # message offset
-        call    showmsg
+        push    %dx                     # number of sectors
+        pushw   $1                      # first logical sector
+        call    read_track
 
         call    go_stage1
 
@@ -171,6 +174,11 @@ _start:
 #------------------------------------------------------------------
 # Parameters:
 #   - "logical" sector number   [bp+4]
+#   - number of sectors         [bp+6]
+#
+# The sectors must be on the same track and must not cross a 64 KiB
+# boundary of the buffer, see read_sectors. A failed read is retried
+# twice after resetting the controller.
 #------------------------------------------------------------------
 # INT 13,2 - Read Disk Sectors
 #
@@ -204,9 +212,9 @@ _start:
 #
 #------------------------------------------------------------------
         .align  8
-        .type           read_one_sector, @function
-        .global         read_one_sector
-read_one_sector:
+        .type           read_track, @function
+        .global         read_track
+read_track:
         enter   $0, $0
         pusha
         push    %ds
@@ -234,6 +242,8 @@ read_one_sector:
         div     %bx
         mov     %al, track
 
+        mov     $3, %di                 # number of attempts
+.Lretry:
         #----------------------------------------------------------
         # load ES:BX with the start address where the sectors
         # from floppy disk will be loaded to
@@ -241,9 +251,10 @@ read_one_sector:
         les     loadloc, %bx
         #----------------------------------------------------------
         # ah = 0x02 read disk function
-        # al = 0x01 read a single sector
+        # al = number of sectors
         #----------------------------------------------------------
-        mov     $0x0201, %ax
+        mov     6(%bp), %al
+        mov     $0x02, %ah
         #----------------------------------------------------------
         # read sector into cl and track into ch, combine
         # into a single word read
@@ -264,22 +275,32 @@ read_one_sector:
         #----------------------------------------------------------
         int     $0x13
         #----------------------------------------------------------
-        # CF is set in case of an error
+        # CF is set in case of an error, then reset the controller
+        # and try again
         #----------------------------------------------------------
-        jc      .Lrderr                 # error? exit w/message
+        jnc     .Lrdok
+        xor     %ax, %ax                # ah = 0x00 reset disk system
+        xor     %dl, %dl
+        int     $0x13
+        dec     %di
+        jnz     .Lretry
+        jmp     .Lrderr                 # error? exit w/message
+.Lrdok:
 
         #----------------------------------------------------------
         # increment segmented address by sector size (512 bytes)
-        # start address of a segment is a multiple of 16, therefore
-        # increment segment address by 32 (= 512/16)
+        # per sector read. Start address of a segment is a multiple
+        # of 16, therefore increment segment address by 32 (= 512/16)
         #----------------------------------------------------------
-        addw    $0x20, loadloc+2
+        mov     6(%bp), %ax
+        shl     $5, %ax
+        add     %ax, loadloc+2
 
         pop     %es
         pop     %ds
         popa
         leave
-        ret     $2
+        ret     $4
 
 
 #------------------------------------------------------------------
@@ -347,7 +368,6 @@ crlf:   .ascii  "\r\n\r\n"
         .equ    crlf_len, (.-crlf)
         .ascii  "Real-Mode Memory:"
 mbuf:   .ascii  "    ? KB\r\n\r\n"      # size to report
-        .ascii  "Loading stage1 (one dot per sector)\r\n"
+        .ascii  "Loading stage1\r\n\r\n"
         .equ    bootmsg_len, (.-bootmsg)
-dot:    .ascii   "."
 
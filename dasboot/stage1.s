@@ -46,6 +46,8 @@ regIDT: .word   limIDT
         .code16
         .section        .text
 
+        .include "boottime.inc"
+
         .align  8
         .global go_stage1
 go_stage1:
@@ -53,6 +55,7 @@ go_stage1:
         pusha
         push    %ds
         push    %es
+        BOOT_STAMP BT_STAGE1
 
         #----------------------------------------------------------
         # preserve the caller's stack-address (for a return later)
@@ -74,6 +77,8 @@ go_stage1:
         mov     $memsizes, %di
         call    check_memory_avail
 
+        call    disk_stat_start
+        BOOT_STAMP BT_EXTMEM
         call    load_extmem
 
         push    $cmos_rtc_reg
@@ -83,7 +88,9 @@ go_stage1:
         pushw   $cmos_rtc_str            # message offset
         call    showmsg
 
+        BOOT_STAMP BT_LOADPROG
         call    load_prog
+        call    disk_stat_show
         test    %ax, %ax
         jz      retloc
 
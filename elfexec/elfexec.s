@@ -22,6 +22,12 @@
 # our 'Segment-Not-Present' fault-handler gets executed, as
 # a result of the initial attempt to transfer out to ring3.
 #
+# The fault-handler only records the loadable segments and
+# enables paging with their pages marked 'Not Present'. Each
+# page is filled from the ELF file-image (or zeroed for BSS)
+# by our 'Page-Fault' handler when it is touched the first
+# time, so only pages the program actually uses get loaded.
+#
 # $Id: elfexec.s,v 1.4 2014/03/25 00:18:23 ralf Exp ralf $
 #
 #-----------------------------------------------------------------
@@ -78,6 +84,31 @@
         .equ    IRQ_KBD_ID,     0x01
         .equ    ISR_DBG_ID,     0x01
         .equ    ISR_SNP_ID,     0x0B
+        .equ    ISR_PGF_ID,     0x0E
+
+        #----------------------------------------------------------
+        # equates for demand paging
+        #----------------------------------------------------------
+        .equ    PAGE_SIZE,    0x1000    # size of a page
+        .equ    PG_PRESENT,   0x001     # page table entry flags
+        .equ    PG_WRITE,     0x002
+        .equ    PG_USER,      0x004
+        .equ    PF_PRESENT,   0x001     # error code: page was present
+        .equ    CR0_PG,       31        # paging enable bit
+        .equ    PRIVDS_BASE,  0x00020000 # linear address of privDS
+        .equ    PG_DIR,       0x00200000 # physical addr of page directory
+        .equ    PG_TAB,       0x00201000 # physical addr of page tables
+        .equ    PG_TAB_NUM,   5         # low memory + ELF segments
+        .equ    ELF_REGION_MAX, 8       # max number of loadable segments
+
+        #----------------------------------------------------------
+        # offsets in record of loadable segment
+        #----------------------------------------------------------
+        .equ    r_vaddr,        0x00    # start address in memory
+        .equ    r_memsz,        0x04    # size in memory
+        .equ    r_offset,       0x08    # offset in file
+        .equ    r_filesz,       0x0C    # size in file (rest is zeroed)
+        .equ    REGION_SIZE,    0x10
 
 
 #==================================================================
@@ -155,6 +186,11 @@ dr7sav: .space  4                       # DR7 copy
 #------------------------------------------------------------------
         .align  4
 inscnt: .space  8
+#------------------------------------------------------------------
+        .align  4
+elf_region_num: .long 0                 # count of recorded segments
+elf_regions:    .space ELF_REGION_MAX*REGION_SIZE, 0
+pg_tab_used:    .long 0                 # count of used page tables
 #------------------------------------------------------------------
 
 #==================================================================
@@ -163,6 +199,7 @@ inscnt: .space  8
         .section        .text
         .code32
 #------------------------------------------------------------------
+        .extern ramfs_exec
         .type   main, @function
         .global main
 main:
@@ -182,6 +219,7 @@ main:
         INSTALL_IRQ IRQ_KBD_ID, irqKBD
         INSTALL_ISR ISR_DBG_ID, isrDBG
         INSTALL_ISR ISR_SNP_ID, isrSNP
+        INSTALL_ISR ISR_PGF_ID, isrPGF
 
         #----------------------------------------------------------
         # reprogram PICs and enable hardware interrupts
@@ -189,6 +227,50 @@ main:
         call    remap_isr_pm
         sti
 
+.ifdef IRQ_BENCH
+        #----------------------------------------------------------
+        # interrupt-latency benchmark: report the longest
+        # interrupts-off window over BENCH_TICKS timer ticks with
+        # the status line updated by irqPIT itself and by its
+        # bottom half
+        #----------------------------------------------------------
+        mov     $sel_bs, %ax
+        mov     %ax, %fs
+        xor     %esi, %esi              # pit_defer 0, then 1
+.Lbenchmode:
+        mov     %esi, pit_defer
+        movl    $0, irqoff_max
+        mov     %fs:N_TICKS, %ebx
+.Lbenchwait:
+        hlt                             # wait for the next interrupt
+        mov     %fs:N_TICKS, %eax
+        sub     %ebx, %eax
+        cmp     $BENCH_TICKS, %eax
+        jb      .Lbenchwait
+        pushl   bench_names(,%esi,4)
+        call    irqoff_report
+        add     $4, %esp
+        inc     %esi
+        cmp     $2, %esi
+        jb      .Lbenchmode
+.endif
+
+        #----------------------------------------------------------
+        # run the program named progfile if the ramdisk has a
+        # directory, otherwise its first file: the file-image
+        # segment is based at the program's extent
+        #----------------------------------------------------------
+        pushl   $progfile
+        call    ramfs_exec
+        add     $4, %esp
+        test    %eax, %eax
+        jz      .Lelfcheck
+        mov     %ax, theGDT+sel_extmem+2 # base address 15..0
+        shr     $16, %eax
+        mov     %al, theGDT+sel_extmem+4 # base address 23..16
+        mov     %ah, theGDT+sel_extmem+7 # base address 31..24
+.Lelfcheck:
+
         #----------------------------------------------------------
         # verify ELF file's presence and 32-bit 'executable'.
         # address the elf headers using the FS segment register
@@ -310,6 +392,11 @@ finmsg: .ascii  "\r\n\r\nProgram finished. "
 elferrmsg:
         .ascii  "\r\nERROR: Cannot load ELF image.\r\n"
         .equ    elferrmsglen, (.-elferrmsg)
+pgferrmsg:
+        .ascii  "\r\nERROR: Page fault outside of ELF image.\r\n"
+        .equ    pgferrmsglen, (.-pgferrmsg)
+progfile:
+        .asciz  "demoapp"               # program run from the ramdisk
 #------------------------------------------------------------------
         .section        .text
         .code32
@@ -406,42 +493,72 @@ isrSNP:
         enter   $0, $0
 
         #-----------------------------------------------------------
-        # setup segment-registers for 'loading' program-segments
+        # build page directory with identity mapped low memory
+        #-----------------------------------------------------------
+        call    pg_init
+
+        #-----------------------------------------------------------
+        # address the ELF file-image with the FS register
         #-----------------------------------------------------------
         mov     $sel_extmem, %ax        # address ELF file-image
-        mov     %ax, %ds                #    with DS register
-        mov     $userDS, %ax            # address entire memory
-        mov     %ax, %es                #    with ES register
-        cld                             # do forward processing
+        mov     %ax, %fs                #    with FS register
 
         #-----------------------------------------------------------
         # extract load-information from the ELF-file's image
         #-----------------------------------------------------------
-        mov     e_phoff, %ebx           # segment-table's offset
-        movzxw  e_phnum, %ecx           # count of table entries
-        movzxw  e_phentsize, %edx       # length of table entries
+        mov     %fs:e_phoff, %ebx       # segment-table's offset
+        movzxw  %fs:e_phnum, %ecx       # count of table entries
+        movzxw  %fs:e_phentsize, %edx   # length of table entries
+        lea     elf_regions, %edi       # first segment record
+        jecxz   .Lpaging                # no segments at all
 
 .Lnxseg:
+        cmpl    $PT_LOAD, %fs:p_type(%ebx) # segment-type 'LOADABLE'?
+        jne     .Lnxrec                 # no, loading isn't needed
+        cmpl    $ELF_REGION_MAX, elf_region_num # space left?
+        jae     .Lsnperr                # no, handle elf error
+
+        #-----------------------------------------------------------
+        # record program-segment instead of 'loading' it
+        #-----------------------------------------------------------
+        mov     %fs:p_paddr(%ebx), %eax # desired address
+        mov     %eax, r_vaddr(%edi)
+        mov     %fs:p_memsz(%ebx), %eax # segment-size in memory
+        mov     %eax, r_memsz(%edi)
+        mov     %fs:p_offset(%ebx), %eax # segment-source
+        mov     %eax, r_offset(%edi)
+        mov     %fs:p_filesz(%ebx), %eax # length for copying
+        mov     %eax, r_filesz(%edi)
+        incl    elf_region_num
+
+        #-----------------------------------------------------------
+        # mark its pages as 'not present'
+        #-----------------------------------------------------------
+        push    %ebx                    # save record pointer
         push    %ecx                    # save outer loop-counter
-        mov     p_type(%ebx), %eax      # get program-segment type
-        cmp     $PT_LOAD, %eax          # segment-type 'LOADABLE'?
-        jne     .Lfillx                 # no, loading isn't needed
-        mov     p_offset(%ebx), %esi    # DS:ESI is segment-source
-        mov     p_paddr(%ebx), %edi     # ES:EDI is desired address
-        mov     p_filesz(%ebx), %ecx    # ECX is length for copying
-        jecxz   .Lcopyx                 # maybe copying is skipped
-        rep     movsb                   # 'load' program-segment
-.Lcopyx:
-        mov     p_memsz(%ebx), %ecx     # segment-size in memory
-        sub     p_filesz(%ebx), %ecx    # minus its size in file
-        jecxz   .Lfillx                 # maybe fill is unneeded
-        xor     %al, %al                # use zero for filling
-        rep     stosb                   # clear leftover space
-.Lfillx:
+        mov     r_vaddr(%edi), %ebx     # start of segment
+        mov     r_memsz(%edi), %ecx     # length of segment
+        call    pg_lazy
         pop     %ecx                    # recover outer counter
+        pop     %ebx                    # recover record pointer
+        test    %eax, %eax              # no page table left?
+        jnz     .Lsnperr                #   yes, handle elf error
+        add     $REGION_SIZE, %edi      # next segment record
+
+.Lnxrec:
         add     %edx, %ebx              # advance to next record
         loop    .Lnxseg                 # process another record
 
+        #-----------------------------------------------------------
+        # enable paging
+        #-----------------------------------------------------------
+.Lpaging:
+        mov     $PG_DIR, %eax           # load page directory
+        mov     %eax, %cr3
+        mov     %cr0, %eax              # enable paging
+        bts     $CR0_PG, %eax
+        mov     %eax, %cr0
+
         #-----------------------------------------------------------
         # now mark segment-descriptor as 'present'
         #-----------------------------------------------------------
@@ -456,6 +573,298 @@ isrSNP:
         leave
         ret
 
+.Lsnperr:
+        #-----------------------------------------------------------
+        # print error message and terminate
+        #-----------------------------------------------------------
+        lea     elferrmsg, %esi
+        mov     $elferrmsglen, %ecx
+        call    screen_write
+        jmp     bail_out
+
+
+#------------------------------------------------------------------
+# Builds the page directory with the first 4 MiB identity mapped
+# (kernel, file-image, stack and page tables), paging is enabled
+# later by isrSNP
+#------------------------------------------------------------------
+        .type   pg_init, @function
+        .align   8
+pg_init:
+        push    %es
+        mov     %ds, %ax                # address page tables
+        mov     %ax, %es                #    with ES register
+        cld                             # do forward processing
+
+        #-----------------------------------------------------------
+        # clear page directory
+        #-----------------------------------------------------------
+        mov     $PG_DIR-PRIVDS_BASE, %edi
+        mov     $PAGE_SIZE/4, %ecx
+        xor     %eax, %eax
+        rep     stosl
+
+        #-----------------------------------------------------------
+        # identity map of low memory
+        #-----------------------------------------------------------
+        mov     $PG_TAB-PRIVDS_BASE, %edi
+        mov     $PAGE_SIZE/4, %ecx
+        mov     $PG_USER|PG_WRITE|PG_PRESENT, %eax
+.Lpginit:
+        stosl                           # store entry
+        add     $PAGE_SIZE, %eax        # next frame
+        loop    .Lpginit
+        movl    $PG_TAB|PG_USER|PG_WRITE|PG_PRESENT, PG_DIR-PRIVDS_BASE
+        movl    $1, pg_tab_used
+
+        pop     %es
+        ret
+
+
+#------------------------------------------------------------------
+# Marks the pages of a region as 'not present'
+#
+# EBX = start address of region
+# ECX = length of region
+# EAX = 0 on success, -1 if no page table is left
+#------------------------------------------------------------------
+        .type   pg_lazy, @function
+        .align   8
+pg_lazy:
+        push    %ebx
+        push    %edx
+        lea     (%ebx, %ecx), %edx      # end of region
+        and     $~(PAGE_SIZE-1), %ebx   # first page of region
+.Lpglazy:
+        cmp     %edx, %ebx              # end of region reached?
+        jae     .Lpglazyx               #   yes
+        call    pg_entry                # get page table entry
+        test    %eax, %eax
+        jz      .Lpglazyerr             # no page table left
+        movl    $0, (%eax)              # filled on first touch
+        add     $PAGE_SIZE, %ebx        # next page
+        jmp     .Lpglazy
+.Lpglazyerr:
+        mov     $-1, %eax
+        jmp     .Lpglazyret
+.Lpglazyx:
+        xor     %eax, %eax
+.Lpglazyret:
+        pop     %edx
+        pop     %ebx
+        ret
+
+
+#------------------------------------------------------------------
+# Returns the page table entry of a linear address, a new page
+# table is set up if necessary
+#
+# EBX = linear address
+# EAX = privDS offset of page table entry, 0 if no page table is left
+#------------------------------------------------------------------
+        .type   pg_entry, @function
+        .align   8
+pg_entry:
+        push    %ecx
+        push    %esi
+        push    %edi
+        push    %es
+
+        #-----------------------------------------------------------
+        # load page directory entry
+        #-----------------------------------------------------------
+        mov     %ebx, %eax
+        shr     $22, %eax               # page directory index
+        lea     PG_DIR-PRIVDS_BASE(,%eax,4), %esi
+        testl   $PG_PRESENT, (%esi)     # page table present?
+        jnz     .Lpgentry               #   yes
+
+        #-----------------------------------------------------------
+        # set up new page table with all pages 'not present'
+        #-----------------------------------------------------------
+        mov     pg_tab_used, %eax
+        cmp     $PG_TAB_NUM, %eax       # page table left?
+        jae     .Lpgentryerr            #   no
+        incl    pg_tab_used
+        shl     $12, %eax               # offset of page table
+        add     $PG_TAB, %eax           # physical address
+        lea     -PRIVDS_BASE(%eax), %edi
+        or      $PG_USER|PG_WRITE|PG_PRESENT, %eax
+        mov     %eax, (%esi)            # store page directory entry
+        mov     %ds, %ax                # address page table
+        mov     %ax, %es                #    with ES register
+        mov     $PAGE_SIZE/4, %ecx
+        xor     %eax, %eax
+        cld
+        rep     stosl                   # clear page table
+
+        #-----------------------------------------------------------
+        # load page table entry
+        #-----------------------------------------------------------
+.Lpgentry:
+        mov     (%esi), %eax
+        and     $~(PAGE_SIZE-1), %eax   # page table
+        sub     $PRIVDS_BASE, %eax      # physical to privDS offset
+        mov     %ebx, %ecx
+        shr     $12, %ecx               # page number
+        and     $0x3FF, %ecx            # page table index
+        lea     (%eax, %ecx, 4), %eax
+        jmp     .Lpgentryx
+.Lpgentryerr:
+        xor     %eax, %eax
+.Lpgentryx:
+        pop     %es
+        pop     %edi
+        pop     %esi
+        pop     %ecx
+        ret
+
+
+#------------------------------------------------------------------
+# Write-protects the pages of a region for ring3, used by the mmap
+# system call which maps ramdisk files in place (the ramdisk lies in
+# the identity mapped low memory)
+#
+# EBX = start address of region
+# ECX = length of region
+# EAX = 0 on success, -1 if a page is not present
+#------------------------------------------------------------------
+        .type   pg_readonly, @function
+        .global pg_readonly
+        .align   8
+pg_readonly:
+        push    %ebx
+        push    %edx
+        lea     (%ebx, %ecx), %edx      # end of region
+        and     $~(PAGE_SIZE-1), %ebx   # first page of region
+.Lpgro:
+        cmp     %edx, %ebx              # end of region reached?
+        jae     .Lpgrox                 #   yes
+        call    pg_entry                # get page table entry
+        test    %eax, %eax
+        jz      .Lpgroerr               # no page table left
+        testl   $PG_PRESENT, (%eax)     # page mapped?
+        jz      .Lpgroerr               #   no
+        andl    $~PG_WRITE, (%eax)      # read-only for ring3
+        add     $PAGE_SIZE, %ebx        # next page
+        jmp     .Lpgro
+.Lpgroerr:
+        mov     $-1, %eax
+        jmp     .Lpgroret
+.Lpgrox:
+        xor     %eax, %eax
+.Lpgroret:
+        mov     %cr3, %edx              # flush the TLB, INVLPG would
+        mov     %edx, %cr3              #   need a flat data segment
+        pop     %edx
+        pop     %ebx
+        ret
+
+
+#==================================================================
+#===============  TRAP-HANDLER FOR PAGE FAULTS  ===================
+#==================================================================
+#
+# Stack frame layout see isrSNP, CR2 holds the faulting address.
+# The page is mapped to the frame at the same physical address,
+# cleared and filled with the file data of all segments sharing
+# it. Entries which are not present are never cached by the TLB,
+# so there is nothing to invalidate.
+#
+#-----------------------------------------------------------------
+        .section        .text
+        .code32
+        .type   isrPGF, @function
+        .global isrPGF
+        .align   16
+isrPGF:
+        #-----------------------------------------------------------
+        # setup stack frame access via ebp
+        #-----------------------------------------------------------
+        enter   $0, $0
+
+        #-----------------------------------------------------------
+        # find the segment of the faulting address
+        #-----------------------------------------------------------
+        mov     8(%ebp), %edx           # read ISR stack frame ptr
+        testl   $PF_PRESENT, 52(%edx)   # protection violation?
+        jnz     .Lpgferr                #   yes, not a lazy page
+        mov     %cr2, %ebx              # faulting address
+        lea     elf_regions, %esi       # first segment record
+        mov     elf_region_num, %ecx    # count of records
+        jecxz   .Lpgferr
+.Lpgfseg:
+        mov     %ebx, %eax
+        sub     r_vaddr(%esi), %eax     # offset in segment
+        cmp     r_memsz(%esi), %eax     # inside segment?
+        jb      .Lpgfmap                #   yes
+        add     $REGION_SIZE, %esi      # next segment record
+        loop    .Lpgfseg
+        jmp     .Lpgferr                # not part of the ELF image
+
+        #-----------------------------------------------------------
+        # map and clear page
+        #-----------------------------------------------------------
+.Lpgfmap:
+        and     $~(PAGE_SIZE-1), %ebx   # page of faulting address
+        call    pg_entry                # get page table entry
+        test    %eax, %eax
+        jz      .Lpgferr
+        mov     %ebx, %edx              # identity mapping
+        or      $PG_USER|PG_WRITE|PG_PRESENT, %edx
+        mov     %edx, (%eax)            # store page table entry
+        mov     $userDS, %ax            # address entire memory
+        mov     %ax, %es                #    with ES register
+        mov     %ebx, %edi              # ES:EDI is page
+        mov     $PAGE_SIZE/4, %ecx
+        xor     %eax, %eax              # use zero for filling
+        cld                             # do forward processing
+        rep     stosl                   # clear page (BSS)
+
+        #-----------------------------------------------------------
+        # 'load' file data of all segments sharing the page
+        #-----------------------------------------------------------
+        mov     $sel_extmem, %ax        # address ELF file-image
+        mov     %ax, %fs                #    with FS register
+        lea     elf_regions, %edx       # first segment record
+        mov     elf_region_num, %ecx    # count of records
+.Lpgfcopy:
+        push    %ecx                    # save loop-counter
+        mov     r_vaddr(%edx), %edi     # start of file data
+        mov     %edi, %ecx
+        add     r_filesz(%edx), %ecx    # end of file data
+        lea     PAGE_SIZE(%ebx), %eax   # end of page
+        cmp     %eax, %ecx              # file data ends in page?
+        jbe     .Lpgfend                #   yes
+        mov     %eax, %ecx              #   no, copy till end of page
+.Lpgfend:
+        cmp     %ebx, %edi              # file data starts in page?
+        jae     .Lpgfstart              #   yes
+        mov     %ebx, %edi              #   no, copy from start of page
+.Lpgfstart:
+        sub     %edi, %ecx              # length for copying
+        jbe     .Lpgfnext               # no file data in page
+        mov     %edi, %esi
+        sub     r_vaddr(%edx), %esi     # offset in segment
+        add     r_offset(%edx), %esi    # FS:ESI is segment-source
+        rep     movsb %fs:(%esi), %es:(%edi) # 'load' part of segment
+.Lpgfnext:
+        pop     %ecx                    # recover loop-counter
+        add     $REGION_SIZE, %edx      # next segment record
+        loop    .Lpgfcopy
+
+        leave
+        ret                             # retry faulting instruction
+
+.Lpgferr:
+        #-----------------------------------------------------------
+        # print error message and terminate
+        #-----------------------------------------------------------
+        lea     pgferrmsg, %esi
+        mov     $pgferrmsglen, %ecx
+        call    screen_write
+        jmp     bail_out
+
 
 #==================================================================
 #===========  TRAP-HANDLER FOR SINGLE-STEP EXCEPTIONS  ============
@@ -775,6 +1184,14 @@ scnnum: .ascii  "  "
 prevticks: .long   0
 scnid:     .byte   0
 prevscnid: .byte   0
+pit_defer: .long   1                    # 0: update status in irqPIT
+.ifdef IRQ_BENCH
+        .equ    BENCH_TICKS, 182        # about 10 seconds
+bench_names:
+        .long   bench_inline, bench_deferred
+bench_inline:   .asciz  "inline"
+bench_deferred: .asciz  "deferred"
+.endif
 #-----------------------------------------------------------------
         .section        .text
         .code32
@@ -787,7 +1204,6 @@ irqPIT:
         #-----------------------------------------------------------
         enter   $0, $0
         pushl   %fs
-        pushl   %es
 
         #----------------------------------------------------------
         # setup access to BIOS data area using the FS segment
@@ -805,6 +1221,39 @@ irqPIT:
         movb    $1, %fs:TM_OVFL         # and set rollover flag
 .Lisok:
 
+        #-----------------------------------------------------------
+        # the status line is updated by the bottom half with
+        # interrupts enabled
+        #-----------------------------------------------------------
+        cmpl    $0, pit_defer
+        je      .Lpitnow
+        pushl   $bhPIT
+        call    queue_bh
+        add     $4, %esp
+        jmp     .Lpitdone
+.Lpitnow:
+        pushl   8(%ebp)                 # ISR stack frame ptr
+        call    bhPIT
+        add     $4, %esp
+.Lpitdone:
+        popl    %fs
+        leave
+        ret
+
+#-----------------------------------------------------------------
+# bottom half of the timer interrupt: convert the ticks into the
+# time of day and show it in the status line of the current page
+#-----------------------------------------------------------------
+        .type   bhPIT, @function
+        .align   16
+bhPIT:
+        enter   $0, $0
+        pushl   %fs
+        pushl   %es
+
+        mov     $sel_bs, %ax
+        mov     %ax, %fs
+
         #-----------------------------------------------------------
         # calculate total seconds (= N_TICKS * 65536 / 1193182)
         #-----------------------------------------------------------
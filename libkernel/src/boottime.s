@@ -0,0 +1,151 @@
+
+#-----------------------------------------------------------------
+# boottime.s
+#
+# Reports the boot-timing table filled by dasboot and start.s as a
+# single line on the serial port, e.g.
+#
+#   BOOTTIME stage0=0000000000000000 stage1=00000000001E8A40 ...
+#
+# Every value is the TSC count at the start of the phase relative
+# to the start of the boot sector, or "-" if the phase was not
+# reached. tools/boottime.sh collects the lines of several boots.
+#-----------------------------------------------------------------
+
+        .include "boottime.inc"
+
+        .equ    UART_BASE, 0x03F8       # base i/o-port for UART
+
+#==================================================================
+# SECTION .data
+#==================================================================
+        .section        .data
+
+bt_prefix:      .asciz  "BOOTTIME"
+bt_names:       .asciz  " stage0="
+                .asciz  " stage1="
+                .asciz  " extmem="
+                .asciz  " loadprog="
+                .asciz  " start="
+                .asciz  " pm_enter="
+                .asciz  " main="
+bt_newline:     .asciz  "\r\n"
+bt_missing:     .asciz  "-"
+
+#==================================================================
+# SECTION .text
+#==================================================================
+        .section        .text
+        .code32
+
+#------------------------------------------------------------------
+# boot_time_report - store the timestamp of main and write the
+#                    boot-timing table to the UART
+#
+# Nothing is written if the program was not booted by dasboot.
+#------------------------------------------------------------------
+        .type           boot_time_report, @function
+        .globl          boot_time_report
+        .align          8
+boot_time_report:
+        BOOT_STAMP BT_MAIN, boot_times
+        cmpl    $BOOT_TIMES_SIG, boot_times
+        jne     .Lbtdone
+        pushal
+
+        lea     bt_prefix, %esi
+        call    uart_puts
+        lea     bt_names, %esi
+        xor     %ebx, %ebx              # phase
+.Lbtphase:
+        call    uart_puts               # name, ESI moves to the next
+        mov     boot_times+8(,%ebx,8), %eax
+        mov     boot_times+12(,%ebx,8), %edx
+        mov     %eax, %ecx
+        or      %edx, %ecx
+        jz      .Lbtmissing             # phase not reached
+        sub     boot_times+8, %eax      # relative to stage0
+        sbb     boot_times+12, %edx
+        xchg    %eax, %edx
+        call    uart_hex32              # high dword
+        mov     %edx, %eax
+        call    uart_hex32              # low dword
+.Lbtnext:
+        inc     %ebx
+        cmp     $BT_NUM, %ebx
+        jb      .Lbtphase
+        lea     bt_newline, %esi
+        call    uart_puts
+
+        popal
+.Lbtdone:
+        ret
+
+.Lbtmissing:
+        push    %esi
+        lea     bt_missing, %esi
+        call    uart_puts
+        pop     %esi
+        jmp     .Lbtnext
+
+#------------------------------------------------------------------
+# uart_puts - write a string to the UART
+#
+# Parameters:
+#   - ESI   zero-terminated string, points behind its terminating
+#           zero afterwards
+#------------------------------------------------------------------
+        .type           uart_puts, @function
+        .globl          uart_puts
+        .align          8
+uart_puts:
+        push    %eax
+        push    %edx
+        mov     $UART_BASE+0, %dx       # UART Data i/o-port
+.Lbtputc:
+        lodsb
+        test    %al, %al
+        jz      .Lbtputsdone
+        out     %al, %dx                # send character
+        jmp     .Lbtputc
+.Lbtputsdone:
+        pop     %edx
+        pop     %eax
+        ret
+
+#------------------------------------------------------------------
+# uart_hex32 - write a dword as 8 hex digits to the UART
+#
+# Parameters:
+#   - EAX   value
+#------------------------------------------------------------------
+        .type           uart_hex32, @function
+        .globl          uart_hex32
+        .align          8
+uart_hex32:
+        push    %eax
+        push    %ecx
+        push    %edx
+        mov     %eax, %ecx
+        mov     $8, %ah
+.Lbthexdigit:
+        rol     $4, %ecx
+        mov     %cl, %al
+        and     $0xf, %al
+        add     $'0', %al
+        cmp     $'9', %al
+        jbe     .Lbthexout
+        add     $'A'-'9'-1, %al
+.Lbthexout:
+        mov     $UART_BASE+0, %dx       # UART Data i/o-port
+        out     %al, %dx                # send character
+        dec     %ah
+        jnz     .Lbthexdigit
+        pop     %edx
+        pop     %ecx
+        pop     %eax
+        ret
+
+#------------------------------------------------------------------
+        .end                            # nothing more to assemble
+#------------------------------------------------------------------
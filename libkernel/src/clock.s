@@ -0,0 +1,179 @@
+
+#-----------------------------------------------------------------
+# clock.s
+#
+# High-resolution clock: the TSC is calibrated against channel 2 of
+# the PIT at boot, the calibration and the epoch of the RTC are kept
+# in a page of their own (layout in clockpage.inc). User tasks map
+# this page (system call 351) and compute the time from the TSC
+# themselves, the same way as clock_ns does.
+#-----------------------------------------------------------------
+
+        .include "clockpage.inc"
+
+        .equ    PULSES_PER_SEC, 1193182 # timer input-frequency
+        .equ    CAL_PULSES, PULSES_PER_SEC/100  # calibrate for 10 ms
+        .equ    NS_PER_CAL, 10000000    # nanoseconds in 10 ms
+        .equ    PAGE_SIZE, 0x1000
+
+        .equ    cp_version, clock_page+CP_VERSION
+        .equ    cp_tsc, clock_page+CP_TSC
+        .equ    cp_mult, clock_page+CP_MULT
+        .equ    cp_shift, clock_page+CP_SHIFT
+        .equ    cp_khz, clock_page+CP_KHZ
+        .equ    cp_epoch, clock_page+CP_EPOCH
+
+#==================================================================
+# SECTION .bss
+#==================================================================
+        .section        .bss
+        .align  PAGE_SIZE
+        .globl  clock_page
+clock_page:
+        .zero   PAGE_SIZE
+
+#==================================================================
+# SECTION .text
+#==================================================================
+        .section        .text
+        .code32
+
+#------------------------------------------------------------------
+# clock_init - calibrate the TSC and fill the clock page
+#
+# Parameters:
+#   - EAX   seconds since 1970-01-01 (from rtc_mktime)
+#
+# The PIT channel 2 counts CAL_PULSES in mode 0 with the speaker
+# off, its output in port 0x61 rises at the end. Channel 0 is left
+# to the timer interrupt.
+#------------------------------------------------------------------
+        .type           clock_init, @function
+        .globl          clock_init
+        .align          8
+clock_init:
+        pushal
+        pushfl
+        cli
+        mov     %eax, cp_epoch
+
+        #----------------------------------------------------------
+        # count CAL_PULSES on channel 2 and the TSC meanwhile
+        #----------------------------------------------------------
+        in      $0x61, %al
+        mov     %al, %bl                # keep speaker control
+        and     $0xfc, %al              # speaker off, gate low
+        out     %al, $0x61
+        mov     $0xb0, %al              # channel 2, lo/hi, mode 0
+        out     %al, $0x43
+        mov     $CAL_PULSES & 0xff, %al
+        out     %al, $0x42
+        mov     $CAL_PULSES >> 8, %al
+        out     %al, $0x42
+        in      $0x61, %al
+        and     $0xfc, %al
+        or      $0x01, %al              # gate high, start counting
+        out     %al, $0x61
+        rdtsc
+        mov     %eax, %esi
+        mov     %edx, %edi
+.Lcalwait:
+        in      $0x61, %al
+        test    $0x20, %al              # channel 2 output high?
+        jz      .Lcalwait
+        rdtsc
+        mov     %eax, cp_tsc
+        mov     %edx, cp_tsc+4
+        sub     %esi, %eax              # TSC ticks in 10 ms
+        mov     %eax, %ecx
+        mov     %bl, %al
+        out     %al, $0x61              # restore speaker control
+        jecxz   .Lcaldone
+
+        #----------------------------------------------------------
+        # cp_mult = (NS_PER_CAL << cp_shift) / ticks, with the
+        # largest shift up to 32 which keeps it in 32 bits
+        #----------------------------------------------------------
+        mov     %ecx, %eax
+        xor     %edx, %edx
+        mov     $10, %ebx               # ticks per ms = kHz
+        div     %ebx
+        mov     %eax, cp_khz
+
+        mov     $NS_PER_CAL, %edx       # EDX:EAX = NS_PER_CAL << 32
+        xor     %eax, %eax
+        mov     $32, %ebx
+.Lcalshift:
+        cmp     %ecx, %edx              # quotient fits?
+        jb      .Lcaldiv
+        shrd    $1, %edx, %eax
+        shr     $1, %edx
+        dec     %ebx
+        jmp     .Lcalshift
+.Lcaldiv:
+        div     %ecx
+        mov     %eax, cp_mult
+        mov     %ebx, cp_shift
+        movl    $1, cp_version
+.Lcaldone:
+        popfl
+        popal
+        ret
+
+
+#------------------------------------------------------------------
+# clock_ns - nanoseconds since the epoch of the clock page
+#
+# Returns:
+#   - EDX:EAX   nanoseconds, 0 if the TSC was not calibrated
+#------------------------------------------------------------------
+        .type           clock_ns, @function
+        .globl          clock_ns
+        .align          8
+clock_ns:
+        push    %ecx
+        push    %esi
+        push    %edi
+
+        xor     %eax, %eax
+        xor     %edx, %edx
+        cmpl    $0, cp_version
+        je      .Lnsdone
+
+        #----------------------------------------------------------
+        # 96 bit product EDX:EDI:ESI of the TSC delta and cp_mult
+        #----------------------------------------------------------
+        rdtsc
+        sub     cp_tsc, %eax
+        sbb     cp_tsc+4, %edx
+        mov     %edx, %ecx              # delta high
+        mull    cp_mult
+        mov     %eax, %esi
+        mov     %edx, %edi
+        mov     %ecx, %eax
+        mull    cp_mult
+        add     %eax, %edi
+        adc     $0, %edx
+
+        #----------------------------------------------------------
+        # shift it right by cp_shift
+        #----------------------------------------------------------
+        mov     cp_shift, %ecx
+        cmp     $32, %ecx
+        jb      .Lnsshift
+        mov     %edi, %eax
+        jmp     .Lnsdone
+.Lnsshift:
+        shrd    %cl, %edi, %esi
+        shrd    %cl, %edx, %edi
+        mov     %esi, %eax
+        mov     %edi, %edx
+.Lnsdone:
+        pop     %edi
+        pop     %esi
+        pop     %ecx
+        ret
+
+#------------------------------------------------------------------
+        .end                            # nothing more to assemble
+#------------------------------------------------------------------
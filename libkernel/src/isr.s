@@ -5,6 +5,12 @@
         .equ    NEW_IRQBASE1, 0x20      # revised base for master PIC
         .equ    NEW_IRQBASE2, 0x28      # revised base for slave PIC
 
+        # equates for deferred interrupt work
+        .equ    BH_MAX, 16              # queued bottom halves
+        .equ    EFLAGS_IF, 0x200        # interrupt-enable flag
+
+        .include "clockpage.inc"
+
 #-----------------------------------------------------------------
 # M A C R O S
 #-----------------------------------------------------------------
@@ -121,12 +127,19 @@ theIDT:
         .word   .Lirq14, privCS, 0x8E00, 0x0000
         .word   .Lirq15, privCS, 0x8E00, 0x0000
         #----------------------------------------------------------
+        # 0x30: Local APIC Timer
+        .word   .Lisr48, privCS, 0x8E00, 0x0000
+        #----------------------------------------------------------
         .zero   0x80*8 - (.-theIDT)
         #----------------------------------------------------------
         # Linux SuperVisor-Calls (0x80) gate-descriptor
         .word   isrSVC, privCS, 0xEE00, 0x0000
         #----------------------------------------------------------
-        .zero   256*8 - (.-theIDT)
+        .zero   0xFF*8 - (.-theIDT)
+        #----------------------------------------------------------
+        # 0xFF: Local APIC Spurious Interrupt
+        .word   .Lisr255, privCS, 0x8E00, 0x0000
+        #----------------------------------------------------------
         .equ    limIDT, (.-theIDT)-1    # this IDT's segment_limit
 #------------------------------------------------------------------
         # image for IDTR register
@@ -147,6 +160,30 @@ intcnt: .space  256*4, 0                # 256 counters (32-bit size)
         .align  16
 isr_table:
         .space  256*4, 0                # 256 ISR handler pointers
+#-------------------------------------------------------------------
+        .align  4
+bh_queue:
+        .space  BH_MAX*4, 0             # pending bottom halves (FIFO)
+bh_num: .long   0                       # number of pending ones
+bh_active:
+        .long   0                       # 1 while bottom halves run
+#-------------------------------------------------------------------
+.ifdef IRQ_BENCH
+        .align  4
+irqoff_start:
+        .long   0                       # TSC (low) at cli
+        .global irqoff_max
+irqoff_max:
+        .long   0                       # longest interrupts-off window
+irqoff_prefix:
+        .asciz  "IRQOFF "
+irqoff_cycles:
+        .asciz  " cycles="
+irqoff_ns:
+        .asciz  " ns="
+irqoff_newline:
+        .asciz  "\r\n"
+.endif
 #-------------------------------------------------------------------
         .section .text
         .global remap_isr_pm
@@ -265,6 +302,108 @@ register_isr_end:
         ret
 
 
+#------------------------------------------------------------------
+# queue a bottom half: interrupt handlers do the urgent work only
+# and queue the rest, which the common stub calls with interrupts
+# enabled before it returns to the interrupted code. A bottom half
+# is called like a handler (ISR stack frame pointer on the stack)
+# and queued at most once until it runs.
+#
+#    8(%ebp)    pointer to bottom half
+#
+# returns 0, or -1 if the queue is full
+#------------------------------------------------------------------
+        .global queue_bh
+        .type   queue_bh, @function
+        .align  8
+queue_bh:
+        enter   $0, $0
+        push    %ecx
+        pushfl
+        cli
+
+        mov     8(%ebp), %eax
+        xor     %ecx, %ecx
+.Lbhfind:
+        cmp     bh_num, %ecx            # already queued?
+        jae     .Lbhappend
+        cmp     %eax, bh_queue(,%ecx,4)
+        je      .Lbhqueued
+        inc     %ecx
+        jmp     .Lbhfind
+.Lbhappend:
+        cmp     $BH_MAX, %ecx
+        jae     .Lbhfull
+        mov     %eax, bh_queue(,%ecx,4)
+        incl    bh_num
+.Lbhqueued:
+        xor     %eax, %eax
+        jmp     .Lbhend
+.Lbhfull:
+        mov     $-1, %eax
+.Lbhend:
+        popfl
+        pop     %ecx
+        leave
+        ret
+
+
+.ifdef IRQ_BENCH
+#------------------------------------------------------------------
+# write the longest interrupts-off window since the last report to
+# the UART and start over, e.g.
+#
+#   IRQOFF <name> cycles=00001A2B ns=00000C35
+#
+# The window lasts from the entry of the common stub until it
+# enables interrupts for bottom halves or returns, ns is 0 if the
+# TSC was not calibrated. The stub measures the window only when
+# built with IRQ_BENCH.
+#
+#    8(%ebp)    pointer to name (zero-terminated)
+#------------------------------------------------------------------
+        .global irqoff_report
+        .type   irqoff_report, @function
+        .align  8
+irqoff_report:
+        enter   $0, $0
+        pushal
+
+        lea     irqoff_prefix, %esi
+        call    uart_puts
+        mov     8(%ebp), %esi
+        call    uart_puts
+        lea     irqoff_cycles, %esi
+        call    uart_puts
+
+        xor     %eax, %eax
+        xchg    %eax, irqoff_max        # read and reset
+        call    uart_hex32
+        mov     %eax, %ebx
+        lea     irqoff_ns, %esi
+        call    uart_puts
+
+        mov     %ebx, %eax              # ns = cycles * 1000000 / kHz
+        mov     $1000000, %edx
+        mul     %edx
+        mov     clock_page+CP_KHZ, %ecx
+        cmp     %ecx, %edx              # quotient fits (kHz > 0)?
+        jb      .Lirqoffdiv
+        xor     %eax, %eax
+        jmp     .Lirqoffns
+.Lirqoffdiv:
+        div     %ecx
+.Lirqoffns:
+        call    uart_hex32
+        lea     irqoff_newline, %esi
+        call    uart_puts
+
+        popal
+        leave
+        ret
+.endif
+
+
 #------------------------------------------------------------------
 # Interrupt Service Routines (ISRs)
 #------------------------------------------------------------------
@@ -323,6 +462,13 @@ IRQ_CALL    46, 14 # 46 <- IRQ14
 IRQ_CALL    47, 15 # 47 <- IRQ15
 
 
+#------------------------------------------------------------------
+# Local APIC Interrupts (the handler signals EOI to the local APIC)
+#------------------------------------------------------------------
+ISR_NE      48 # 48: Local APIC Timer
+ISR_NE     255 # 255: Local APIC Spurious Interrupt
+
+
 #==================================================================
 #===========  DEFAULT INTERRUPT SERVICE ROUTINE (ISR)  ============
 #==================================================================
@@ -365,6 +511,14 @@ IRQ_CALL    47, 15 # 47 <- IRQ15
         mov     %ax, %gs                #   with ES register
         mov     %ax, %fs                #   with FS register
 
+.ifdef IRQ_BENCH
+        #----------------------------------------------------------
+        # start of the interrupts-off window
+        #----------------------------------------------------------
+        rdtsc
+        mov     %eax, irqoff_start
+.endif
+
         #----------------------------------------------------------
         # load interrupt ID and increment interrupt counter
         #----------------------------------------------------------
@@ -421,6 +575,13 @@ IRQ_CALL    47, 15 # 47 <- IRQ15
         jb      .Lnoirq                 #   no, then skip IRQ
 
 .Lirqeoi:
+        #----------------------------------------------------------
+        # interrupts of the local APIC (ID 0x30 and above) don't
+        # come from the PICs
+        #----------------------------------------------------------
+        cmp     $0x30, %ebx             # check int id >= 0x30
+        jae     .Lnoirq                 #   yes, then skip EOI
+
         #----------------------------------------------------------
         # check whether the Interrupt ID was greater than or equal
         # to 40 (0x28, meaning IRQ8-15), then we need to send an
@@ -437,6 +598,46 @@ IRQ_CALL    47, 15 # 47 <- IRQ15
         out     %al, $0x20              # send EOI to Master-PIC
 
 .Lnoirq:
+        #----------------------------------------------------------
+        # run the queued bottom halves with interrupts enabled,
+        # unless they are running already further up the stack or
+        # the interrupted code had disabled interrupts
+        #----------------------------------------------------------
+        cmpl    $0, bh_num
+        je      .Lbhdone
+        cmpl    $0, bh_active
+        jne     .Lbhdone
+        testl   $EFLAGS_IF, 64(%ebp)
+        jz      .Lbhdone
+        movl    $1, bh_active
+.Lbhnext:
+.ifdef IRQ_BENCH
+        call    .Lirqoff_end
+.endif
+        mov     bh_queue, %edx          # dequeue the first one
+        decl    bh_num
+        mov     bh_num, %ecx
+        lea     bh_queue+4, %esi
+        lea     bh_queue, %edi
+        cld
+        rep     movsl
+        sti
+        push    %ebp
+        call    *%edx
+        pop     %ebp
+        cli
+.ifdef IRQ_BENCH
+        rdtsc
+        mov     %eax, irqoff_start
+.endif
+        cmpl    $0, bh_num
+        jne     .Lbhnext
+        movl    $0, bh_active
+.Lbhdone:
+.ifdef IRQ_BENCH
+        call    .Lirqoff_end
+.endif
+
         #----------------------------------------------------------
         # restore the values to the registers we've modified here
         #----------------------------------------------------------
@@ -461,3 +662,17 @@ IRQ_CALL    47, 15 # 47 <- IRQ15
         #----------------------------------------------------------
         iret
 
+.ifdef IRQ_BENCH
+        #----------------------------------------------------------
+        # end of an interrupts-off window, keep the longest one
+        #----------------------------------------------------------
+.Lirqoff_end:
+        rdtsc
+        sub     irqoff_start, %eax
+        cmp     irqoff_max, %eax
+        jbe     .Lirqoff_keep
+        mov     %eax, irqoff_max
+.Lirqoff_keep:
+        ret
+.endif
+
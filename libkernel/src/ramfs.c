@@ -0,0 +1,322 @@
+
+/*
+ * Read-only file system over the ramdisk loaded by dasboot to
+ * 0x100000. The files of a version 2 ramdisk (see tools/ramdisk.c)
+ * start on pages and are followed by a page holding the hashed
+ * directory, so a file is found by name without a search and its
+ * pages can be mapped into a program without copying. The offset
+ * of the directory is taken from the header of the table of
+ * contents, which start.s copies into ramdisk_toc.
+ *
+ * The functions run with DS = privDS. File data is not copied here,
+ * read and mmap return the linear address of the data and the
+ * system call copies or maps it in the caller's segment.
+ */
+
+#define RAMDISK_ADDR        0x100000UL    /* linear address of the ramdisk */
+#define PRIVDS_BASE         0x020000UL    /* linear address of privDS */
+
+#define RD_VERSION                   2
+#define RD_PAGE_SIZE              4096
+#define RD_MAX_FILES                60
+#define RD_MAX_NAME                 32
+#define RD_HASH_SIZE                64
+#define RD_NONE                 0xffff
+
+#define RAMFS_FD_BASE                3    /* 0 to 2 are the console */
+#define RAMFS_MAX_FILES              8
+
+#define SEEK_SET                     0
+#define SEEK_CUR                     1
+#define SEEK_END                     2
+
+/* logical address in privDS of an offset in the ramdisk */
+#define RAMDISK_PTR(offs)   ((char *)(RAMDISK_ADDR - PRIVDS_BASE + (offs)))
+
+
+/* same layouts as in tools/ramdisk.c */
+struct rd_toc {
+    char            fl_sig[8];
+    unsigned long   fl_num;
+    unsigned long   fl_size;
+    unsigned long   fl_mtime;
+    unsigned short  fl_start_sector;
+    unsigned char   fl_flags;
+    unsigned char   fl_version;
+    unsigned long   fl_csize;
+    unsigned long   fl_coffs;
+    unsigned long   fl_dir_offset;
+    unsigned long   fl_capacity;
+};
+
+struct rd_entry {
+    char            re_name[RD_MAX_NAME];
+    unsigned long   re_addr;
+    unsigned long   re_size;
+    unsigned long   re_mtime;
+    unsigned long   re_crc;
+    unsigned short  re_next;
+    char            re_spare[14];
+};
+
+struct rd_dir {
+    char            rd_sig[8];
+    unsigned long   rd_num;
+    unsigned long   rd_hash_size;
+    unsigned short  rd_hash[RD_HASH_SIZE];
+    char            rd_spare[48];
+    struct rd_entry rd_files[RD_MAX_FILES];
+};
+
+struct ramfs_file {
+    struct rd_entry *entry;             /* NULL if the descriptor is free */
+    unsigned long   pos;
+};
+
+
+/* file name copied from the caller by the open system call */
+char ramfs_name[RD_MAX_NAME+1];
+
+/* linear address of the data returned by the last ramfs_read */
+unsigned long ramfs_src;
+
+/* header of the table of contents, copied by start.s */
+extern struct rd_toc ramdisk_toc;
+
+static char toc_sig[8] = { 'R', 'A', 'M', 'D', 'I', 'S', 'K', ' ' };
+static char rd_sig[8] = { 'R', 'D', 'D', 'I', 'R', '2', ' ', ' ' };
+static struct rd_dir *ramfs_dir;
+static struct ramfs_file ramfs_files[RAMFS_MAX_FILES];
+
+
+
+/**
+ * Compare at most n characters of two names
+ */
+static int
+ramfs_strncmp(const char *a, const char *b, int n)
+{
+    for(int i = 0; i < n; i++) {
+        if(a[i] != b[i]) {
+            return a[i] - b[i];
+        }
+        if(a[i] == '\0') {
+            break;
+        }
+    }
+    return 0;
+}
+
+
+/**
+ * Directory hash of a name, FNV-1a as in tools/ramdisk.c
+ */
+static unsigned long
+ramfs_hash(const char *name)
+{
+    unsigned long h = 2166136261UL;
+
+    for(int i = 0; (i < RD_MAX_NAME) && (name[i] != '\0'); i++) {
+        h = (h ^ (unsigned char)name[i]) * 16777619UL;
+    }
+    return h % RD_HASH_SIZE;
+}
+
+
+/**
+ * Find the directory page at the offset given by the table of
+ * contents, returns the number of files or -1 if the ramdisk has
+ * no directory
+ */
+int
+ramfs_init(void)
+{
+    struct rd_toc *tp = &ramdisk_toc;
+
+    if((ramfs_strncmp(tp->fl_sig, toc_sig, 8) != 0) ||
+       (tp->fl_version != RD_VERSION) ||
+       (tp->fl_dir_offset & (RD_PAGE_SIZE-1)) ||
+       (tp->fl_dir_offset >= tp->fl_size) ||
+       (sizeof(struct rd_dir) > tp->fl_size - tp->fl_dir_offset)) {
+        return -1;
+    }
+
+    struct rd_dir *dp = (struct rd_dir *)RAMDISK_PTR(tp->fl_dir_offset);
+    if((ramfs_strncmp(dp->rd_sig, rd_sig, 8) != 0) ||
+       (dp->rd_hash_size != RD_HASH_SIZE) || (dp->rd_num > RD_MAX_FILES)) {
+        return -1;
+    }
+    ramfs_dir = dp;
+    return dp->rd_num;
+}
+
+
+/**
+ * Return the directory entry of a file in O(1), or NULL
+ */
+static struct rd_entry *
+ramfs_lookup(const char *name)
+{
+    if((ramfs_dir == 0) && (ramfs_init() < 0)) {
+        return 0;
+    }
+
+    unsigned short i = ramfs_dir->rd_hash[ramfs_hash(name)];
+    while((i != RD_NONE) && (i < RD_MAX_FILES)) {
+        struct rd_entry *ep = &ramfs_dir->rd_files[i];
+        if(ramfs_strncmp(ep->re_name, name, RD_MAX_NAME) == 0) {
+            return ep;
+        }
+        i = ep->re_next;
+    }
+    return 0;
+}
+
+
+/**
+ * Return the open file of a descriptor, or NULL
+ */
+static struct ramfs_file *
+ramfs_file(int fd)
+{
+    fd -= RAMFS_FD_BASE;
+    if((fd < 0) || (fd >= RAMFS_MAX_FILES) || (ramfs_files[fd].entry == 0)) {
+        return 0;
+    }
+    return &ramfs_files[fd];
+}
+
+
+/**
+ * Open a file by name, returns the descriptor or -1
+ */
+int
+ramfs_open(const char *name)
+{
+    struct rd_entry *ep = ramfs_lookup(name);
+
+    if(ep == 0) {
+        return -1;
+    }
+    for(int fd = 0; fd < RAMFS_MAX_FILES; fd++) {
+        if(ramfs_files[fd].entry == 0) {
+            ramfs_files[fd].entry = ep;
+            ramfs_files[fd].pos = 0;
+            return fd + RAMFS_FD_BASE;
+        }
+    }
+    return -1;
+}
+
+
+/**
+ * Advance the file position by up to len bytes, returns the number
+ * of bytes and stores their linear address in ramfs_src, 0 at the end
+ * of the file or -1 for an invalid descriptor
+ */
+long
+ramfs_read(int fd, unsigned long len)
+{
+    struct ramfs_file *fp = ramfs_file(fd);
+
+    if(fp == 0) {
+        return -1;
+    }
+    if(fp->pos >= fp->entry->re_size) {
+        return 0;
+    }
+    if(len > fp->entry->re_size - fp->pos) {
+        len = fp->entry->re_size - fp->pos;
+    }
+    ramfs_src = RAMDISK_ADDR + fp->entry->re_addr + fp->pos;
+    fp->pos += len;
+    return len;
+}
+
+
+/**
+ * Set the file position, returns the new position or -1
+ */
+long
+ramfs_lseek(int fd, long offset, int whence)
+{
+    struct ramfs_file *fp = ramfs_file(fd);
+    long base;
+
+    if(fp == 0) {
+        return -1;
+    }
+    switch(whence) {
+        case SEEK_SET:
+            base = 0;
+            break;
+        case SEEK_CUR:
+            base = fp->pos;
+            break;
+        case SEEK_END:
+            base = fp->entry->re_size;
+            break;
+        default:
+            return -1;
+    }
+    if(base + offset < 0) {
+        return -1;
+    }
+    fp->pos = base + offset;
+    return fp->pos;
+}
+
+
+/**
+ * Release a descriptor, returns 0 or -1
+ */
+int
+ramfs_close(int fd)
+{
+    struct ramfs_file *fp = ramfs_file(fd);
+
+    if(fp == 0) {
+        return -1;
+    }
+    fp->entry = 0;
+    return 0;
+}
+
+
+/**
+ * Return the linear address of len bytes at the page aligned offset
+ * of a file for mapping them, or 0. The extent of a file starts on a
+ * page, so the pages hold no data of other files beyond its end.
+ */
+unsigned long
+ramfs_mmap(int fd, unsigned long offset, unsigned long len)
+{
+    struct ramfs_file *fp = ramfs_file(fd);
+
+    if((fp == 0) || (len == 0) || (offset & (RD_PAGE_SIZE-1)) ||
+       (offset >= fp->entry->re_size)) {
+        return 0;
+    }
+
+    unsigned long end = (fp->entry->re_size + RD_PAGE_SIZE-1) & ~(RD_PAGE_SIZE-1);
+    if(len > end - offset) {
+        return 0;
+    }
+    return RAMDISK_ADDR + fp->entry->re_addr + offset;
+}
+
+
+/**
+ * Return the linear address of the ELF image of a program, or 0
+ */
+unsigned long
+ramfs_exec(const char *name)
+{
+    struct rd_entry *ep = ramfs_lookup(name);
+
+    if((ep == 0) || (ep->re_size < 4) ||
+       (*(unsigned long *)RAMDISK_PTR(ep->re_addr) != 0x464C457FUL)) {
+        return 0;
+    }
+    return RAMDISK_ADDR + ep->re_addr;
+}
@@ -27,6 +27,11 @@
         .equ    selPM32, 0x10
         .equ    selRM16, 0x18
 
+        .include "boottime.inc"
+
+        .equ    RAMDISK_TOC, 0x0500     # ramdisk TOC loaded by dasboot
+        .equ    RAMDISK_TOC_LEN, 40     # header up to fl_capacity
+
 #==================================================================
 # SECTION .data
 #==================================================================
@@ -67,7 +72,21 @@ cmos_rtc_dt:    .ascii  "hh:mm:ss YY-MM-DD"
 a20_enabled:    .byte   0x00
 #------------------------------------------------------------------
                 .align  4
+                .globl  memsizes
 memsizes:       .word   0, 0, 0
+#------------------------------------------------------------------
+# boot-timing table taken over from dasboot (see boottime.inc)
+#------------------------------------------------------------------
+                .align  4
+                .globl  boot_times
+boot_times:     .zero   BOOT_TIMES_LEN
+#------------------------------------------------------------------
+# header of the ramdisk table of contents (see ramfs.c), zero if
+# the program was not loaded with a ramdisk
+#------------------------------------------------------------------
+                .align  4
+                .globl  ramdisk_toc
+ramdisk_toc:    .zero   RAMDISK_TOC_LEN
 
 
 #==================================================================
@@ -93,6 +112,42 @@ _start:
         mov     %ax, %es
         mov     %ax, %gs
 
+        #----------------------------------------------------------
+        # copy the boot-timing table of dasboot and invalidate it,
+        # so it is not taken for the one of a later boot
+        #----------------------------------------------------------
+        xor     %ax, %ax
+        mov     %ax, %fs
+        cmpl    $BOOT_TIMES_SIG, %fs:BOOT_TIMES
+        jne     .Lno_boot_times
+        BOOT_STAMP BT_START, %fs:BOOT_TIMES
+        xor     %si, %si
+.Lcopy_boot_times:
+        mov     %fs:BOOT_TIMES(%si), %eax
+        mov     %eax, boot_times(%si)
+        add     $4, %si
+        cmp     $BOOT_TIMES_LEN, %si
+        jb      .Lcopy_boot_times
+        movl    $0, %fs:BOOT_TIMES
+.Lno_boot_times:
+
+        #----------------------------------------------------------
+        # copy the header of the ramdisk table of contents, ramfs
+        # runs with DS = privDS, which does not reach it there
+        #----------------------------------------------------------
+        cmpl    $0x444d4152, %fs:RAMDISK_TOC    # check 'RAMD'
+        jne     .Lno_ramdisk_toc
+        cmpl    $0x204b5349, %fs:RAMDISK_TOC+4  # check 'ISK '
+        jne     .Lno_ramdisk_toc
+        xor     %si, %si
+.Lcopy_ramdisk_toc:
+        mov     %fs:RAMDISK_TOC(%si), %eax
+        mov     %eax, ramdisk_toc(%si)
+        add     $4, %si
+        cmp     $RAMDISK_TOC_LEN, %si
+        jb      .Lcopy_ramdisk_toc
+.Lno_ramdisk_toc:
+
         #----------------------------------------------------------
         # preserve the caller's stack-address (for a return later)
         #----------------------------------------------------------
@@ -439,6 +494,7 @@ pm_enter:
         # setup protected-mode stack segment
         #----------------------------------------------------------
         lss     pmstack, %esp
+        BOOT_STAMP BT_PM_ENTER, boot_times
 
         #----------------------------------------------------------
         # initialise bss section with zero words
@@ -460,8 +516,15 @@ pm_enter:
         mov     %eax, ticks
 
         #----------------------------------------------------------
-        # call kernel main routine...
+        # calibrate the TSC, the RTC time is the epoch of the clock
+        #----------------------------------------------------------
+        call    clock_init
+
+        #----------------------------------------------------------
+        # report boot phases over serial line, call kernel main
+        # routine...
         #----------------------------------------------------------
+        call    boot_time_report
         call    main
 
         #----------------------------------------------------------
@@ -19,10 +19,10 @@ sys_call_table:
         .long   do_nothing   #  0
         .long   Scheduler_common_stub #  1 (Scheduler exit)
         .long   do_nothing   #  2
-        .long   do_nothing   #  3
+        .long   sys_read     #  3
         .long   sys_write    #  4
-        .long   do_nothing   #  5
-        .long   do_nothing   #  6
+        .long   sys_open     #  5
+        .long   sys_close    #  6
         .long   Scheduler_common_stub #  7 (Scheduler waitpid)
         .long   do_nothing   #  8
         .long   do_nothing   #  9
@@ -35,7 +35,7 @@ sys_call_table:
         .long   do_nothing   # 16
         .long   do_nothing   # 17
         .long   do_nothing   # 18
-        .long   do_nothing   # 19
+        .long   sys_lseek    # 19
         .long   Scheduler_common_stub # 20 (Scheduler getPID)
 .rept	16
         .long   do_nothing   # 21 to 36
@@ -49,10 +49,22 @@ sys_call_table:
         .long   do_nothing   # 104 to 157
 .endr
 	.long	Scheduler_common_stub # 158 (Scheduler yield)
-.rept	191
-        .long   do_nothing   # 159 to 349
+.rept	33
+        .long   do_nothing   # 159 to 191
+.endr
+        .long   sys_mmap2    # 192
+.rept	72
+        .long   do_nothing   # 193 to 264
+.endr
+        .long   sys_clock_gettime # 265
+.rept	84
+        .long   do_nothing   # 266 to 349
 .endr
 	.long	Scheduler_common_stub # 350 (Scheduler pThread_create)
+        .long   sys_clock_page # 351
+	.long	Scheduler_common_stub # 352 (Scheduler setRT)
+	.long	Scheduler_common_stub # 353 (Scheduler rtStat)
+	.long	Scheduler_common_stub # 354 (Scheduler execName)
         .equ    N_SYSCALLS, (.-sys_call_table)/4
 #------------------------------------------------------------------
         .align   16
@@ -141,6 +153,284 @@ sys_time:       # time system call
         popl    %ds
         iret                    # resume the calling task
 
+#------------------------------------------------------------------
+        .equ    CLOCK_REALTIME, 0       # clock IDs of clock_gettime
+        .equ    CLOCK_MONOTONIC, 1
+        .equ    NS_PER_SEC, 1000000000
+        .equ    PRIVDS_BASE, 0x20000    # linear address of privDS
+        .align      8
+sys_clock_gettime: # read the TSC based clock
+        .extern clock_ns
+        .extern clock_page
+#
+#       EXPECTS:        EBX = clock ID (0 = realtime, 1 = monotonic)
+#                       ECX = offset of struct timespec (seconds and
+#                             nanoseconds, 32 bit each)
+#
+#       RETURNS:        EAX = 0 (or -1 for any errors)
+#
+        push    %ds
+        push    %es
+        pushal
+
+        mov     $privDS, %ax
+        mov     %ax, %ds
+        movl    $-1, 28(%esp)
+        cmp     $CLOCK_MONOTONIC, %ebx
+        ja      .Lclockdone
+        cmpl    $0, clock_page          # TSC calibrated?
+        je      .Lclockdone
+
+        # split the nanoseconds since boot into seconds (EAX) and
+        # nanoseconds (EDX)
+        call    clock_ns
+        mov     $NS_PER_SEC, %ecx
+        mov     %eax, %esi
+        mov     %edx, %eax
+        xor     %edx, %edx
+        div     %ecx
+        mov     %esi, %eax
+        div     %ecx
+        cmp     $CLOCK_REALTIME, %ebx
+        jne     .Lclockstore
+        add     clock_page+24, %eax     # epoch of the clock page
+
+.Lclockstore:
+        mov     24(%esp), %edi
+        mov     36(%esp), %ds
+        mov     %eax, (%edi)
+        mov     %edx, 4(%edi)
+        movl    $0, 28(%esp)
+.Lclockdone:
+        popal
+        pop     %es
+        pop     %ds
+        iret
+
+#------------------------------------------------------------------
+        .align      8
+sys_clock_page: # make the clock page readable for the caller
+        .weak   pg_readonly
+#
+#       EXPECTS:        nothing
+#
+#       RETURNS:        EAX = linear address of the clock page (see
+#                             clock.s), the caller reads it with its
+#                             flat data segment (or -1 for any errors)
+#
+# pg_readonly of the kernel write-protects the page in the caller's
+# page tables. Without it the page is not handed out, the caller
+# could change the clock of every task.
+#
+        push    %ebx
+        push    %ecx
+        mov     $pg_readonly, %eax
+        test    %eax, %eax
+        jz      .Lclockpagefail
+        mov     $clock_page+PRIVDS_BASE, %ebx
+        mov     $4096, %ecx
+        push    %ds
+        mov     $privDS, %ax
+        mov     %ax, %ds
+        call    pg_readonly
+        pop     %ds
+        test    %eax, %eax
+        jnz     .Lclockpagefail
+        mov     %ebx, %eax
+        jmp     .Lclockpage
+.Lclockpagefail:
+        mov     $-1, %eax
+.Lclockpage:
+        pop     %ecx
+        pop     %ebx
+        iret
+
+#------------------------------------------------------------------
+# The file system calls work on the ramdisk (see ramfs.c). The C
+# functions run with DS = ES = privDS, their result replaces EAX in
+# the saved registers.
+#
+#       Stack after pushal:     EDI ESI EBP ESP EBX EDX ECX EAX ES DS
+#                               +0  +4  +8  +12 +16 +20 +24 +28 +32 +36
+#------------------------------------------------------------------
+        .equ    RAMFS_MAX_NAME, 32      # length of a file name
+        .equ    PROT_WRITE, 2           # mmap protection for writing
+        .align      8
+sys_open:       # open a file of the ramdisk for reading
+        .extern ramfs_open
+        .extern ramfs_name
+#
+#       EXPECTS:        EBX = offset of file name (zero terminated)
+#
+#       RETURNS:        EAX = file descriptor (or -1 for any errors)
+#
+        push    %ds
+        push    %es
+        pushal
+
+        # copy the name from the caller's segment
+        mov     $privDS, %ax
+        mov     %ax, %es
+        mov     %ebx, %esi
+        lea     ramfs_name, %edi
+        mov     $RAMFS_MAX_NAME, %ecx
+        cld
+.Lopencopy:
+        lodsb
+        stosb
+        test    %al, %al
+        jz      .Lopencall
+        loop    .Lopencopy
+        movb    $0, %es:(%edi)          # terminate a long name
+.Lopencall:
+        mov     %es, %ax
+        mov     %ax, %ds
+        pushl   $ramfs_name
+        call    ramfs_open
+        add     $4, %esp
+        jmp     .Lramfsret
+
+#------------------------------------------------------------------
+        .align      8
+sys_read:       # read from a file of the ramdisk
+        .extern ramfs_read
+        .extern ramfs_src
+#
+#       EXPECTS:        EBX = file descriptor
+#                       ECX = offset of buffer
+#                       EDX = number of bytes to read
+#
+#       RETURNS:        EAX = number of bytes read, 0 at end of file
+#                             (or -1 for any errors)
+#
+        push    %ds
+        push    %es
+        pushal
+
+        mov     $privDS, %ax
+        mov     %ax, %ds
+        mov     %ax, %es
+        push    %edx
+        push    %ebx
+        call    ramfs_read
+        add     $8, %esp
+        mov     ramfs_src, %esi         # linear address of the data
+        mov     %eax, 28(%esp)
+        test    %eax, %eax
+        jle     .Lramfsdone
+
+        # copy straight from the ramdisk into the caller's buffer,
+        # the caller's flat data segment addresses both
+        mov     %eax, %ecx
+        mov     36(%esp), %ds
+        mov     36(%esp), %es
+        mov     24(%esp), %edi
+        cld
+        rep     movsb
+        jmp     .Lramfsdone
+
+#------------------------------------------------------------------
+        .align      8
+sys_close:      # close a file of the ramdisk
+        .extern ramfs_close
+#
+#       EXPECTS:        EBX = file descriptor
+#
+#       RETURNS:        EAX = 0 (or -1 for any errors)
+#
+        push    %ds
+        push    %es
+        pushal
+
+        mov     $privDS, %ax
+        mov     %ax, %ds
+        mov     %ax, %es
+        push    %ebx
+        call    ramfs_close
+        add     $4, %esp
+        jmp     .Lramfsret
+
+#------------------------------------------------------------------
+        .align      8
+sys_lseek:      # set the position in a file of the ramdisk
+        .extern ramfs_lseek
+#
+#       EXPECTS:        EBX = file descriptor
+#                       ECX = offset
+#                       EDX = whence (0 = set, 1 = current, 2 = end)
+#
+#       RETURNS:        EAX = new position (or -1 for any errors)
+#
+        push    %ds
+        push    %es
+        pushal
+
+        mov     $privDS, %ax
+        mov     %ax, %ds
+        mov     %ax, %es
+        push    %edx
+        push    %ecx
+        push    %ebx
+        call    ramfs_lseek
+        add     $12, %esp
+        jmp     .Lramfsret
+
+#------------------------------------------------------------------
+        .align      8
+sys_mmap2:      # map pages of a file of the ramdisk read-only
+        .extern ramfs_mmap
+        .weak   pg_readonly
+#
+#       EXPECTS:        EBX = address (ignored)
+#                       ECX = length
+#                       EDX = protection, without PROT_WRITE
+#                       EDI = file descriptor
+#                       EBP = offset in pages
+#
+#       RETURNS:        EAX = address of the mapping (or -1 for any
+#                             errors)
+#
+# The pages of the file are used in place, pg_readonly of the kernel
+# write-protects them in the caller's page tables. Without it there
+# is no mmap.
+#
+        push    %ds
+        push    %es
+        pushal
+
+        mov     $privDS, %ax
+        mov     %ax, %ds
+        mov     %ax, %es
+        movl    $-1, 28(%esp)
+        test    $PROT_WRITE, %edx
+        jnz     .Lramfsdone
+        mov     $pg_readonly, %eax
+        test    %eax, %eax
+        jz      .Lramfsdone
+
+        push    %ecx
+        shl     $12, %ebp
+        push    %ebp
+        push    %edi
+        call    ramfs_mmap
+        add     $12, %esp
+        test    %eax, %eax
+        jz      .Lramfsdone
+
+        mov     %eax, %ebx
+        mov     24(%esp), %ecx
+        call    pg_readonly
+        test    %eax, %eax
+        jnz     .Lramfsdone
+        mov     %ebx, %eax
+.Lramfsret:
+        mov     %eax, 28(%esp)
+.Lramfsdone:
+        popal
+        pop     %es
+        pop     %ds
+        iret
+
 #------------------------------------------------------------------
         .align      8
 sys_syslog:       # for logging data to memory
@@ -190,6 +480,9 @@ sys_syslog:       # for logging data to memory
 # eax=20  getPID (ONLY FROM USER MODE)
 # eax=37  kill (ebx=PIDtoKill)
 # eax=158 sched_yield (ONLY FROM USER MODE)
+# eax=352 setRT (ebx=period, ecx=budget, edx=deadline in ns)
+# eax=353 rtStat (ONLY FROM USER MODE)
+# eax=354 execName (ebx=name of program in the ramdisk)
 #
 #-----------------------------------------------------------------
 .extern scheduler_newTask
@@ -199,6 +492,9 @@ sys_syslog:       # for logging data to memory
 .extern scheduler_yield
 .extern scheduler_getPID
 .extern scheduler_waitpid
+.extern scheduler_setRT
+.extern scheduler_rtStat
+.extern scheduler_execName
 
         .align  8
 Scheduler_common_stub:
@@ -280,6 +576,21 @@ Scheduler_common_stub:
 	call scheduler_newpThread
 	jmp .end_sched_func
 .next_sched_func6:
+	cmp $352, %eax # setRT
+	jne .next_sched_func7
+	call scheduler_setRT
+	jmp .end_sched_func
+.next_sched_func7:
+	cmp $353, %eax # rtStat
+	jne .next_sched_func8
+	call scheduler_rtStat
+	jmp .end_sched_func
+.next_sched_func8:
+	cmp $354, %eax # execName
+	jne .next_sched_func9
+	call scheduler_execName
+	jmp .end_sched_func
+.next_sched_func9:
 	# Error handling for unknown id -> do nothing
 .end_sched_func:
 	popl %ebp
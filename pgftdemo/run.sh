@@ -1,4 +1,5 @@
 #!/bin/bash
 
-make && qemu-system-x86_64 -fda pgftdemo.flp -m 16M -cpu Nehalem -curses -no-reboot -serial telnet::4444,server
+test -f swap.img || dd if=/dev/zero of=swap.img bs=1M count=16 status=none
+make && qemu-system-x86_64 -fda pgftdemo.flp -drive file=swap.img,index=0,media=disk,format=raw -m 16M -cpu Nehalem -curses -no-reboot -serial telnet::4444,server
 
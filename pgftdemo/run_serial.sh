@@ -1,4 +1,5 @@
 #!/bin/bash
 
-qemu-system-x86_64 -drive file=pgftdemo.flp,index=0,if=floppy,format=raw -m 16M -cpu Nehalem -serial stdio -no-reboot -serial mon:telnet::4444,server,nowait -nographic
+test -f swap.img || dd if=/dev/zero of=swap.img bs=1M count=16 status=none
+qemu-system-x86_64 -drive file=pgftdemo.flp,index=0,if=floppy,format=raw -drive file=swap.img,index=0,media=disk,format=raw -m 16M -cpu Nehalem -serial stdio -no-reboot -serial mon:telnet::4444,server,nowait -nographic
 
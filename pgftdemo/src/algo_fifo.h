@@ -9,4 +9,6 @@ extern uint32_t algo_fifo_get_address_of_page_to_replace();
 
 extern void algo_fifo_new_page_in_ram(uint32_t addr);
 
+extern void algo_fifo_remove_page(uint32_t addr);
+
 #endif
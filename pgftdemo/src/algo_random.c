@@ -1,12 +1,20 @@
 #include "algo_random.h"
 #include "algo.h"
+#include "frame.h"
 
 //Systick
 extern uint32_t ticks;
 
 //Random
-static uint32_t pages_in_ram[PAGES_PHYSICAL_NUM];
 static uint32_t random_index = 0;
+static uint32_t random_seed = 1;
+
+//Frames holding user pages, the slots of replaced pages are reused
+//by the next new pages
+static uint32_t pages_in_ram[PAGES_POOL_MAX_NUM];
+static uint32_t pages_in_ram_num = 0;
+static uint32_t free_slots[PAGES_POOL_MAX_NUM];
+static uint32_t free_slots_num = 0;
 
 #define RANDOM_ARRAY_SIZE 128
 
@@ -25,8 +33,9 @@ extern int asm_printf(char *fmt, ...);
  **/
 void algo_random_init() {
 
-    for(unsigned int i = 0; i < sizeof(pages_in_ram)/sizeof(pages_in_ram[0]); i++)
-        pages_in_ram[i] = INVALID_ADDR;
+    pages_in_ram_num = 0;
+    free_slots_num = 0;
+    random_seed = 1;
 
     if(random_index != 0) {
         random_index = 0;
@@ -37,30 +46,60 @@ void algo_random_init() {
  * Returns logical address of page to replace
  **/
 uint32_t algo_random_get_address_of_page_to_replace() {
-    uint32_t index = get_random_number();
-    uint32_t addr_to_replace = pages_in_ram[index];
-    pages_in_ram[index] = INVALID_ADDR;
-    return addr_to_replace;
+    if(pages_in_ram_num <= free_slots_num) return INVALID_ADDR;
+
+    //Skip slots of pages that were replaced already
+    uint32_t index = get_random_number() % pages_in_ram_num;
+    while(pages_in_ram[index] == INVALID_INDEX) {
+        index = (index + 1) % pages_in_ram_num;
+    }
+
+    uint32_t frame = pages_in_ram[index];
+    pages_in_ram[index] = INVALID_INDEX;
+    free_slots[free_slots_num++] = index;
+    return frame_table[frame].virt_addr;
 }
 
 /**
- * Store new created page in fifo
+ * Store frame of new created page
  **/
 void algo_random_new_page_in_ram(uint32_t addr) {
-    for(unsigned int i = 0; i < sizeof(pages_in_ram)/sizeof(pages_in_ram[0]); i++) {
-        if(pages_in_ram[i] == INVALID_ADDR) {
-            pages_in_ram[i] = addr;
+    uint32_t frame = frame_of_page(addr);
+    if(frame == INVALID_INDEX) return;
+
+    if(free_slots_num > 0) {
+        pages_in_ram[free_slots[--free_slots_num]] = frame;
+    } else if(pages_in_ram_num < PAGES_POOL_MAX_NUM) {
+        pages_in_ram[pages_in_ram_num++] = frame;
+    }
+}
+
+/**
+ * Forget frame of page, e.g. because it was merged with another page
+ **/
+void algo_random_remove_page(uint32_t addr) {
+    uint32_t frame = frame_of_page(addr);
+    if(frame == INVALID_INDEX) return;
+
+    for(uint32_t index = 0; index < pages_in_ram_num; index++) {
+        if(pages_in_ram[index] == frame) {
+            pages_in_ram[index] = INVALID_INDEX;
+            free_slots[free_slots_num++] = index;
             return;
         }
     }
 }
 
 /**
- * Returns random 32 bit unsigned integer
+ * Returns random 32 bit unsigned integer. The two lowest bits come from
+ * the fixed random table, so runs with four frames are reproducible.
  **/
 uint32_t get_random_number() {
     uint32_t random_number = random_array[random_index % RANDOM_ARRAY_SIZE];
 
+    random_seed = random_seed * 1103515245 + 12345;
+    random_number |= (random_seed >> 16) << 2;
+
     random_index++;
     return random_number;
 }
@@ -0,0 +1,230 @@
+#include "ata.h"
+#include "stat.h"
+
+extern int asm_printf(char *fmt, ...);
+
+//Port access and interrupt masking, see ataio.s
+extern uint32_t ata_inb(uint32_t port);
+extern void ata_outb(uint32_t port, uint32_t value);
+extern void ata_insw(uint32_t port, void *buf, uint32_t count);
+extern void ata_outsw(uint32_t port, void *buf, uint32_t count);
+extern uint32_t ata_lock(void);
+extern void ata_unlock(uint32_t eflags);
+
+//Loops to wait for the drive before giving up
+#define ATA_TIMEOUT               0x100000
+
+//Number of LBA28 sectors of the drive, 0 if there is no drive
+uint32_t ata_sectors = 0;
+
+//Requests are numbered in submission order and served in this order,
+//request n is done as soon as ata_completed is greater than n
+static ata_request_t ata_queue[ATA_QUEUE_LEN];
+static uint32_t ata_submitted = 0;
+uint32_t ata_completed = 0;
+
+//Buffer for the identify data of the drive
+static uint16_t ata_identify[ATA_SECTOR_SIZE / 2];
+
+/**
+ * Waits until the drive is not busy any more. Returns the status
+ * register, or 0xff on timeout.
+ **/
+static uint32_t
+ata_wait_ready()
+{
+    for (uint32_t i = 0; i < ATA_TIMEOUT; i++) {
+        uint32_t status = ata_inb(ATA_IO_BASE + ATA_REG_STATUS);
+        if ((status & ATA_SR_BSY) != ATA_SR_BSY) {
+            return status;
+        }
+    }
+    return 0xff;
+} // end of ata_wait_ready
+
+/**
+ * Issues the command of the oldest queued request. Writes transfer their
+ * first sector right away, the drive raises no interrupt before it.
+ **/
+static void
+ata_start()
+{
+    ata_request_t *req = &ata_queue[ata_completed % ATA_QUEUE_LEN];
+
+    ata_wait_ready();
+    ata_outb(ATA_IO_BASE + ATA_REG_DRIVE, ATA_DRIVE_LBA | ((req->lba >> 24) & 0x0f));
+    ata_outb(ATA_IO_BASE + ATA_REG_SECCOUNT, req->count);
+    ata_outb(ATA_IO_BASE + ATA_REG_LBA0, req->lba);
+    ata_outb(ATA_IO_BASE + ATA_REG_LBA1, req->lba >> 8);
+    ata_outb(ATA_IO_BASE + ATA_REG_LBA2, req->lba >> 16);
+    ata_outb(ATA_IO_BASE + ATA_REG_COMMAND,
+             req->op == ATA_OP_READ ? ATA_CMD_READ : ATA_CMD_WRITE);
+
+    if (req->op == ATA_OP_WRITE) {
+        uint32_t status = ata_wait_ready();
+        if ((status & ATA_SR_DRQ) == ATA_SR_DRQ) {
+            ata_outsw(ATA_IO_BASE + ATA_REG_DATA, req->buf, ATA_SECTOR_SIZE / 2);
+            req->done = 1;
+        }
+    }
+} // end of ata_start
+
+/**
+ * Advances the oldest request by one sector. Called by the handler of
+ * IRQ 14 and, with interrupts disabled, by ata_wait. Reading the status
+ * register acknowledges the interrupt, so an interrupt for a sector that
+ * was already handled by polling finds the drive busy or without data
+ * and is ignored.
+ **/
+void
+ata_service()
+{
+    uint32_t status = ata_inb(ATA_IO_BASE + ATA_REG_STATUS);
+
+    if (ata_completed == ata_submitted || (status & ATA_SR_BSY) == ATA_SR_BSY) {
+        return;
+    }
+
+    ata_request_t *req = &ata_queue[ata_completed % ATA_QUEUE_LEN];
+
+    if ((status & (ATA_SR_ERR | ATA_SR_DF)) != 0) {
+        stat_number_swap_errors++;
+        req->done = req->count;
+    } else if (req->op == ATA_OP_READ) {
+        if ((status & ATA_SR_DRQ) != ATA_SR_DRQ) {
+            return;
+        }
+        ata_insw(ATA_IO_BASE + ATA_REG_DATA, req->buf + req->done * ATA_SECTOR_SIZE,
+                 ATA_SECTOR_SIZE / 2);
+        req->done++;
+    } else if ((status & ATA_SR_DRQ) == ATA_SR_DRQ) {
+        //Drive wants the next sector of a write
+        if (req->done < req->count) {
+            ata_outsw(ATA_IO_BASE + ATA_REG_DATA, req->buf + req->done * ATA_SECTOR_SIZE,
+                      ATA_SECTOR_SIZE / 2);
+            req->done++;
+        }
+        return;
+    }
+
+    //Request finished, start the next one
+    if (req->done == req->count) {
+        ata_completed++;
+        if (ata_completed != ata_submitted) {
+            ata_start();
+        }
+    }
+} // end of ata_service
+
+/**
+ * Queues a transfer of count sectors starting at sector lba from (read)
+ * or to (write) buf. Waits for a free queue entry if the queue is full.
+ * Returns the number of the request, or INVALID_INDEX without a drive.
+ **/
+uint32_t
+ata_submit(uint32_t op, uint32_t lba, uint32_t count, void *buf)
+{
+    if (ata_sectors == 0) {
+        return INVALID_INDEX;
+    }
+
+    //Queue full, wait for the oldest request
+    if (ata_submitted - ata_completed == ATA_QUEUE_LEN) {
+        ata_wait(ata_completed);
+    }
+
+    uint32_t eflags = ata_lock();
+
+    uint32_t id = ata_submitted;
+    ata_request_t *req = &ata_queue[id % ATA_QUEUE_LEN];
+    req->op = op;
+    req->lba = lba;
+    req->count = count;
+    req->done = 0;
+    req->buf = buf;
+    ata_submitted++;
+
+    //Drive is idle, start the request right away
+    if (id == ata_completed) {
+        ata_start();
+    }
+
+    ata_unlock(eflags);
+
+    return id;
+} // end of ata_submit
+
+/**
+ * Returns 1 if request req has completed
+ **/
+uint32_t
+ata_is_done(uint32_t req)
+{
+    return (int32_t)(ata_completed - req) > 0;
+} // end of ata_is_done
+
+/**
+ * Waits for the completion of request req. The drive is polled, so this
+ * also works in the page fault handler, which runs with interrupts
+ * disabled.
+ **/
+void
+ata_wait(uint32_t req)
+{
+    while (!ata_is_done(req)) {
+        uint32_t eflags = ata_lock();
+        ata_service();
+        ata_unlock(eflags);
+    }
+} // end of ata_wait
+
+/**
+ * Detects the master drive of the primary IDE channel and enables its
+ * interrupts. Returns the number of sectors, 0 if there is no drive.
+ **/
+uint32_t
+ata_init()
+{
+    ata_sectors = 0;
+    ata_submitted = 0;
+    ata_completed = 0;
+
+    //Floating bus, there is no drive at all
+    if (ata_inb(ATA_IO_BASE + ATA_REG_STATUS) == 0xff) {
+        return 0;
+    }
+
+    ata_outb(ATA_IO_BASE + ATA_REG_DRIVE, ATA_DRIVE_LBA);
+    ata_outb(ATA_IO_BASE + ATA_REG_SECCOUNT, 0);
+    ata_outb(ATA_IO_BASE + ATA_REG_LBA0, 0);
+    ata_outb(ATA_IO_BASE + ATA_REG_LBA1, 0);
+    ata_outb(ATA_IO_BASE + ATA_REG_LBA2, 0);
+    ata_outb(ATA_IO_BASE + ATA_REG_COMMAND, ATA_CMD_IDENTIFY);
+
+    uint32_t status = ata_inb(ATA_IO_BASE + ATA_REG_STATUS);
+    if (status == 0) {
+        return 0;
+    }
+    status = ata_wait_ready();
+
+    //ATAPI and SATA devices set the signature in the LBA registers
+    if (ata_inb(ATA_IO_BASE + ATA_REG_LBA1) != 0 || ata_inb(ATA_IO_BASE + ATA_REG_LBA2) != 0) {
+        return 0;
+    }
+    if ((status & (ATA_SR_ERR | ATA_SR_DRQ)) != ATA_SR_DRQ) {
+        return 0;
+    }
+    ata_insw(ATA_IO_BASE + ATA_REG_DATA, ata_identify, ATA_SECTOR_SIZE / 2);
+
+    //Words 60 and 61 hold the number of LBA28 sectors
+    ata_sectors = ata_identify[60] | ((uint32_t)ata_identify[61] << 16);
+
+    //Enable interrupts of the drive and unmask IRQ 14 and the cascade
+    ata_outb(ATA_CTRL_BASE, 0);
+    ata_outb(0xA1, ata_inb(0xA1) & ~(1 << 6));
+    ata_outb(0x21, ata_inb(0x21) & ~(1 << 2));
+
+    asm_printf("ATA disk: %d sectors\r\n", ata_sectors);
+
+    return ata_sectors;
+} // end of ata_init
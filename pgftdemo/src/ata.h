@@ -0,0 +1,65 @@
+#ifndef _ATA_H
+#define _ATA_H          1
+
+#include "pgftdemo.h"
+
+/*
+ * I/O ports of the primary IDE channel
+ */
+#define ATA_IO_BASE                0x1F0
+#define ATA_CTRL_BASE              0x3F6
+
+#define ATA_REG_DATA                   0
+#define ATA_REG_ERROR                  1
+#define ATA_REG_SECCOUNT               2
+#define ATA_REG_LBA0                   3
+#define ATA_REG_LBA1                   4
+#define ATA_REG_LBA2                   5
+#define ATA_REG_DRIVE                  6
+#define ATA_REG_STATUS                 7
+#define ATA_REG_COMMAND                7
+
+/*
+ * Status register bits
+ */
+#define ATA_SR_ERR                  0x01
+#define ATA_SR_DRQ                  0x08
+#define ATA_SR_DF                   0x20
+#define ATA_SR_BSY                  0x80
+
+/*
+ * Commands
+ */
+#define ATA_CMD_READ                0x20    // read sectors with retry, LBA28
+#define ATA_CMD_WRITE               0x30    // write sectors with retry, LBA28
+#define ATA_CMD_IDENTIFY            0xEC
+
+#define ATA_DRIVE_LBA               0xE0    // master drive, LBA addressing
+#define ATA_SECTOR_SIZE              512
+#define ATA_QUEUE_ORDER                3
+#define ATA_QUEUE_LEN   (1 << ATA_QUEUE_ORDER)    // requests queued at the same time
+
+/*
+ * Request types
+ */
+#define ATA_OP_READ                    1
+#define ATA_OP_WRITE                   2
+
+typedef struct {
+    uint32_t op;                // ATA_OP_READ or ATA_OP_WRITE
+    uint32_t lba;               // first sector
+    uint32_t count;             // number of sectors
+    uint32_t done;              // number of sectors transferred
+    uint8_t *buf;               // logical address of data buffer
+} ata_request_t;
+
+extern uint32_t ata_sectors;
+extern uint32_t ata_completed;
+
+extern uint32_t ata_init(void);
+extern uint32_t ata_submit(uint32_t op, uint32_t lba, uint32_t count, void *buf);
+extern uint32_t ata_is_done(uint32_t req);
+extern void ata_wait(uint32_t req);
+extern void ata_service(void);
+
+#endif  /* _ATA_H */
@@ -0,0 +1,210 @@
+
+#==================================================================
+#=========      I/O PORT ACCESS AND IRQ FOR ATA DISKS     =========
+#==================================================================
+#
+# The request queue of the ATA driver is written in C (ata.c), this
+# module provides the port accesses it needs and the handler for
+# IRQ 14 of the primary IDE channel.
+#
+#-----------------------------------------------------------------
+
+
+#==================================================================
+# S E C T I O N   T E X T
+#==================================================================
+        .section        .text
+        .code32
+
+
+#-------------------------------------------------------------------
+# FUNCTION:   ata_inb
+#
+# PURPOSE:    read a byte from an i/o-port
+#
+# C Call:     uint32_t ata_inb(uint32_t port)
+#
+# PARAMETERS: 8(%ebp) - i/o-port
+#
+# RETURN:     EAX - byte read, zero extended
+#
+#-------------------------------------------------------------------
+        .type   ata_inb, @function
+        .global ata_inb
+ata_inb:
+        enter   $0, $0
+        push    %edx
+
+        mov     8(%ebp), %edx
+        xor     %eax, %eax
+        in      %dx, %al
+
+        pop     %edx
+        leave
+        ret
+
+
+#-------------------------------------------------------------------
+# FUNCTION:   ata_outb
+#
+# PURPOSE:    write a byte to an i/o-port
+#
+# C Call:     void ata_outb(uint32_t port, uint32_t value)
+#
+# PARAMETERS: 8(%ebp)  - i/o-port
+#             12(%ebp) - byte to write
+#
+# RETURN:     none
+#
+#-------------------------------------------------------------------
+        .type   ata_outb, @function
+        .global ata_outb
+ata_outb:
+        enter   $0, $0
+        push    %edx
+
+        mov     8(%ebp), %edx
+        mov     12(%ebp), %eax
+        out     %al, %dx
+
+        pop     %edx
+        leave
+        ret
+
+
+#-------------------------------------------------------------------
+# FUNCTION:   ata_insw
+#
+# PURPOSE:    read words from the data port of the drive
+#
+# C Call:     void ata_insw(uint32_t port, void *buf, uint32_t count)
+#
+# PARAMETERS: 8(%ebp)  - i/o-port
+#             12(%ebp) - logical address of buffer (ES:EDI)
+#             16(%ebp) - number of words
+#
+# RETURN:     none
+#
+#-------------------------------------------------------------------
+        .type   ata_insw, @function
+        .global ata_insw
+ata_insw:
+        enter   $0, $0
+        push    %ecx
+        push    %edx
+        push    %edi
+
+        mov     8(%ebp), %edx
+        mov     12(%ebp), %edi
+        mov     16(%ebp), %ecx
+        cld
+        rep     insw
+
+        pop     %edi
+        pop     %edx
+        pop     %ecx
+        leave
+        ret
+
+
+#-------------------------------------------------------------------
+# FUNCTION:   ata_outsw
+#
+# PURPOSE:    write words to the data port of the drive
+#
+# C Call:     void ata_outsw(uint32_t port, void *buf, uint32_t count)
+#
+# PARAMETERS: 8(%ebp)  - i/o-port
+#             12(%ebp) - logical address of buffer (DS:ESI)
+#             16(%ebp) - number of words
+#
+# RETURN:     none
+#
+#-------------------------------------------------------------------
+        .type   ata_outsw, @function
+        .global ata_outsw
+ata_outsw:
+        enter   $0, $0
+        push    %ecx
+        push    %edx
+        push    %esi
+
+        mov     8(%ebp), %edx
+        mov     12(%ebp), %esi
+        mov     16(%ebp), %ecx
+        cld
+        rep     outsw
+
+        pop     %esi
+        pop     %edx
+        pop     %ecx
+        leave
+        ret
+
+
+#-------------------------------------------------------------------
+# FUNCTION:   ata_lock
+#
+# PURPOSE:    disable hardware interrupts while the request queue is
+#             changed outside of the interrupt handler
+#
+# C Call:     uint32_t ata_lock(void)
+#
+# PARAMETERS: none
+#
+# RETURN:     EAX - EFLAGS before interrupts were disabled
+#
+#-------------------------------------------------------------------
+        .type   ata_lock, @function
+        .global ata_lock
+ata_lock:
+        pushfl
+        pop     %eax
+        cli
+        ret
+
+
+#-------------------------------------------------------------------
+# FUNCTION:   ata_unlock
+#
+# PURPOSE:    enable hardware interrupts again if they were enabled
+#             when ata_lock was called
+#
+# C Call:     void ata_unlock(uint32_t eflags)
+#
+# PARAMETERS: 4(%esp) - EFLAGS returned by ata_lock
+#
+# RETURN:     none
+#
+#-------------------------------------------------------------------
+        .type   ata_unlock, @function
+        .global ata_unlock
+ata_unlock:
+        testl   $(1<<9), 4(%esp)        # interrupt flag set before?
+        jz      .Lnosti
+        sti
+.Lnosti:
+        ret
+
+
+#-------------------------------------------------------------------
+# FUNCTION:   irqATA
+#
+# PURPOSE:    handler for IRQ 14, the drive has finished a sector.
+#             The EOI is sent by the common interrupt stub.
+#
+# PARAMETERS: 8(%ebp) - interrupt stack frame
+#
+# RETURN:     none
+#
+#-------------------------------------------------------------------
+        .type   irqATA, @function
+        .global irqATA
+        .extern ata_service
+irqATA:
+        enter   $0, $0
+
+        call    ata_service
+
+        leave
+        ret
@@ -9,6 +9,10 @@
 cpuid_features:
         .long   0
 
+        .global cpuid_features_edx
+cpuid_features_edx:
+        .long   0
+
         .global cpuid_avail
 cpuid_avail:
         .byte   -1
@@ -29,7 +33,8 @@ cpuid_sse42_avail:
 #
 # PURPOSE:    check whether cpuid instruction is available and, if
 #             so, excute cpuid function #1 in order to check for
-#             SSE4.2 feature
+#             SSE4.2 feature. The feature flags in ECX and EDX are
+#             kept in cpuid_features and cpuid_features_edx
 #
 # PARAMETERS: None
 #
@@ -43,6 +48,7 @@ cpuid_sse42_avail:
         .global check_cpuid
 check_cpuid:
         enter   $0, $0
+        push    %ebx
         push    %ecx
         push    %edx
 
@@ -67,6 +73,7 @@ check_cpuid:
         mov     $0x01, %eax     # cpuid function 1
         cpuid
         mov     %ecx, cpuid_features
+        mov     %edx, cpuid_features_edx
         bt      $20, %ecx       # check SSE4.2 feature bit
         setc    %ah
         mov     %ah, cpuid_sse42_avail
@@ -76,6 +83,7 @@ check_cpuid:
 .Lskipcpuid:
         pop     %edx
         pop     %ecx
+        pop     %ebx
         leave
         ret
 
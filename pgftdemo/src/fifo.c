@@ -0,0 +1,77 @@
+#include "fifo.h"
+#include "algo.h"
+#include "frame.h"
+
+/**
+ * Empties fifo
+ **/
+void fifo_init(fifo_t *fifo) {
+    fifo->head = INVALID_INDEX;
+    fifo->tail = INVALID_INDEX;
+}
+
+/**
+ * Add frame of page at logical address to fifo
+ **/
+void fifo_enqueue(fifo_t *fifo, uint32_t addr) {
+    uint32_t frame = frame_of_page(addr);
+
+    //If page is not present return, this should never happen
+    if(frame == INVALID_INDEX) return;
+
+    frame_table[frame].algo_next = INVALID_INDEX;
+    frame_table[frame].algo_prev = fifo->tail;
+    if(fifo->tail == INVALID_INDEX) {
+        fifo->head = frame;
+    } else {
+        frame_table[fifo->tail].algo_next = frame;
+    }
+    fifo->tail = frame;
+}
+
+/**
+ * Get address of page from fifo
+ **/
+uint32_t fifo_dequeue(fifo_t *fifo) {
+    //If fifo is empty return invalid address, this should never happen
+    if(fifo->head == INVALID_INDEX) return INVALID_ADDR;
+
+    uint32_t frame = fifo->head;
+    fifo->head = frame_table[frame].algo_next;
+    if(fifo->head == INVALID_INDEX) {
+        fifo->tail = INVALID_INDEX;
+    } else {
+        frame_table[fifo->head].algo_prev = INVALID_INDEX;
+    }
+    frame_table[frame].algo_next = INVALID_INDEX;
+
+    return frame_table[frame].virt_addr;
+}
+
+/**
+ * Unlink frame of page from fifo in O(1), frames not in the fifo are ignored
+ **/
+void fifo_remove(fifo_t *fifo, uint32_t addr) {
+    uint32_t frame = frame_of_page(addr);
+
+    if(frame == INVALID_INDEX) return;
+
+    uint32_t prev = frame_table[frame].algo_prev;
+    uint32_t next = frame_table[frame].algo_next;
+
+    //Only the head has no predecessor
+    if(prev == INVALID_INDEX && fifo->head != frame) return;
+
+    if(prev == INVALID_INDEX) {
+        fifo->head = next;
+    } else {
+        frame_table[prev].algo_next = next;
+    }
+    if(next == INVALID_INDEX) {
+        fifo->tail = prev;
+    } else {
+        frame_table[next].algo_prev = prev;
+    }
+    frame_table[frame].algo_next = INVALID_INDEX;
+    frame_table[frame].algo_prev = INVALID_INDEX;
+}
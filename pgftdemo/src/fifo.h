@@ -0,0 +1,20 @@
+#ifndef _FIFO_H
+#define _FIFO_H
+
+#include "types.h"
+
+/*
+ * FIFO of frames, doubly linked through the algo_next and algo_prev
+ * fields of the frame descriptors
+ */
+typedef struct fifo_struct {
+    uint32_t head;        // index of first frame
+    uint32_t tail;        // index of last frame
+} fifo_t;
+
+extern void fifo_init(fifo_t *fifo);
+extern void fifo_enqueue(fifo_t *fifo, uint32_t addr);
+extern uint32_t fifo_dequeue(fifo_t *fifo);
+extern void fifo_remove(fifo_t *fifo, uint32_t addr);
+
+#endif
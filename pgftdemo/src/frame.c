@@ -0,0 +1,343 @@
+#include "frame.h"
+#include "region.h"
+
+//Descriptors of all frames in the frame pool
+frame_t frame_table[PAGES_POOL_MAX_NUM];
+
+//Shared zero page, mapped read-only for pages that were never written
+uint32_t frame_zero_page[PTE_NUM] __attribute__((aligned(PAGE_SIZE)));
+
+//Number of frames in the pool, free frames, frames holding user pages
+uint32_t frame_pool_num = 0;
+uint32_t frame_free_num = 0;
+uint32_t frame_user_num = 0;
+
+//Number of free frames that were cleared during idle time
+uint32_t frame_zeroed_num = 0;
+
+//Next frame to look at for idle time clearing
+static uint32_t frame_zero_cursor = 0;
+
+//Maximum number of frames holding user pages at the same time
+uint32_t frame_user_max = PAGES_PHYSICAL_NUM;
+
+//Free blocks of each order, bit n stands for the block starting at
+//frame n << order
+#define FRAME_MAP_WORDS       (PAGES_POOL_MAX_NUM / 32)
+static uint32_t frame_free_map[FRAME_ORDER_MAX + 1][FRAME_MAP_WORDS];
+
+//Lowest bitmap word of each order that may contain a free block
+static uint32_t frame_free_hint[FRAME_ORDER_MAX + 1];
+
+static void free_list_add(uint32_t index, uint32_t order);
+static void free_list_remove(uint32_t index, uint32_t order);
+static uint32_t free_list_lowest(uint32_t order);
+
+/**
+ * Puts the first pool_num frames of the pool into the buddy allocator.
+ * Frames are handed out in ascending order afterwards.
+ **/
+void
+frame_init(uint32_t pool_num)
+{
+    if (pool_num > PAGES_POOL_MAX_NUM) {
+        pool_num = PAGES_POOL_MAX_NUM;
+    }
+
+    for (uint32_t order = 0; order <= FRAME_ORDER_MAX; order++) {
+        for (uint32_t i = 0; i < FRAME_MAP_WORDS; i++) {
+            frame_free_map[order][i] = 0;
+        }
+        frame_free_hint[order] = 0;
+    }
+
+    for (uint32_t i = 0; i < PAGES_POOL_MAX_NUM; i++) {
+        frame_table[i].flags = 0;
+    }
+
+    frame_pool_num = pool_num;
+    frame_free_num = pool_num;
+    frame_user_num = 0;
+    frame_zeroed_num = 0;
+    frame_zero_cursor = 0;
+    region_frames_clear();
+
+    //Split the pool into the largest naturally aligned blocks
+    uint32_t index = pool_num;
+    while (index > 0) {
+        uint32_t order = 0;
+        while (order < FRAME_ORDER_MAX && (index & (1 << order)) == 0) {
+            order++;
+        }
+        index -= 1 << order;
+        free_list_add(index, order);
+    }
+} // end of frame_init
+
+/**
+ * Allocates a block of (1 << order) contiguous frames and returns the
+ * index of its first frame, or INVALID_INDEX if no block is available.
+ **/
+uint32_t
+frame_alloc_pages(uint32_t order)
+{
+    uint32_t current = FRAME_ORDER_MAX + 1;
+    uint32_t index = INVALID_INDEX;
+
+    //Take the lowest of the free blocks that are large enough, this
+    //keeps allocations packed at the start of the pool
+    for (uint32_t i = order; i <= FRAME_ORDER_MAX; i++) {
+        uint32_t lowest = free_list_lowest(i);
+        if (lowest < index) {
+            index = lowest;
+            current = i;
+        }
+    }
+    if (index == INVALID_INDEX) {
+        return INVALID_INDEX;
+    }
+
+    free_list_remove(index, current);
+
+    //Split it, the upper halves go back to the free lists
+    while (current > order) {
+        current--;
+        free_list_add(index + (1 << current), current);
+    }
+
+    for (uint32_t i = 0; i < (1U << order); i++) {
+        if (frame_table[index + i].flags & FRAME_IS_ZEROED) {
+            frame_zeroed_num--;
+        }
+        frame_table[index + i].flags = FRAME_IS_USED | (frame_table[index + i].flags & FRAME_IS_ZEROED);
+        frame_table[index + i].virt_addr = INVALID_ADDR;
+        frame_table[index + i].swap_slot = INVALID_INDEX;
+        frame_table[index + i].algo_next = INVALID_INDEX;
+        frame_table[index + i].algo_prev = INVALID_INDEX;
+        frame_table[index + i].refs = 0;
+    }
+    frame_table[index].flags |= order << FRAME_ORDER_SHIFT;
+    frame_free_num -= 1 << order;
+
+    return index;
+} // end of frame_alloc_pages
+
+/**
+ * Returns the block starting at frame index to the buddy allocator and
+ * merges it with its free buddies.
+ **/
+void
+frame_free_pages(uint32_t index)
+{
+    if ((frame_table[index].flags & FRAME_IS_USED) != FRAME_IS_USED) {
+        return;
+    }
+
+    uint32_t order = FRAME_ORDER(frame_table[index].flags);
+
+    for (uint32_t i = 0; i < (1U << order); i++) {
+        frame_table[index + i].flags = 0;
+    }
+    frame_free_num += 1 << order;
+
+    while (order < FRAME_ORDER_MAX) {
+        uint32_t buddy = index ^ (1 << order);
+
+        if (buddy >= frame_pool_num
+                || (frame_table[buddy].flags & FRAME_IS_FREE) != FRAME_IS_FREE
+                || FRAME_ORDER(frame_table[buddy].flags) != order) {
+            break;
+        }
+
+        free_list_remove(buddy, order);
+        frame_table[buddy].flags &= FRAME_IS_ZEROED;
+        index &= ~(1 << order);
+        order++;
+    }
+
+    free_list_add(index, order);
+} // end of frame_free_pages
+
+/**
+ * Takes a free frame for the user page at virt_addr and returns its index,
+ * or INVALID_INDEX if the maximum number of user frames is reached.
+ **/
+uint32_t
+frame_alloc(uint32_t virt_addr)
+{
+    if (frame_user_num >= frame_user_max) {
+        return INVALID_INDEX;
+    }
+
+    uint32_t index = frame_alloc_pages(0);
+    if (index == INVALID_INDEX) {
+        return INVALID_INDEX;
+    }
+
+    frame_table[index].flags |= FRAME_IS_USER;
+    frame_table[index].virt_addr = virt_addr & PAGE_ADDR_MASK;
+    frame_user_num++;
+    region_frame_add(virt_addr);
+
+    return index;
+} // end of frame_alloc
+
+/**
+ * Returns the frame of a user page to the buddy allocator.
+ **/
+void
+frame_free(uint32_t index)
+{
+    if ((frame_table[index].flags & FRAME_IS_USER) != FRAME_IS_USER) {
+        return;
+    }
+
+    frame_user_num--;
+    region_frame_remove(frame_table[index].virt_addr);
+    frame_free_pages(index);
+} // end of frame_free
+
+/**
+ * Returns the frames of all user pages and all merged frames to the
+ * buddy allocator. Blocks the kernel took with frame_alloc_pages stay
+ * allocated.
+ **/
+void
+frame_free_user()
+{
+    for (uint32_t i = 0; i < frame_pool_num; i++) {
+        if ((frame_table[i].flags & FRAME_IS_USER) == FRAME_IS_USER) {
+            frame_free(i);
+        } else if ((frame_table[i].flags & FRAME_IS_MERGED) == FRAME_IS_MERGED) {
+            frame_free_pages(i);
+        }
+    }
+} // end of frame_free_user
+
+/**
+ * Turns the frame of a user page into a merged frame, which is mapped
+ * read-only by identical pages and never replaced. It is returned by
+ * frame_free_pages once no page maps it any more.
+ **/
+void
+frame_merge(uint32_t index)
+{
+    if ((frame_table[index].flags & FRAME_IS_USER) != FRAME_IS_USER) {
+        return;
+    }
+
+    frame_user_num--;
+    region_frame_remove(frame_table[index].virt_addr);
+
+    frame_table[index].flags &= ~FRAME_IS_USER;
+    frame_table[index].flags |= FRAME_IS_MERGED;
+    frame_table[index].virt_addr = INVALID_ADDR;
+    frame_table[index].swap_slot = INVALID_INDEX;
+    frame_table[index].algo_next = INVALID_INDEX;
+    frame_table[index].algo_prev = INVALID_INDEX;
+    frame_table[index].refs = 1;
+} // end of frame_merge
+
+/**
+ * Returns the index of the frame holding the present page at virt_addr,
+ * or INVALID_INDEX if the page is not present.
+ **/
+uint32_t
+frame_of_page(uint32_t virt_addr)
+{
+    uint32_t *page_directory = get_page_dir_addr();
+    uint32_t pde_entry = page_directory[PDE(virt_addr)];
+
+    if ((pde_entry & PAGE_IS_PRESENT) != PAGE_IS_PRESENT) {
+        return INVALID_INDEX;
+    }
+
+    uint32_t *page_table = LOGADDR(pde_entry & PAGE_ADDR_MASK);
+    uint32_t pte_entry = page_table[PTE(virt_addr)];
+
+    if ((pte_entry & PAGE_IS_PRESENT) != PAGE_IS_PRESENT) {
+        return INVALID_INDEX;
+    }
+
+    //Pages mapped outside the pool (e.g. the zero page) have no frame
+    uint32_t index = FRAME_INDEX(pte_entry & PAGE_ADDR_MASK);
+    if ((pte_entry & PAGE_ADDR_MASK) < PAGES_PHYSICAL_START || index >= frame_pool_num) {
+        return INVALID_INDEX;
+    }
+
+    return index;
+} // end of frame_of_page
+
+/**
+ * Clears one free frame that was not cleared yet. Called repeatedly
+ * while the kernel waits for input, so the fault path mostly finds
+ * pre-zeroed frames.
+ **/
+void
+frame_zero_idle()
+{
+    if (frame_zeroed_num >= frame_free_num) {
+        return;
+    }
+
+    for (uint32_t n = 0; n < frame_pool_num; n++) {
+        uint32_t index = frame_zero_cursor;
+
+        frame_zero_cursor++;
+        if (frame_zero_cursor >= frame_pool_num) {
+            frame_zero_cursor = 0;
+        }
+
+        if ((frame_table[index].flags & (FRAME_IS_USED | FRAME_IS_ZEROED)) == 0) {
+            clear_page(FRAME_ADDR(index));
+            frame_table[index].flags |= FRAME_IS_ZEROED;
+            frame_zeroed_num++;
+            return;
+        }
+    }
+} // end of frame_zero_idle
+
+/**
+ * Marks the block starting at index as a free block of the given order.
+ **/
+static void
+free_list_add(uint32_t index, uint32_t order)
+{
+    uint32_t block = index >> order;
+
+    frame_table[index].flags &= FRAME_IS_ZEROED;
+    frame_table[index].flags |= FRAME_IS_FREE | (order << FRAME_ORDER_SHIFT);
+    frame_free_map[order][block / 32] |= 1U << (block % 32);
+    if (block / 32 < frame_free_hint[order]) {
+        frame_free_hint[order] = block / 32;
+    }
+} // end of free_list_add
+
+/**
+ * Removes the free block starting at index from the free blocks of its order.
+ **/
+static void
+free_list_remove(uint32_t index, uint32_t order)
+{
+    uint32_t block = index >> order;
+
+    frame_free_map[order][block / 32] &= ~(1U << (block % 32));
+} // end of free_list_remove
+
+/**
+ * Returns the first frame of the lowest free block of the given order,
+ * or INVALID_INDEX if there is none.
+ **/
+static uint32_t
+free_list_lowest(uint32_t order)
+{
+    for (uint32_t i = frame_free_hint[order]; i < FRAME_MAP_WORDS; i++) {
+        if (frame_free_map[order][i] != 0) {
+            frame_free_hint[order] = i;
+            return (i * 32 + __builtin_ctz(frame_free_map[order][i])) << order;
+        }
+    }
+    frame_free_hint[order] = FRAME_MAP_WORDS;
+
+    return INVALID_INDEX;
+} // end of free_list_lowest
@@ -0,0 +1,66 @@
+#ifndef _FRAME_H
+#define _FRAME_H        1
+
+#include "pgftdemo.h"
+
+/*
+ * Flags of a frame descriptor
+ */
+#define FRAME_IS_USED              0x001
+#define FRAME_IS_FREE              0x002    // first frame of a free block
+#define FRAME_IS_USER              0x004    // frame holds a user page
+#define FRAME_IS_ZEROED            0x008    // free frame was cleared during idle time
+#define FRAME_IS_PGTABLE           0x010    // frame holds a user page table
+#define FRAME_IS_MERGED            0x020    // read-only frame shared by identical pages
+
+/*
+ * Order of the block a frame descriptor is the first frame of,
+ * i.e. the block consists of (1 << order) frames
+ */
+#define FRAME_ORDER_SHIFT              8
+#define FRAME_ORDER_MASK      (0xf << FRAME_ORDER_SHIFT)
+#define FRAME_ORDER(flags)    (((flags) & FRAME_ORDER_MASK) >> FRAME_ORDER_SHIFT)
+#define FRAME_ORDER_MAX               10    // 4 MiB blocks
+
+/*
+ * Descriptor of one physical page frame of the frame pool.
+ * The descriptor of a frame is found in O(1) by its physical address,
+ * the frame of a present page is found by its page table entry.
+ */
+typedef struct frame_struct {
+    uint32_t flags;       // FRAME_IS_* flags and block order
+    uint32_t virt_addr;   // virtual address of the owning page
+    uint32_t swap_slot;   // swap slot holding a clean copy of the page
+    uint32_t algo_next;   // next frame in the list of the replacement algorithm
+    uint32_t algo_prev;   // previous frame in the list of the replacement algorithm
+    uint32_t refs;        // page table entries mapping a merged frame
+} frame_t;
+
+#define FRAME_INDEX(phys)     (((phys) - PAGES_PHYSICAL_START) >> PTE_SHIFT)
+#define FRAME_ADDR(index)     (PAGES_PHYSICAL_START + ((index) << PTE_SHIFT))
+
+/*
+ * Physical address of the shared read-only zero page
+ */
+#define ZERO_PAGE_ADDR        LINADDR(frame_zero_page)
+
+extern frame_t frame_table[PAGES_POOL_MAX_NUM];
+extern uint32_t frame_zero_page[PTE_NUM];
+
+extern uint32_t frame_pool_num;
+extern uint32_t frame_free_num;
+extern uint32_t frame_user_num;
+extern uint32_t frame_user_max;
+extern uint32_t frame_zeroed_num;
+
+extern void frame_init(uint32_t pool_num);
+extern uint32_t frame_alloc_pages(uint32_t order);
+extern void frame_free_pages(uint32_t index);
+extern uint32_t frame_alloc(uint32_t virt_addr);
+extern void frame_free(uint32_t index);
+extern void frame_free_user(void);
+extern void frame_merge(uint32_t index);
+extern uint32_t frame_of_page(uint32_t virt_addr);
+extern void frame_zero_idle(void);
+
+#endif  /* _FRAME_H */
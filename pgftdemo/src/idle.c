@@ -0,0 +1,25 @@
+#include "pgftdemo.h"
+#include "frame.h"
+#include "pageout.h"
+#include "pgtable.h"
+#include "ksm.h"
+
+/**
+ * Background work of the paging system. Called by kgetc while it
+ * waits for input, so every call has to return quickly.
+ **/
+void
+idle_task()
+{
+    //Keep enough frames free for the fault path
+    pageout_run();
+
+    //Return page tables emptied by the page-out worker
+    pt_reclaim();
+
+    //Clear one free frame in advance
+    frame_zero_idle();
+
+    //Merge a few identical pages
+    ksm_scan();
+} // end of idle_task
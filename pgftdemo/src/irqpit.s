@@ -20,6 +20,8 @@
 #    +-----------------+
 #    |       EBP       |  <-- ebp
 #    +=================+
+#    |       FS        |  -4
+#    +-----------------+
 #
 #-----------------------------------------------------------------
 
@@ -55,6 +57,14 @@ irqPIT:
         # setup stack frame access via ebp
         #-----------------------------------------------------------
         enter   $0, $0
+        pushl   %fs
+
+        #-----------------------------------------------------------
+        # the interrupt stub loads FS with privDS, the counters are
+        # in the rom-bios data area
+        #-----------------------------------------------------------
+        mov     $sel_bs, %ax            # address rom-bios data
+        mov     %ax, %fs                #   using FS register
 
         #-----------------------------------------------------------
         # increment the 32-bit counter for timer-tick interrupts
@@ -92,6 +102,7 @@ irqPIT:
         mov     %eax, prevticks
         incl    ticks
 .Lskipupdate:
+        popl    %fs
         leave
         ret
 
@@ -33,6 +33,8 @@
 #    +-----------------+
 #    |       EBP       |  <-- ebp
 #    +-----------------+
+#    |  TSC (64 bit)   |   -8
+#    +-----------------+
 #-----------------------------------------------------------------
 
 #-----------------------------------------------------------------
@@ -69,15 +71,18 @@ pgftcnt:.long   0   # counts how many page faults have occured
         .extern     int_to_hex
         .extern     screen_write
         .extern     pfhandler
+        .extern     trace_fault
+        .extern     trace_verbose
+        .extern     read_tsc
         .code32
         .align   16
 #------------------------------------------------------------------
 isrPFE:
         #-----------------------------------------------------------
         # setup stack frame access via ebp and use edx to access
-        # caller stack frame
+        # caller stack frame, reserve space for the TSC
         #-----------------------------------------------------------
-        enter   $0, $0
+        enter   $8, $0
 
         #----------------------------------------------------------
         # setup data segment register
@@ -95,8 +100,14 @@ isrPFE:
         # update page fault counter
         #----------------------------------------------------------
         incl    (pgftcnt)
+        call    read_tsc                # start of fault handling
+        mov     %eax, -8(%ebp)
+        mov     %edx, -4(%ebp)
         testb   $1, 64(%ebp)            # pf caused by not present page?
-        jnz     .Lprotviol
+        jz      .Lpfe_handle
+        testb   $2, 64(%ebp)            # write to a present page, which
+        jz      .Lprotviol              # might be the shared zero page?
+.Lpfe_handle:
 
         mov     64(%ebp), %eax
         push    %eax
@@ -104,21 +115,45 @@ isrPFE:
         mov     %cr2, %eax              # faulting address
         pushl   %eax                    # push to stack for later use
         invlpg  %gs:(%eax)              # invalidate TLB
-        lea     pgftaddr, %edi
-        mov     $8, %ecx
-        call    int_to_hex
 
         call    pfhandler               # uses stack parameter pushed above
         add     $8, %esp
 
         mov     %eax, %ebx
+        mov     24(%ebx), %eax          # victim page address
+        invlpg  %gs:(%eax)              # invalidate TLB
+
+        #----------------------------------------------------------
+        # record fault in the trace ring
+        #----------------------------------------------------------
+        pushl   -4(%ebp)                # TSC at start of fault
+        pushl   -8(%ebp)
+        pushl   %ebx                    # result of pfhandler
+        pushl   64(%ebp)                # error code
+        pushl   68(%ebp)                # instruction addr
+        mov     %cr2, %eax              # faulting address
+        pushl   %eax
+        call    trace_fault
+        add     $24, %esp
+
+        #----------------------------------------------------------
+        # printing the fault costs more than handling it, so it
+        # can be switched off (monitor command V)
+        #----------------------------------------------------------
+        cmpl    $0, trace_verbose       # print fault?
+        je      .Lpfe_check             # no
+
+        mov     %cr2, %eax              # faulting address
+        lea     pgftaddr, %edi
+        mov     $8, %ecx
+        call    int_to_hex
+
         mov     16(%ebx), %eax          # get physical address
         lea     pgphaddr, %edi
         mov     $8, %ecx
         call    int_to_hex
 
         mov     24(%ebx), %eax          # victim page address
-        invlpg  %gs:(%eax)              # invalidate TLB
         lea     pgvicaddr, %edi
         mov     $8, %ecx
         call    int_to_hex
@@ -137,6 +172,7 @@ isrPFE:
         mov     $pgftmsg_len, %ecx      # message-length into ECX
         call    screen_write
 
+.Lpfe_check:
         #----------------------------------------------------------
         # check wheter the faulting address is now present. If not,
         # something went wrong within the page allocation function.
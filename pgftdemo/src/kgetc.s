@@ -7,6 +7,7 @@
         .type   kgetc, @function
         .global kgetc
         .extern screen_write
+        .extern idle_task
 kgetc:
         enter   $4, $0
         push    %ecx
@@ -14,9 +15,9 @@ kgetc:
         push    %esi
 
         lea     -4(%ebp), %esi          # allocate buffer on stack
-        mov     $1, %ecx                # buffer length
         # now await input from the remote PC
 .Lloop:
+        call    idle_task               # use waiting time for paging work
         mov     $0x3f8+5, %dx           # Line Status i/o-port
         #hlt
         in      %dx, %al                # poll the Line Status
@@ -35,6 +36,7 @@ kgetc:
         jb      .Lskipchar
 .Lwrite:
         mov     %al, (%esi)
+        mov     $1, %ecx                # buffer length (idle_task clobbers ecx)
         call    screen_write
 .Lskipchar:
 
@@ -0,0 +1,306 @@
+#include "ksm.h"
+#include "frame.h"
+#include "swap.h"
+#include "pgtable.h"
+#include "stat.h"
+
+extern int asm_printf(char *fmt, ...);
+
+//Pages are only scanned while merging is enabled
+uint32_t ksm_enabled = 0;
+
+//Merged frames, found by the hash of their content
+static ksm_frame_t ksm_frames[KSM_FRAMES_MAX];
+uint32_t ksm_frames_num = 0;
+
+//Pages of the current pass without a match, a later page with the
+//same content is merged with them
+static ksm_candidate_t ksm_candidates[KSM_CANDIDATES_MAX];
+static uint32_t ksm_candidates_num = 0;
+
+//Next page table entry to scan
+static uint32_t ksm_table = 0;
+static uint32_t ksm_entry = 0;
+
+//Swapped pages are loaded here to hash them
+static uint32_t ksm_scratch[PTE_NUM] __attribute__((aligned(PAGE_SIZE)));
+
+static void ksm_scan_entry(uint32_t *entry, uint32_t virt_addr);
+static uint32_t ksm_find(uint32_t crc, uint32_t *page);
+static uint32_t ksm_new(uint32_t virt_addr, uint32_t crc, uint32_t *page);
+static void ksm_merge(uint32_t *entry, uint32_t virt_addr, uint32_t index);
+static uint32_t *ksm_entry_of(uint32_t virt_addr);
+static uint32_t pages_equal(uint32_t *a, uint32_t *b);
+
+/**
+ * Forgets all merged frames and candidates, called when all pages are
+ * released. Detects the crc32 instruction for crc32_page
+ **/
+void
+ksm_init()
+{
+    check_cpuid();
+
+    ksm_frames_num = 0;
+    ksm_candidates_num = 0;
+    ksm_table = 0;
+    ksm_entry = 0;
+} // end of ksm_init
+
+/**
+ * Hashes the next KSM_SCAN_PAGES pages of the user page tables and
+ * merges them with identical pages. Called during idle time.
+ **/
+void
+ksm_scan()
+{
+    if (!ksm_enabled) {
+        return;
+    }
+
+    uint32_t scanned = 0;
+
+    while (scanned < KSM_SCAN_PAGES) {
+        //End of the page tables, start the next pass
+        if (ksm_table >= PT_INFO_MAX) {
+            ksm_table = 0;
+            ksm_candidates_num = 0;
+            return;
+        }
+
+        pt_info_t *info = &pt_info[ksm_table];
+        if (info->table == NULL || ksm_entry >= PTE_NUM) {
+            ksm_table++;
+            ksm_entry = 0;
+            continue;
+        }
+
+        uint32_t index = ksm_entry++;
+        if ((info->bitmap[index / 32] & (1U << (index % 32))) == 0) {
+            continue;
+        }
+
+        ksm_scan_entry(&info->table[index], JOIN_ADDR(info->pde, index));
+        scanned++;
+    }
+} // end of ksm_scan
+
+/**
+ * Returns 1 if the page table entry maps a merged frame
+ **/
+uint32_t
+ksm_is_merged(uint32_t entry)
+{
+    uint32_t phys = entry & PAGE_ADDR_MASK;
+
+    if ((entry & PAGE_IS_PRESENT) != PAGE_IS_PRESENT || phys < PAGES_PHYSICAL_START
+            || FRAME_INDEX(phys) >= frame_pool_num) {
+        return 0;
+    }
+    return (frame_table[FRAME_INDEX(phys)].flags & FRAME_IS_MERGED) == FRAME_IS_MERGED;
+} // end of ksm_is_merged
+
+/**
+ * Drops one mapping of the merged frame at phys after a page got its own
+ * copy on write. The frame is released with its last mapping.
+ **/
+void
+ksm_unmerge(uint32_t phys)
+{
+    uint32_t index = FRAME_INDEX(phys & PAGE_ADDR_MASK);
+
+    stat_number_ksm_unmerged++;
+
+    if (--frame_table[index].refs > 0) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < ksm_frames_num; i++) {
+        if (ksm_frames[i].frame == index) {
+            ksm_frames[i] = ksm_frames[--ksm_frames_num];
+            break;
+        }
+    }
+    frame_free_pages(index);
+} // end of ksm_unmerge
+
+/**
+ * Enables (1) or disables (0) the scanner. Merged pages stay merged
+ * until they are written.
+ **/
+void
+set_ksm(uint32_t enable)
+{
+    ksm_enabled = enable ? 1 : 0;
+    asm_printf("Same-page merging %s\r\n", ksm_enabled ? "enabled" : "disabled");
+} // end of set_ksm
+
+/**
+ * Merges the page of entry with an identical page, if there is one.
+ * Present pages are matched against merged frames and the candidates of
+ * this pass, swapped pages only against merged frames.
+ **/
+static void
+ksm_scan_entry(uint32_t *entry, uint32_t virt_addr)
+{
+    uint32_t phys = *entry & PAGE_ADDR_MASK;
+
+    if ((*entry & PAGE_IS_PRESENT) != PAGE_IS_PRESENT) {
+        if ((*entry & PAGE_IS_SWAPPED) != PAGE_IS_SWAPPED || ksm_frames_num == 0) {
+            return;
+        }
+
+        uint32_t slot = PTE_SWAP_SLOT(*entry);
+        swap_backend->read(slot, LINADDR(ksm_scratch));
+
+        uint32_t index = ksm_find(crc32_page(ksm_scratch), ksm_scratch);
+        if (index == INVALID_INDEX) {
+            return;
+        }
+
+        //The page is present again without taking a frame
+        pte_set(entry, FRAME_ADDR(index) | PAGE_IS_PRESENT | PAGE_IS_USER);
+        swap_slot_free(slot);
+        frame_table[index].refs++;
+        stat_number_ksm_merged++;
+        return;
+    }
+
+    //Only pages with a frame of their own are merged
+    if (phys < PAGES_PHYSICAL_START || FRAME_INDEX(phys) >= frame_pool_num
+            || (frame_table[FRAME_INDEX(phys)].flags & FRAME_IS_USER) != FRAME_IS_USER) {
+        return;
+    }
+
+    uint32_t *page = LOGADDR(phys);
+    uint32_t crc = crc32_page(page);
+
+    uint32_t index = ksm_find(crc, page);
+    if (index == INVALID_INDEX) {
+        for (uint32_t i = 0; i < ksm_candidates_num; i++) {
+            if (ksm_candidates[i].crc != crc || ksm_candidates[i].virt_addr == virt_addr) {
+                continue;
+            }
+            index = ksm_new(ksm_candidates[i].virt_addr, crc, page);
+            if (index != INVALID_INDEX) {
+                ksm_candidates[i] = ksm_candidates[--ksm_candidates_num];
+                break;
+            }
+        }
+    }
+
+    if (index != INVALID_INDEX) {
+        ksm_merge(entry, virt_addr, index);
+    } else if (ksm_candidates_num < KSM_CANDIDATES_MAX) {
+        ksm_candidates[ksm_candidates_num].crc = crc;
+        ksm_candidates[ksm_candidates_num].virt_addr = virt_addr;
+        ksm_candidates_num++;
+    }
+} // end of ksm_scan_entry
+
+/**
+ * Returns the merged frame holding the same content as page, or
+ * INVALID_INDEX. Frames with the same hash are compared byte by byte.
+ **/
+static uint32_t
+ksm_find(uint32_t crc, uint32_t *page)
+{
+    for (uint32_t i = 0; i < ksm_frames_num; i++) {
+        uint32_t index = ksm_frames[i].frame;
+        if (ksm_frames[i].crc == crc && pages_equal(LOGADDR(FRAME_ADDR(index)), page)) {
+            return index;
+        }
+    }
+    return INVALID_INDEX;
+} // end of ksm_find
+
+/**
+ * Turns the frame of the candidate page at virt_addr into a merged frame
+ * if the page is still present and identical to page. Returns the index
+ * of the merged frame, or INVALID_INDEX.
+ **/
+static uint32_t
+ksm_new(uint32_t virt_addr, uint32_t crc, uint32_t *page)
+{
+    if (ksm_frames_num >= KSM_FRAMES_MAX) {
+        return INVALID_INDEX;
+    }
+
+    //The candidate may have been replaced or written since its scan
+    uint32_t *entry = ksm_entry_of(virt_addr);
+    uint32_t index = frame_of_page(virt_addr);
+    if (entry == NULL || index == INVALID_INDEX
+            || (frame_table[index].flags & FRAME_IS_USER) != FRAME_IS_USER
+            || !pages_equal(LOGADDR(FRAME_ADDR(index)), page)) {
+        return INVALID_INDEX;
+    }
+
+    (*algo_remove_page)(virt_addr);
+    if (frame_table[index].swap_slot != INVALID_INDEX) {
+        swap_slot_free(frame_table[index].swap_slot);
+    }
+    frame_merge(index);
+
+    pte_set(entry, FRAME_ADDR(index) | PAGE_IS_PRESENT | PAGE_IS_USER);
+    invalidate_addr(virt_addr);
+
+    ksm_frames[ksm_frames_num].crc = crc;
+    ksm_frames[ksm_frames_num].frame = index;
+    ksm_frames_num++;
+    stat_number_ksm_merged++;
+
+    return index;
+} // end of ksm_new
+
+/**
+ * Maps the present page of entry to the merged frame index read-only
+ * and releases its own frame
+ **/
+static void
+ksm_merge(uint32_t *entry, uint32_t virt_addr, uint32_t index)
+{
+    uint32_t frame = FRAME_INDEX(*entry & PAGE_ADDR_MASK);
+
+    (*algo_remove_page)(virt_addr);
+    if (frame_table[frame].swap_slot != INVALID_INDEX) {
+        swap_slot_free(frame_table[frame].swap_slot);
+    }
+
+    pte_set(entry, FRAME_ADDR(index) | PAGE_IS_PRESENT | PAGE_IS_USER);
+    invalidate_addr(virt_addr);
+    frame_free(frame);
+
+    frame_table[index].refs++;
+    stat_number_ksm_merged++;
+} // end of ksm_merge
+
+/**
+ * Returns the page table entry of virt_addr, or NULL if its page table
+ * does not exist
+ **/
+static uint32_t *
+ksm_entry_of(uint32_t virt_addr)
+{
+    uint32_t *page_directory = get_page_dir_addr();
+    uint32_t pde_entry = page_directory[PDE(virt_addr)];
+
+    if ((pde_entry & (PAGE_IS_PRESENT | PAGE_IS_USER)) != (PAGE_IS_PRESENT | PAGE_IS_USER)) {
+        return NULL;
+    }
+    uint32_t *page_table = LOGADDR(pde_entry & PAGE_ADDR_MASK);
+    return &page_table[PTE(virt_addr)];
+} // end of ksm_entry_of
+
+/**
+ * Returns 1 if the pages at the logical addresses a and b are identical
+ **/
+static uint32_t
+pages_equal(uint32_t *a, uint32_t *b)
+{
+    for (uint32_t i = 0; i < PTE_NUM; i++) {
+        if (a[i] != b[i]) {
+            return 0;
+        }
+    }
+    return 1;
+} // end of pages_equal
@@ -0,0 +1,38 @@
+#ifndef _KSM_H
+#define _KSM_H          1
+
+#include "pgftdemo.h"
+
+#define KSM_FRAMES_MAX                64    // merged frames at the same time
+#define KSM_CANDIDATES_MAX           128    // unmatched pages remembered per pass
+#define KSM_SCAN_PAGES                 4    // pages hashed per idle call
+
+/*
+ * A merged frame, its content never changes while it is mapped
+ */
+typedef struct {
+    uint32_t crc;               // hash of the content
+    uint32_t frame;             // index in the frame table
+} ksm_frame_t;
+
+/*
+ * A page hashed in the current pass that matched no merged frame
+ */
+typedef struct {
+    uint32_t crc;               // hash of the content when it was scanned
+    uint32_t virt_addr;         // address of the page
+} ksm_candidate_t;
+
+extern uint32_t ksm_enabled;
+extern uint32_t ksm_frames_num;
+
+extern uint32_t crc32_page(uint32_t *page);
+extern void check_cpuid(void);
+
+extern void ksm_init(void);
+extern void ksm_scan(void);
+extern uint32_t ksm_is_merged(uint32_t entry);
+extern void ksm_unmerge(uint32_t phys);
+extern void set_ksm(uint32_t enable);
+
+#endif  /* _KSM_H */
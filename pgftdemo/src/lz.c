@@ -0,0 +1,199 @@
+#include "lz.h"
+
+/*
+ * Byte oriented LZ77 codec in the style of the LZ4 block format. The
+ * input is a list of sequences, each made of
+ *   token      - literal count (high nibble), match length - 4 (low nibble),
+ *                a nibble of 15 is continued by bytes up to a byte != 255
+ *   literals   - bytes copied unchanged
+ *   offset     - 16 bit little endian distance of the match
+ * The last sequence only holds literals.
+ */
+
+//Last position + 1 of each hashed 4-byte sequence, 0 if none
+static uint16_t lz_table[1 << LZ_HASH_BITS];
+
+static uint32_t
+lz_read32(uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t
+lz_hash(uint32_t v)
+{
+    return (v * 2654435761U) >> (32 - LZ_HASH_BITS);
+}
+
+/**
+ * Appends the extra length bytes of a nibble of 15. Returns 0 if dst
+ * is full.
+ **/
+static uint32_t
+lz_put_length(uint8_t *dst, uint32_t *op, uint32_t max, uint32_t len)
+{
+    for (len -= 15; len >= 255; len -= 255) {
+        if (*op >= max) {
+            return 0;
+        }
+        dst[(*op)++] = 255;
+    }
+    if (*op >= max) {
+        return 0;
+    }
+    dst[(*op)++] = len;
+    return 1;
+}
+
+/**
+ * Appends a sequence of lit_len literals followed by a match of
+ * match_len bytes at distance offset, match_len 0 ends the output.
+ * Returns 0 if dst is full.
+ **/
+static uint32_t
+lz_put_sequence(uint8_t *dst, uint32_t *op, uint32_t max, uint8_t *lit,
+                uint32_t lit_len, uint32_t offset, uint32_t match_len)
+{
+    uint32_t ml = match_len ? match_len - LZ_MIN_MATCH : 0;
+
+    if (*op >= max) {
+        return 0;
+    }
+    dst[(*op)++] = ((lit_len < 15 ? lit_len : 15) << 4) | (ml < 15 ? ml : 15);
+    if (lit_len >= 15 && !lz_put_length(dst, op, max, lit_len)) {
+        return 0;
+    }
+
+    if (*op + lit_len > max) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < lit_len; i++) {
+        dst[(*op)++] = lit[i];
+    }
+
+    if (match_len == 0) {
+        return 1;
+    }
+
+    if (*op + 2 > max) {
+        return 0;
+    }
+    dst[(*op)++] = offset;
+    dst[(*op)++] = offset >> 8;
+    if (ml >= 15 && !lz_put_length(dst, op, max, ml)) {
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Compresses len bytes at src into dst. Returns the compressed size,
+ * or 0 if it would exceed max bytes.
+ **/
+uint32_t
+lz_compress(uint8_t *src, uint32_t len, uint8_t *dst, uint32_t max)
+{
+    uint32_t ip = 0;
+    uint32_t anchor = 0;
+    uint32_t op = 0;
+
+    for (uint32_t i = 0; i < (1 << LZ_HASH_BITS); i++) {
+        lz_table[i] = 0;
+    }
+
+    while (ip + LZ_MIN_MATCH <= len) {
+        uint32_t seq = lz_read32(src + ip);
+        uint32_t h = lz_hash(seq);
+        uint32_t ref = lz_table[h];
+        lz_table[h] = ip + 1;
+
+        if (ref == 0 || ip - (ref - 1) > LZ_MAX_OFFSET || lz_read32(src + ref - 1) != seq) {
+            ip++;
+            continue;
+        }
+        ref--;
+
+        uint32_t match_len = LZ_MIN_MATCH;
+        while (ip + match_len < len && src[ref + match_len] == src[ip + match_len]) {
+            match_len++;
+        }
+
+        if (!lz_put_sequence(dst, &op, max, src + anchor, ip - anchor, ip - ref, match_len)) {
+            return 0;
+        }
+        ip += match_len;
+        anchor = ip;
+    }
+
+    if (!lz_put_sequence(dst, &op, max, src + anchor, len - anchor, 0, 0)) {
+        return 0;
+    }
+    return op;
+} // end of lz_compress
+
+/**
+ * Decompresses len bytes at src into dst. Returns the decompressed
+ * size, or 0 if the input is corrupt or exceeds max bytes.
+ **/
+uint32_t
+lz_decompress(uint8_t *src, uint32_t len, uint8_t *dst, uint32_t max)
+{
+    uint32_t ip = 0;
+    uint32_t op = 0;
+
+    while (ip < len) {
+        uint32_t token = src[ip++];
+        uint32_t b;
+
+        uint32_t lit_len = token >> 4;
+        if (lit_len == 15) {
+            do {
+                if (ip >= len) {
+                    return 0;
+                }
+                b = src[ip++];
+                lit_len += b;
+            } while (b == 255);
+        }
+
+        if (ip + lit_len > len || op + lit_len > max) {
+            return 0;
+        }
+        for (uint32_t i = 0; i < lit_len; i++) {
+            dst[op++] = src[ip++];
+        }
+
+        //Last sequence has no match
+        if (ip == len) {
+            break;
+        }
+
+        if (ip + 2 > len) {
+            return 0;
+        }
+        uint32_t offset = src[ip] | (src[ip + 1] << 8);
+        ip += 2;
+
+        uint32_t match_len = token & 0x0f;
+        if (match_len == 15) {
+            do {
+                if (ip >= len) {
+                    return 0;
+                }
+                b = src[ip++];
+                match_len += b;
+            } while (b == 255);
+        }
+        match_len += LZ_MIN_MATCH;
+
+        if (offset == 0 || offset > op || op + match_len > max) {
+            return 0;
+        }
+        //Copy byte by byte, the match may overlap its own output
+        for (uint32_t i = 0; i < match_len; i++, op++) {
+            dst[op] = dst[op - offset];
+        }
+    }
+
+    return op;
+} // end of lz_decompress
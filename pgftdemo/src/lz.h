@@ -0,0 +1,13 @@
+#ifndef _LZ_H
+#define _LZ_H           1
+
+#include "types.h"
+
+#define LZ_MIN_MATCH                   4    // shortest match encoded
+#define LZ_HASH_BITS                  12    // size of the match finder table
+#define LZ_MAX_OFFSET             0xffff
+
+extern uint32_t lz_compress(uint8_t *src, uint32_t len, uint8_t *dst, uint32_t max);
+extern uint32_t lz_decompress(uint8_t *src, uint32_t len, uint8_t *dst, uint32_t max);
+
+#endif  /* _LZ_H */
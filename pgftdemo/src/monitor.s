@@ -17,6 +17,15 @@ hlpmsg: .ascii  "Monitor Commands:\r\n"
         .ascii  "  A           - Reset all accessed bits in page table\r\n"
         .ascii  "  S           - Print various statistics\r\n"
         .ascii  "  L ALGO      - Change algo to number ALGO\r\n"
+        .ascii  "  N NUM       - Use NUM frames for user pages (0 = all)\r\n"
+        .ascii  "  Z FLAG      - Map shared zero page on read faults (1 = on)\r\n"
+        .ascii  "  O FLAGS     - Clustered page-in: 1 = read-ahead, 2 = zero-around\r\n"
+        .ascii  "  K LOW HIGH  - Page-out free-frame watermarks (HIGH 0 = off)\r\n"
+        .ascii  "  G FLAG      - Page-fault-frequency frame allowances per region (1 = on)\r\n"
+        .ascii  "  U FLAG      - Merge identical pages during idle time (1 = on)\r\n"
+        .ascii  "  B DEV       - Swap device: 0 = RAM, 1 = ATA disk, 2 = compressed RAM\r\n"
+        .ascii  "  V FLAG      - Print every page fault (1 = on)\r\n"
+        .ascii  "  T NUM       - Show last NUM recorded page faults (0 = summary)\r\n"
         .ascii  "  D ADDR NUM  - Dump NUM words beginning at address ADDR\r\n"
         .ascii  "  X ADDR NUM  - Calculate CRC32 for NUM words starting at address ADDR\r\n"
         .ascii  "  P ADDR      - Invalidate TLB entry for virtual address ADDR\r\n"
@@ -60,6 +69,16 @@ mon_addr:
         .extern clearAllAccessedBits
         .extern stat_print
         .extern select_paging_algorithm
+        .extern set_user_frames
+        .extern set_zero_page
+        .extern set_cluster_flags
+        .extern set_pageout_watermarks
+        .extern set_pff
+        .extern set_ksm
+        .extern region_print
+        .extern set_swap_backend
+        .extern set_trace_verbose
+        .extern trace_dump
 run_monitor:
         enter   $260, $0
         pushal
@@ -117,6 +136,24 @@ run_monitor:
         je      .Lreadaddr
         cmpb    $'L', %al
         je      .Lchangealgo
+        cmpb    $'N', %al
+        je      .Lsetframes
+        cmpb    $'Z', %al
+        je      .Lsetzeropage
+        cmpb    $'O', %al
+        je      .Lsetcluster
+        cmpb    $'K', %al
+        je      .Lsetwatermarks
+        cmpb    $'G', %al
+        je      .Lsetpff
+        cmpb    $'U', %al
+        je      .Lsetksm
+        cmpb    $'B', %al
+        je      .Lsetbackend
+        cmpb    $'V', %al
+        je      .Lsetverbose
+        cmpb    $'T', %al
+        je      .Ltracedump
         cmpb    $'X', %al
         je      .Lcrcaddr
         cmpb    $'D', %al
@@ -151,6 +188,83 @@ run_monitor:
         call    select_paging_algorithm
         jmp     .Lloop
 
+.Lsetframes:
+        incl    %esi
+        call    hex2int
+        push    %eax
+        call    set_user_frames
+        addl    $4, %esp
+        jmp     .Lloop
+
+.Lsetzeropage:
+        incl    %esi
+        call    hex2int
+        push    %eax
+        call    set_zero_page
+        addl    $4, %esp
+        jmp     .Lloop
+
+.Lsetcluster:
+        incl    %esi
+        call    hex2int
+        push    %eax
+        call    set_cluster_flags
+        addl    $4, %esp
+        jmp     .Lloop
+
+.Lsetwatermarks:
+        incl    %esi
+        subl    $8, %esp
+        # read low watermark
+        call    hex2int
+        movl    %eax, (%esp)
+        # read high watermark
+        call    hex2int
+        movl    %eax, 4(%esp)
+        call    set_pageout_watermarks
+        addl    $8, %esp
+        jmp     .Lloop
+
+.Lsetbackend:
+        incl    %esi
+        call    hex2int
+        push    %eax
+        call    set_swap_backend
+        addl    $4, %esp
+        jmp     .Lloop
+
+.Lsetverbose:
+        incl    %esi
+        call    hex2int
+        push    %eax
+        call    set_trace_verbose
+        addl    $4, %esp
+        jmp     .Lloop
+
+.Lsetpff:
+        incl    %esi
+        call    hex2int
+        push    %eax
+        call    set_pff
+        addl    $4, %esp
+        jmp     .Lloop
+
+.Lsetksm:
+        incl    %esi
+        call    hex2int
+        push    %eax
+        call    set_ksm
+        addl    $4, %esp
+        jmp     .Lloop
+
+.Ltracedump:
+        incl    %esi
+        call    hex2int
+        push    %eax
+        call    trace_dump
+        addl    $4, %esp
+        jmp     .Lloop
+
         #----------------------------------------------------------
         # write to address
         #----------------------------------------------------------
@@ -307,6 +421,7 @@ mon_inst_rd_addr:
         jmp     .Lloop
 .Lprintstat:
         call    stat_print
+        call    region_print
         jmp     .Lloop
 .Lmonitor_exit:
         popl    %gs
@@ -378,14 +493,16 @@ print_mapped_pages:
         movl    %cr3, %esi
         # segmented page directory address
         subl    $LD_DATA_START, %esi
-        # ignore first table table, which contains kernel pages
-        movl    $1, %ecx
+        xorl    %ecx, %ecx
 .Lpdeloop:
         # read page directory entry (PDE)
         movl    (%esi,%ecx,4), %ebx
         # check present bit
         testl   $1, %ebx
         jz      .Lskippde
+        # ignore page tables without user bit, which map kernel pages
+        testl   $4, %ebx
+        jz      .Lskippde
         # save PDE index
         movl    %ecx, -4(%ebp)
         xorl    %ecx, %ecx
@@ -526,13 +643,12 @@ get_page_addr:
 
         # get page directory entry
         shrl    $22, %edx
-        # PDE #0 is reserved for the Kernel
-        testl   %edx, %edx
-        jz      .Lget_page_addr_end
-
         movl    (%esi,%edx,4), %esi
         testl   $1, %esi
         jz      .Lget_page_addr_end
+        # page tables without user bit are reserved for the Kernel
+        testl   $4, %esi
+        jz      .Lget_page_addr_end
 
         movl    -4(%ebp), %edx
         shrl    $12, %edx
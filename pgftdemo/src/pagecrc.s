@@ -0,0 +1,55 @@
+
+#==================================================================
+# S E C T I O N   T E X T
+#==================================================================
+        .section        .text
+
+
+#-------------------------------------------------------------------
+# FUNCTION:   crc32_page
+#
+# PURPOSE:    hash the contents of a page. With SSE4.2 the hash is
+#             the CRC32C computed by the crc32 instruction, as for
+#             the monitor command X. Otherwise the dwords are mixed
+#             by rotate and xor, which is good enough to find
+#             candidates that are compared byte by byte afterwards.
+#             ksm_init detects SSE4.2 once by check_cpuid
+#
+# C Call:     uint32_t crc32_page(uint32_t *page)
+#
+# PARAMETERS: logical address of the page (data segment)
+#
+# RETURN:     EAX - hash of the page
+#
+#-------------------------------------------------------------------
+        .type   crc32_page, @function
+        .global crc32_page
+        .extern cpuid_sse42_avail
+crc32_page:
+        enter   $0, $0
+        push    %esi
+
+        movl    8(%ebp), %esi
+        xorl    %ecx, %ecx
+        xorl    %eax, %eax
+        decl    %eax
+        cmpb    $1, cpuid_sse42_avail
+        jne     .Lmixloop
+.Lcrc32loop:
+        crc32l  (%esi,%ecx,4), %eax
+        incl    %ecx
+        cmpl    $1024, %ecx
+        jb      .Lcrc32loop
+        jmp     .Lcrc32done
+.Lmixloop:
+        roll    $5, %eax
+        xorl    (%esi,%ecx,4), %eax
+        incl    %ecx
+        cmpl    $1024, %ecx
+        jb      .Lmixloop
+.Lcrc32done:
+        xorl    $0xffffffff, %eax
+
+        pop     %esi
+        leave
+        ret
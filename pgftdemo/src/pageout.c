@@ -0,0 +1,139 @@
+#include "pageout.h"
+#include "frame.h"
+#include "stat.h"
+
+extern int asm_printf(char *fmt, ...);
+
+//Free-frame watermarks, the page-out worker is disabled if high is 0
+uint32_t pageout_low = 0;
+uint32_t pageout_high = 0;
+
+static uint32_t free_user_frames(void);
+static uint32_t is_page_dirty(uint32_t virt_addr);
+
+/**
+ * Page-out worker, called during idle time and by the fault path, which
+ * runs without idle time in between while one command touches many
+ * pages. If fewer than pageout_low user frames are free, pages are
+ * evicted until pageout_high frames are free. Victims are taken from the replacement algorithm in batches:
+ * clean victims are evicted at once, dirty victims are written back
+ * together and only evicted if still needed, otherwise they stay
+ * resident as clean pages.
+ **/
+void
+pageout_run()
+{
+    if (pageout_high == 0 || free_user_frames() >= pageout_low) {
+        return;
+    }
+
+    stat_number_pageout_runs++;
+
+    while (free_user_frames() < pageout_high) {
+        uint32_t dirty[PAGEOUT_BATCH];
+        uint32_t dirty_num = 0;
+        uint32_t evicted = 0;
+
+        //Collect a batch of victims, evict the clean ones right away
+        for (uint32_t i = 0; i < PAGEOUT_BATCH; i++) {
+            if (free_user_frames() >= pageout_high || frame_user_num <= dirty_num) {
+                break;
+            }
+
+            uint32_t victim = get_address_of_page_to_replace();
+            if (victim == INVALID_ADDR) {
+                break;
+            }
+
+            //The faulting page pinned by read-ahead stays resident
+            if (victim == pinned_page) {
+                (*algo_new_page_in_ram)(victim);
+                continue;
+            }
+
+            if (is_page_dirty(victim)) {
+                dirty[dirty_num++] = victim;
+            } else {
+                swap(victim);
+                stat_number_pageout++;
+                evicted++;
+            }
+        }
+
+        //Write the dirty victims back in one go
+        uint32_t written = 0;
+        for (uint32_t i = 0; i < dirty_num; i++) {
+            if (write_back(dirty[i]) == INVALID_INDEX) {
+                break;
+            }
+            stat_number_pageout_written++;
+            written++;
+        }
+
+        //Evict them if frames are still missing, keep them otherwise
+        for (uint32_t i = 0; i < dirty_num; i++) {
+            if (i < written && free_user_frames() < pageout_high) {
+                swap(dirty[i]);
+                stat_number_pageout++;
+                evicted++;
+            } else {
+                (*algo_new_page_in_ram)(dirty[i]);
+            }
+        }
+
+        //Stop if nothing could be evicted, e.g. swap is full
+        if (evicted == 0) {
+            break;
+        }
+    }
+} // end of pageout_run
+
+/**
+ * Sets the free-frame watermarks of the page-out worker, a high
+ * watermark of 0 disables it.
+ **/
+void
+set_pageout_watermarks(uint32_t low, uint32_t high)
+{
+    if (high >= frame_user_max) {
+        high = frame_user_max - 1;
+    }
+    if (low > high) {
+        low = high;
+    }
+
+    pageout_low = low;
+    pageout_high = high;
+    asm_printf("Page-out watermarks: low %d, high %d\r\n", pageout_low, pageout_high);
+} // end of set_pageout_watermarks
+
+/**
+ * Returns the number of frames that can be used for user pages without
+ * replacing a page.
+ **/
+static uint32_t
+free_user_frames()
+{
+    uint32_t free = 0;
+
+    if (frame_user_max > frame_user_num) {
+        free = frame_user_max - frame_user_num;
+    }
+    if (free > frame_free_num) {
+        free = frame_free_num;
+    }
+
+    return free;
+} // end of free_user_frames
+
+/**
+ * Returns 1 if the present page at virt_addr was modified
+ **/
+static uint32_t
+is_page_dirty(uint32_t virt_addr)
+{
+    uint32_t *page_directory = get_page_dir_addr();
+    uint32_t *page_table = LOGADDR(page_directory[PDE(virt_addr)] & PAGE_ADDR_MASK);
+
+    return (page_table[PTE(virt_addr)] & PAGE_IS_DIRTY) == PAGE_IS_DIRTY;
+} // end of is_page_dirty
@@ -0,0 +1,14 @@
+#ifndef _PAGEOUT_H
+#define _PAGEOUT_H      1
+
+#include "pgftdemo.h"
+
+#define PAGEOUT_BATCH                  8    // victims written back together
+
+extern uint32_t pageout_low;
+extern uint32_t pageout_high;
+
+extern void pageout_run(void);
+extern void set_pageout_watermarks(uint32_t low, uint32_t high);
+
+#endif  /* _PAGEOUT_H */
@@ -7,6 +7,37 @@
         .equ            PG_PRESENT,      1
         .equ            PG_RW,           2
         .equ            PG_USR,          4
+        .equ            PG_LARGE,     0x80     # 4 MiB page (PDE)
+        .equ            PG_GLOBAL,   0x100     # kept on CR3 reloads
+        .equ            PG_ADDR_MASK, 0xfffff000
+
+        #----------------------------------------------------------
+        # CPUID function 1 feature flags in EDX and the control
+        # register 4 bits enabling them
+        #----------------------------------------------------------
+        .equ            CPUID_PSE,  (1<<3)
+        .equ            CPUID_PGE,  (1<<13)
+        .equ            CR4_PSE,    (1<<4)
+        .equ            CR4_PGE,    (1<<7)
+
+        #----------------------------------------------------------
+        # number of kernel page tables, which map the first 16 MiB
+        # 1:1 (kernel, frame pool and swap area)
+        #----------------------------------------------------------
+        .equ            PT_KERNEL_NUM,   4
+
+
+#==================================================================
+# S E C T I O N   D A T A
+#==================================================================
+        .section        .data
+
+        .align  4
+        #----------------------------------------------------------
+        # PG_GLOBAL if the CPU supports global pages, otherwise 0
+        #----------------------------------------------------------
+pg_global:
+        .long   0
 
 
 #==================================================================
@@ -14,9 +45,10 @@
 #==================================================================
         .section        .bss
 
-        .align PG_SIZE
-        .comm  page_dir, PG_SIZE
-        .comm  page_table_kernel, PG_SIZE
+        # common symbols ignore .align, CR3 and the PDEs need the
+        # page alignment given as third argument
+        .comm  page_dir, PG_SIZE, PG_SIZE
+        .comm  page_table_kernel, PG_SIZE*PT_KERNEL_NUM, PG_SIZE
 
 
 #==================================================================
@@ -32,6 +64,8 @@
         .extern         LD_IMAGE_START
         .extern         _rodata        # start of .rodata segment
         .extern         _bss           # start of .bss segment
+        .extern         check_cpuid
+        .extern         cpuid_features_edx
 
 
 #-------------------------------------------------------------------
@@ -63,6 +97,16 @@ enable_paging:
         push    %ecx
         push    %edx
 
+        #----------------------------------------------------------
+        # kernel mappings are global if the CPU supports it, so
+        # reloading CR3 keeps their TLB entries
+        #----------------------------------------------------------
+        call    check_cpuid
+        testl   $CPUID_PGE, cpuid_features_edx
+        jz      .Lnopge
+        movl    $PG_GLOBAL, pg_global
+.Lnopge:
+
         #----------------------------------------------------------
         # initialise page directory entries to zero
         #----------------------------------------------------------
@@ -123,21 +167,51 @@ enable_paging:
 .Lpgrw:
         mov     $PG_PRESENT+PG_RW, %dl
 .Lpgmap:
+        or      pg_global, %edx         # global page if supported
         movl    %edx, (%ebx,%ecx,4)
-        xor     %dl, %dl
+        and     $PG_ADDR_MASK, %edx
         inc     %ecx
         add     $PG_SIZE, %edx
-        cmp     $PG_SIZE/4, %ecx
+        cmp     $PT_KERNEL_NUM*PG_SIZE/4, %ecx
         jb      .Lpgtableloop
 
         #----------------------------------------------------------
-        # convert logical kernel page table addess in EBX to a
-        # linear address and write this address into PDE #0
+        # convert logical kernel page table addesses in EBX to
+        # linear addresses and write them into PDE #0 and up
         #----------------------------------------------------------
         mov     $page_dir, %eax
         add     $LD_DATA_START, %ebx    # add .data start address
         or      $PG_PRESENT+PG_RW, %ebx
-        mov     %ebx, (%eax)            # eax: page dir address
+        xor     %ecx, %ecx
+.Lpgdirkernel:
+        mov     %ebx, (%eax,%ecx,4)     # eax: page dir address
+        add     $PG_SIZE, %ebx
+        inc     %ecx
+        cmp     $PT_KERNEL_NUM, %ecx
+        jb      .Lpgdirkernel
+
+        #----------------------------------------------------------
+        # with PSE, the kernel page tables above the first one are
+        # replaced by 4 MiB pages. The first 4 MiB keep 4 KiB pages,
+        # so the text segment stays read-only
+        #----------------------------------------------------------
+        testl   $CPUID_PSE, cpuid_features_edx
+        jz      .Lnopse
+        mov     $1, %ecx
+.Lpgdirlarge:
+        mov     %ecx, %ebx
+        shl     $22, %ebx               # physical address of page
+        or      $PG_PRESENT+PG_RW+PG_LARGE, %ebx
+        or      pg_global, %ebx
+        mov     %ebx, (%eax,%ecx,4)
+        inc     %ecx
+        cmp     $PT_KERNEL_NUM, %ecx
+        jb      .Lpgdirlarge
+
+        mov     %cr4, %ebx
+        or      $CR4_PSE, %ebx
+        mov     %ebx, %cr4
+.Lnopse:
 
         #----------------------------------------------------------
         # setup page-directory address in control register CR3
@@ -153,6 +227,16 @@ enable_paging:
         mov     %eax, %cr0
         jmp     .+2                     # flush prefetch queue
 
+        #----------------------------------------------------------
+        # enable global pages once paging is on
+        #----------------------------------------------------------
+        cmpl    $0, pg_global
+        je      .Lpgdone
+        mov     %cr4, %eax
+        or      $CR4_PGE, %eax
+        mov     %eax, %cr4
+.Lpgdone:
+
         pop     %edx
         pop     %ecx
         pop     %ebx
@@ -261,6 +345,31 @@ invalidate_addr:
         ret
 
 
+#-------------------------------------------------------------------
+# FUNCTION:   flush_tlb
+#
+# PURPOSE:    Invalidates all non-global TLB entries by reloading CR3
+#
+# C Call:     void flush_tlb(void)
+#
+# PARAMETERS: none
+#
+# RETURN:     none
+#
+#-------------------------------------------------------------------
+        .type           flush_tlb, @function
+        .globl          flush_tlb
+flush_tlb:
+        enter   $0, $0
+        push    %eax
+
+        mov     %cr3, %eax
+        mov     %eax, %cr3
+
+        pop     %eax
+        leave
+        ret
+
 #-------------------------------------------------------------------
 # FUNCTION:   is_page_present
 #
@@ -297,6 +406,13 @@ is_page_present:
         test    $1, %esi
         jz      .Lend
 
+        # a 4 MiB page has no page table
+        test    $PG_LARGE, %esi
+        jz      .Lsmallpage
+        mov     $1, %eax
+        jmp     .Lend
+.Lsmallpage:
+
         # load linear address from stack
         mov     8(%ebp), %edx
         # mask paging flags
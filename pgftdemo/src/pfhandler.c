@@ -1,5 +1,12 @@
 #include "pgftdemo.h"
 #include "stat.h"
+#include "frame.h"
+#include "swap.h"
+#include "readahead.h"
+#include "pgtable.h"
+#include "region.h"
+#include "ksm.h"
+#include "pageout.h"
 
 //Include paging algorithms
 #include "algo_fifo.h"
@@ -8,40 +15,42 @@
 
 extern int asm_printf(char *fmt, ...);
 
+//Memory sizes detected by the boot code: KB below 1MB, KB between
+//1MB and 16MB, 64KB blocks above 16MB
+extern uint16_t memsizes[3];
+
 
 //Create Page Tables for program and stack
 uint32_t page_table_program[PTE_NUM]   __attribute__((aligned(PAGE_SIZE)));
 uint32_t page_table_stack[PTE_NUM]     __attribute__((aligned(PAGE_SIZE)));
 
-//Indices for pages in physical memory/storage
-uint32_t physical_pages_index[PAGES_PHYSICAL_NUM];
-uint32_t storage_pages_index[PAGES_SWAPPED_NUM];
-
 //Structure for returning from pfhandler()
 static pg_struct_t pg_struct;
 
+//Map the shared zero page on read faults of untouched pages
+static uint32_t zero_page_enabled = 0;
+
+//Page that is never chosen as victim, set while pages are read ahead
+//for a fault so the faulting page stays present
+uint32_t pinned_page = INVALID_ADDR;
+
 //Memory functions
-uint32_t get_page_frame(uint32_t virt_addr);
+uint32_t get_page_frame(uint32_t virt_addr, uint32_t clear);
+uint32_t *get_page_table(uint32_t pde);
+uint32_t get_region_victim(uint32_t virt_addr);
 void free_all_pages();
 void clear_all_accessed_bits();
 void copy_page(uint32_t, uint32_t);
 void clear_page(uint32_t);
 
-//Index functions
-uint32_t index_memory_add(uint32_t addr);
-void index_memory_remove(uint32_t addr);
-uint32_t index_memory_is_present(uint32_t addr);
-
-uint32_t index_storage_add(uint32_t addr);
-void index_storage_remove(uint32_t addr);
-uint32_t index_storage_get_physical_address(uint32_t addr);
-
 //Disk functions
+uint32_t write_back(uint32_t virt_address);
 uint32_t swap(uint32_t virtAddr);
 
 //Functions of external paging algorithm
 uint32_t (*algo_get_address_of_page_to_replace)();
 void (*algo_new_page_in_ram)(uint32_t addr);
+void (*algo_remove_page)(uint32_t addr);
 void (*algo_init)();
 
 
@@ -63,12 +72,12 @@ pfhandler(uint32_t ft_addr, uint32_t error_code)
     int pde = PDE(ft_addr);
     int pte = PTE(ft_addr);
 
-    //TODO: fix me!
-    if(error_code & 0x00000002) {
+    if(error_code & PGFT_ERR_WRITE) {
         stat_number_pgft_write++;
     } else {
         stat_number_pgft_read++;
     }
+    region_fault(ft_addr);
 
     pg_struct.pde = pde;
     pg_struct.pte = pte;
@@ -79,9 +88,15 @@ pfhandler(uint32_t ft_addr, uint32_t error_code)
 
     //Get address of page directory with kernel call
     uint32_t *page_directory = get_page_dir_addr();
+
+    //First fault in a 4 MiB region of the user address range, the
+    //region gets a page table from the frame pool
+    if (pde >= FIRST_PDE_INDEX && (page_directory[pde] & PAGE_IS_PRESENT) != PAGE_IS_PRESENT) {
+        get_page_table(pde);
+    }
     
-    //If corresponding page table exists
-    if ((page_directory[pde] & PAGE_IS_PRESENT) == PAGE_IS_PRESENT) {
+    //If corresponding user page table exists
+    if ((page_directory[pde] & (PAGE_IS_PRESENT | PAGE_IS_USER)) == (PAGE_IS_PRESENT | PAGE_IS_USER)) {
 
         //Get address of page table out of page directory
         uint32_t *page_table;
@@ -90,39 +105,100 @@ pfhandler(uint32_t ft_addr, uint32_t error_code)
         //If page is not present in page table
         if ((page_table[pte] & PAGE_IS_PRESENT) != PAGE_IS_PRESENT) {
             
-            //Get address of an empty page to be used for the new page
-            uint32_t memory_address = get_page_frame(ft_addr);
-            memory_address &= PAGE_ADDR_MASK;
+            //Remember the old entry, it may hold the swap slot of the page
+            uint32_t old_entry = page_table[pte];
+
+            //A read fault on a page that was never written maps the
+            //shared zero page, a frame is allocated on the first write
+            if (zero_page_enabled
+                    && (old_entry & PAGE_IS_SWAPPED) != PAGE_IS_SWAPPED
+                    && !(error_code & PGFT_ERR_WRITE)) {
+                stat_number_zero_mapped++;
+                pte_set(&page_table[pte], ZERO_PAGE_ADDR | PAGE_IS_PRESENT | PAGE_IS_USER);
+
+                pg_struct.ph_addr = ZERO_PAGE_ADDR;
+                pg_struct.flags = PAGE_IS_PRESENT | PAGE_IS_USER;
+
+                zero_around(ft_addr, page_table);
+                return &pg_struct;
+            }
 
-            //Set present,rw and user bit in preparation for usage as pte
-            memory_address = memory_address | PAGE_IS_PRESENT | PAGE_IS_RW | PAGE_IS_USER;
+            //Get a frame for the page and load it from swap if needed
+            uint32_t memory_address = page_in(ft_addr, &page_table[pte], error_code & PGFT_ERR_WRITE);
+            if (memory_address == INVALID_ADDR) {
+                pg_struct.ph_addr = INVALID_ADDR;
+                pg_struct.flags = INVALID_FLAGS;
+                pt_reclaim();
+                return &pg_struct;
+            }
 
-            //If page was existing but swaped, set swaped bit again
-            if ((page_table[pte] & PAGE_IS_SWAPPED) == PAGE_IS_SWAPPED) {
-                memory_address |= PAGE_IS_SWAPPED;
+            pg_struct.ph_addr = memory_address & PAGE_ADDR_MASK;
+            pg_struct.flags = memory_address & PAGE_FLAGS_MASK;
+
+            //Bring in the following pages of a sequential scan, keep
+            //victim and storage address of the faulting page
+            if ((old_entry & PAGE_IS_SWAPPED) == PAGE_IS_SWAPPED) {
+                uint32_t vic_addr = pg_struct.vic_addr;
+                uint32_t sec_addr = pg_struct.sec_addr;
+                read_ahead(ft_addr, page_table);
+                pg_struct.vic_addr = vic_addr;
+                pg_struct.sec_addr = sec_addr;
+            }
+            if (zero_page_enabled) {
+                zero_around(ft_addr, page_table);
             }
 
-            //Store the new entry in page table
-            page_table[pte] = memory_address;
-
-            //If swapped bit is set, load page from swap to memory
-            if ((page_table[pte] & PAGE_IS_SWAPPED) == PAGE_IS_SWAPPED) {
-                stat_number_unswapped++;
-                
-                uint32_t storage_address = index_storage_get_physical_address(ft_addr & PAGE_ADDR_MASK);
-                copy_page(storage_address, ft_addr & PAGE_ADDR_MASK);
-                //Remove Dirty Bit, because this page wasn't changed
-                page_table[pte] &= (~PAGE_IS_DIRTY);
-                invalidate_addr(ft_addr & PAGE_ADDR_MASK);
+        } 
+        //Write to the shared zero page, the page gets its own frame
+        else if ((error_code & PGFT_ERR_WRITE)
+                && (page_table[pte] & PAGE_ADDR_MASK) == ZERO_PAGE_ADDR) {
+
+            uint32_t memory_address = get_page_frame(ft_addr, 1);
+            if (memory_address == INVALID_ADDR) {
+                pg_struct.ph_addr = INVALID_ADDR;
+                pg_struct.flags = INVALID_FLAGS;
+                pt_reclaim();
+                return &pg_struct;
             }
-            
-            //Add virtual address to fifo
+            memory_address = (memory_address & PAGE_ADDR_MASK) | PAGE_IS_PRESENT | PAGE_IS_RW | PAGE_IS_USER;
+
+            pte_set(&page_table[pte], memory_address);
+            invalidate_addr(ft_addr & PAGE_ADDR_MASK);
+
             (*algo_new_page_in_ram)(ft_addr & PAGE_ADDR_MASK);
 
             pg_struct.ph_addr = memory_address & PAGE_ADDR_MASK;
             pg_struct.flags = memory_address & PAGE_FLAGS_MASK;
+        }
+        //Write to a merged page, the page gets its own copy
+        else if ((error_code & PGFT_ERR_WRITE) && ksm_is_merged(page_table[pte])) {
+
+            uint32_t merged_address = page_table[pte] & PAGE_ADDR_MASK;
+            uint32_t memory_address = get_page_frame(ft_addr, 0);
+            if (memory_address == INVALID_ADDR) {
+                pg_struct.ph_addr = INVALID_ADDR;
+                pg_struct.flags = INVALID_FLAGS;
+                pt_reclaim();
+                return &pg_struct;
+            }
+            copy_page(merged_address, memory_address);
+            memory_address = (memory_address & PAGE_ADDR_MASK) | PAGE_IS_PRESENT | PAGE_IS_RW | PAGE_IS_USER;
 
-        } 
+            pte_set(&page_table[pte], memory_address);
+            invalidate_addr(ft_addr & PAGE_ADDR_MASK);
+            ksm_unmerge(merged_address);
+
+            (*algo_new_page_in_ram)(ft_addr & PAGE_ADDR_MASK);
+
+            pg_struct.ph_addr = memory_address & PAGE_ADDR_MASK;
+            pg_struct.flags = memory_address & PAGE_FLAGS_MASK;
+        }
+        //Page is present in page table, a write to a read-only page
+        //cannot be resolved
+        else if (error_code & PGFT_ERR_PRESENT) {
+            pg_struct.ph_addr = INVALID_ADDR;
+            pg_struct.flags = page_table[pte] & PAGE_FLAGS_MASK;
+        }
         //Page is present in page table
         //TODO: Determine if this is possible
         else {
@@ -134,10 +210,13 @@ pfhandler(uint32_t ft_addr, uint32_t error_code)
     }
     //Page table is not existent.
     else {
-        //Segmentation Fault. Page Table is not present.
+        //Segmentation Fault. Kernel region or no page table available.
         pg_struct.ph_addr = INVALID_ADDR;
         pg_struct.flags = INVALID_FLAGS;
     }
+
+    //Victims evicted during the fault may have left empty page tables
+    pt_reclaim();
     
     return &pg_struct;
     
@@ -154,18 +233,21 @@ void select_paging_algorithm(uint32_t algo) {
         case 0: //FIFO
             algo_get_address_of_page_to_replace = &algo_fifo_get_address_of_page_to_replace;
             algo_new_page_in_ram = &algo_fifo_new_page_in_ram;
+            algo_remove_page = &algo_fifo_remove_page;
             algo_init = &algo_fifo_init;
             asm_printf("Changed to FIFO!\r\n");
             break;
         case 1: //Random
             algo_get_address_of_page_to_replace = &algo_random_get_address_of_page_to_replace;
             algo_new_page_in_ram = &algo_random_new_page_in_ram;
+            algo_remove_page = &algo_random_remove_page;
             algo_init = &algo_random_init;
             asm_printf("Changed to random\r\n");
             break;
         case 2: //Clock
             algo_get_address_of_page_to_replace = &algo_clock_get_address_of_page_to_replace;
             algo_new_page_in_ram = &algo_clock_new_page_in_ram;
+            algo_remove_page = &algo_clock_remove_page;
             algo_init = &algo_clock_init;
             asm_printf("Changed to clock\r\n");
             break;
@@ -178,110 +260,291 @@ void select_paging_algorithm(uint32_t algo) {
     algo_init();
 }
 
+/**
+ * Enables (1) or disables (0) mapping the shared zero page on read
+ * faults of pages that were never written.
+ **/
+void set_zero_page(uint32_t enable) {
+    zero_page_enabled = enable ? 1 : 0;
+    asm_printf("Zero page %s\r\n", zero_page_enabled ? "enabled" : "disabled");
+}
+
+/**
+ * Sets the maximum number of frames holding user pages at the same time,
+ * 0 selects all frames of the pool. Releases all pages.
+ **/
+void set_user_frames(uint32_t num) {
+    if (num == 0 || num > frame_pool_num) {
+        num = frame_pool_num;
+    }
+
+    free_all_pages();
+    algo_init();
+    frame_user_max = num;
+    if (pff_enabled) {
+        region_allowance_init();
+    }
+    asm_printf("Using %d of %d frames for user pages\r\n", frame_user_max, frame_pool_num);
+}
+
+/**
+ * Selects the device holding the swap slots, 0 - RAM, 1 - ATA disk,
+ * 2 - compressed store in RAM. Releases all pages.
+ **/
+void set_swap_backend(uint32_t backend) {
+    free_all_pages();
+    algo_init();
+    swap_select_backend(backend);
+}
+
 
 //==============================================================================
 //START OF MEMORY FUNCTIONS
 //==============================================================================
 
 /**
- * Returns physical memory address of new page
- */
+ * Makes the non-present page at virt_addr present. entry points to its
+ * page table entry. A swapped page is loaded from swap, write tells
+ * whether the page is about to be written. Returns the new page table
+ * entry, or INVALID_ADDR if no frame could be obtained.
+ **/
 uint32_t
-get_page_frame(uint32_t virt_addr) {
-    uint32_t memory_address;
+page_in(uint32_t virt_addr, uint32_t *entry, uint32_t write)
+{
+    //Remember the old entry, it may hold the swap slot of the page
+    uint32_t old_entry = *entry;
+
+    //Get address of an empty page to be used for the new page,
+    //a page loaded from swap needs no cleared frame
+    uint32_t memory_address = get_page_frame(virt_addr,
+            (old_entry & PAGE_IS_SWAPPED) != PAGE_IS_SWAPPED);
+    if (memory_address == INVALID_ADDR) {
+        return INVALID_ADDR;
+    }
+    memory_address &= PAGE_ADDR_MASK;
+
+    //Set present,rw and user bit in preparation for usage as pte
+    memory_address = memory_address | PAGE_IS_PRESENT | PAGE_IS_RW | PAGE_IS_USER;
+
+    //If swapped bit is set, load page from swap to memory
+    if ((old_entry & PAGE_IS_SWAPPED) == PAGE_IS_SWAPPED) {
+        stat_number_unswapped++;
+        
+        uint32_t slot = PTE_SWAP_SLOT(old_entry);
+        swap_backend->read(slot, memory_address);
+
+        //A write fault makes the copy in swap stale, release it.
+        //Otherwise keep it, so a clean eviction needs no write.
+        if (write) {
+            swap_slot_free(slot);
+        } else {
+            frame_table[FRAME_INDEX(memory_address & PAGE_ADDR_MASK)].swap_slot = slot;
+            memory_address |= PAGE_IS_SWAPPED;
+        }
+    }
+
+    //Store the new entry in page table
+    pte_set(entry, memory_address);
     
-    //Try to get a free memory page in physical memory
-    memory_address = index_memory_add(virt_addr);
+    //Add virtual address to fifo
+    (*algo_new_page_in_ram)(virt_addr & PAGE_ADDR_MASK);
+
+    return memory_address;
+} // end of page_in
 
-    //If obtaining free page failed
-    if (memory_address == INVALID_ADDR) {   
-        //There is no page left
+/**
+ * Returns physical memory address of new page. If clear is set, the
+ * frame is zeroed unless it was pre-zeroed during idle time.
+ */
+uint32_t
+get_page_frame(uint32_t virt_addr, uint32_t clear) {
+    //Below the low watermark page out a batch right away, the idle
+    //worker does not run between the faults of a single command
+    pageout_run();
+
+    //Try to get a free frame in physical memory, unless the region
+    //already holds all frames it may hold
+    uint32_t frame = INVALID_INDEX;
+    if (!region_at_limit(virt_addr)) {
+        frame = frame_alloc(virt_addr);
+    }
+
+    //If obtaining free frame failed
+    if (frame == INVALID_INDEX) {   
+        //There is no frame left
         //get virtual address of page to replace
-        uint32_t virt_address = get_address_of_page_to_replace();
+        uint32_t virt_address = get_region_victim(virt_addr);
+        if (virt_address == INVALID_ADDR) {
+            return INVALID_ADDR;
+        }
         
         //set victim as address of page to replace
         pg_struct.vic_addr = virt_address;
         
-        //swap page, get physical address of page to use
+        //swap page, its frame is free afterwards
         swap(virt_address);
         
-        memory_address = index_memory_add(virt_addr);
+        frame = frame_alloc(virt_addr);
         
-        if(memory_address == INVALID_ADDR) {
+        if(frame == INVALID_INDEX) {
             asm_printf("Swap should have made one page free, but failed to do so: get_page_frame()");
+            return INVALID_ADDR;
         }
     }
     
+    uint32_t memory_address = FRAME_ADDR(frame);
+
     //Clear new page to avoid old data in new page
-    clear_page(memory_address);
+    if ((frame_table[frame].flags & FRAME_IS_ZEROED) == FRAME_IS_ZEROED) {
+        if (clear) {
+            stat_number_prezeroed++;
+        }
+    } else if (clear) {
+        stat_number_cleared++;
+        clear_page(memory_address);
+    }
+    frame_table[frame].flags &= ~FRAME_IS_ZEROED;
     
     return memory_address;
 } // end of get_page_frame
 
 /**
- * Clears all present pages and invalidates all ptes for each non-kernel
- * pde. Also deletes all pages from swap.
+ * Returns the address of the page to replace for a fault at virt_addr.
+ * If the page-fault-frequency controller asks for a page of a certain
+ * region, pages of other regions go back to the replacement algorithm,
+ * as does the pinned page. Returns INVALID_ADDR if only the pinned page
+ * could be replaced.
+ **/
+uint32_t
+get_region_victim(uint32_t virt_addr)
+{
+    uint32_t region = region_victim(virt_addr);
+    uint32_t victim = get_address_of_page_to_replace();
+
+    for (uint32_t n = frame_user_num; n > 0; n--) {
+        if (victim == INVALID_ADDR || (victim != pinned_page
+                && (region == REGION_ANY || region_of(victim) == region))) {
+            break;
+        }
+        (*algo_new_page_in_ram)(victim);
+        victim = get_address_of_page_to_replace();
+    }
+
+    //Only the pinned page is left
+    if (victim != INVALID_ADDR && victim == pinned_page) {
+        (*algo_new_page_in_ram)(victim);
+        victim = INVALID_ADDR;
+    }
+
+    return victim;
+} // end of get_region_victim
+
+/**
+ * Returns a new page table for the region at index pde of the page
+ * directory, or NULL if none can be obtained. If the frame pool is
+ * exhausted, a page is replaced to get a frame for the table.
+ **/
+uint32_t *
+get_page_table(uint32_t pde)
+{
+    uint32_t *page_table = pt_alloc(pde);
+
+    if (page_table == NULL && frame_free_num == 0 && frame_user_num > 0) {
+        uint32_t virt_address = get_address_of_page_to_replace();
+        pg_struct.vic_addr = virt_address;
+        swap(virt_address);
+
+        page_table = pt_alloc(pde);
+    }
+
+    return page_table;
+} // end of get_page_table
+
+/**
+ * Clears all present pages and invalidates all ptes of the user page
+ * tables. Also deletes all pages from swap and returns the page tables
+ * taken from the frame pool. Only the entries in use are visited, with
+ * many present pages the TLB is flushed at once.
  **/
 void
 free_all_pages() {
     
-    uint32_t *page_directory = get_page_dir_addr();
-    
-    for(int i = FIRST_PDE_INDEX; i < PDE_NUM; i++) {
-        
-        if((page_directory[i] & PAGE_IS_PRESENT) == PAGE_IS_PRESENT) {
-            uint32_t *page_table = LOGADDR(page_directory[i] & PAGE_ADDR_MASK);
-            
-            for(int j = FIRST_PTE_INDEX; j < PTE_NUM; j++) {
-                
-                if((page_table[j] & PAGE_IS_PRESENT) == PAGE_IS_PRESENT) {
-                    invalidate_addr(JOIN_ADDR(i,j));
+    uint32_t flush_all = pt_present_num() > TLB_FLUSH_THRESHOLD;
+
+    for (int i = 0; i < PT_INFO_MAX; i++) {
+        pt_info_t *info = &pt_info[i];
+        if (info->table == NULL) {
+            continue;
+        }
+
+        for (int w = 0; w < PTE_NUM / 32; w++) {
+            for (uint32_t bits = info->bitmap[w]; bits != 0; bits &= bits - 1) {
+                int j = w * 32 + __builtin_ctz(bits);
+
+                if (!flush_all && (info->table[j] & PAGE_IS_PRESENT) == PAGE_IS_PRESENT) {
+                    invalidate_addr(JOIN_ADDR(info->pde, j));
                 }
-                page_table[j] = 0x00000000;
+                info->table[j] = 0x00000000;
             }
-        }        
-    }
-    
-    //set physical memory bitfield to blank
-    for (uint32_t i = 0; i < PAGES_PHYSICAL_NUM; i++) {
-        physical_pages_index[i] = INVALID_ADDR;
+            info->bitmap[w] = 0;
+        }
+        pt_emptied(info);
     }
 
-    for (uint32_t i = 0; i < PAGES_SWAPPED_NUM; i++) {
-        storage_pages_index[i] = INVALID_ADDR;
+    if (flush_all) {
+        stat_number_tlb_flushes++;
+        flush_tlb();
     }
+
+    //All page tables are empty now
+    pt_reclaim();
+    
+    //return the user frames and set all swap slots to blank
+    frame_free_user();
+    ksm_init();
+    swap_backend->clear();
+    swap_slot_init(swap_slot_num);
     
     asm_printf("Freed all pages\r\n");
     
 } // end of free_all_pages
 
 /**
- * Resets accessed bits for all ptes in page_table_program and
- * page_table_stack
+ * Resets accessed bits for all present pages of the user page tables
  **/
 void
 clear_all_accessed_bits()
 {
-    uint32_t *page_directory = get_page_dir_addr();
-    
-    for(int i = FIRST_PDE_INDEX; i < PDE_NUM; i++) {
-        
-        if((page_directory[i] & PAGE_IS_PRESENT) == PAGE_IS_PRESENT) {
-            uint32_t *page_table = LOGADDR(page_directory[i] & PAGE_ADDR_MASK);
-            
-            for(int j = FIRST_PTE_INDEX; j < PTE_NUM; j++) {
-                page_table[j] &= ~PAGE_IS_ACCESSED;
-                
-                if((page_table[j] & PAGE_IS_PRESENT) == PAGE_IS_PRESENT) {
-                    invalidate_addr(JOIN_ADDR(i,j));
+    uint32_t flush_all = pt_present_num() > TLB_FLUSH_THRESHOLD;
+
+    for (int i = 0; i < PT_INFO_MAX; i++) {
+        pt_info_t *info = &pt_info[i];
+        if (info->table == NULL || info->present == 0) {
+            continue;
+        }
+
+        for (int w = 0; w < PTE_NUM / 32; w++) {
+            for (uint32_t bits = info->bitmap[w]; bits != 0; bits &= bits - 1) {
+                int j = w * 32 + __builtin_ctz(bits);
+
+                if ((info->table[j] & PAGE_IS_PRESENT) == PAGE_IS_PRESENT) {
+                    info->table[j] &= ~PAGE_IS_ACCESSED;
+                    if (!flush_all) {
+                        invalidate_addr(JOIN_ADDR(info->pde, j));
+                    }
                 }
             }
-        }        
+        }
+    }
+
+    if (flush_all) {
+        stat_number_tlb_flushes++;
+        flush_tlb();
     }
 } // end of clear_all_accessed_bits
 
 /**
- * Copy a page from src to dst.
+ * Copy a page from src to dst. Both are physical addresses.
  **/
 void
 copy_page(uint32_t src_address, uint32_t dst_address) {
@@ -303,102 +566,61 @@ void clear_page(uint32_t address) {
 } // end of clear_page
 
 //==============================================================================
-//START OF INDEX FUNCTIONS
+//START OF DISK FUNCTIONS
 //==============================================================================
 
 /**
- * Add virtual address of page to first free index field, return physical
- * memory address.
- **/
-uint32_t index_memory_add(uint32_t addr) {
-    addr &= PAGE_ADDR_MASK;
-    for(int i = 0; i < PAGES_PHYSICAL_NUM; i++) {
-        if(physical_pages_index[i] == INVALID_ADDR) {
-            physical_pages_index[i] = addr;
-            return (PAGES_PHYSICAL_START + i * PAGE_SIZE);
-        }
-    }
-    
-    return INVALID_ADDR;
-}
-
-/**
- * Remove virtual address of page from index field.
+ * Writes the present page at virt_address to its swap slot and marks it
+ * clean, the page stays present. Returns the swap slot, or INVALID_INDEX
+ * if the swap area is full.
  **/
-void index_memory_remove(uint32_t addr) {
-    addr &= PAGE_ADDR_MASK;
-    for(int i = 0; i < PAGES_PHYSICAL_NUM; i++) {
-        if(physical_pages_index[i] == addr) {
-            physical_pages_index[i] = INVALID_ADDR;
-            return;
-        }
-    }
-}
+uint32_t write_back(uint32_t virt_address)
+{
+    //Get page table coresponding to virtAddr
+    uint32_t *page_directory = get_page_dir_addr();
+    uint32_t * page_table = LOGADDR(page_directory[PDE(virt_address)] & PAGE_ADDR_MASK);
+    uint32_t pte = PTE(virt_address);
 
-/**
- * Test if virtual address is present in index.
- * Returns 1 if present, 0 otherwise
- **/
-uint32_t index_memory_is_present(uint32_t addr) {
-    addr &= PAGE_ADDR_MASK;
-    for(int i = 0; i < PAGES_PHYSICAL_NUM; i++) {
-        if(physical_pages_index[i] == addr) {
-            return 1;
+    //Get physical memory address and frame of the page
+    uint32_t memory_address = page_table[pte] & PAGE_ADDR_MASK;
+    uint32_t frame = FRAME_INDEX(memory_address);
+    uint32_t slot = frame_table[frame].swap_slot;
+
+    // Page has no copy in swap yet, get a free slot
+    if (slot == INVALID_INDEX) {
+        slot = swap_slot_alloc();
+        if (slot == INVALID_INDEX) {
+            return INVALID_INDEX;
         }
     }
-    
-    return 0;
-}
 
-
-/**
- * Add virtual address of page to first free index field and return
- * physical address in swap.
- **/
-uint32_t index_storage_add(uint32_t addr) {
-    addr &= PAGE_ADDR_MASK;
-    for(int i = 0; i < PAGES_SWAPPED_NUM; i++) {
-        if(storage_pages_index[i] == INVALID_ADDR) {
-            storage_pages_index[i] = addr;
-            return (PAGES_SWAPPED_START + i * PAGE_SIZE);
-        }
+    // Write page to disk, the write may still be in progress on return
+    if (swap_backend->write(slot, memory_address) == INVALID_INDEX) {
+        //Device is full, the old copy in swap is stale as well
+        swap_slot_free(slot);
+        frame_table[frame].swap_slot = INVALID_INDEX;
+        page_table[pte] &= ~PAGE_IS_SWAPPED;
+        return INVALID_INDEX;
     }
-    
-    return INVALID_ADDR;
-}
+    stat_number_swapped++;
+    // TODO: THIS IS UGLY, should be fixed
+    pg_struct.sec_addr = swap_backend->addr(slot);
+
+    //The copy in swap is valid now, set swapped bit and remove dirty bit
+    frame_table[frame].swap_slot = slot;
+    page_table[pte] |= PAGE_IS_SWAPPED;
+    page_table[pte] &= (~PAGE_IS_DIRTY);
+    invalidate_addr(virt_address);
 
-/**
- * Remove virtual address of page from index field.
- **/
-void index_storage_remove(uint32_t addr) {
-    addr &= PAGE_ADDR_MASK;
-    for(int i = 0; i < PAGES_SWAPPED_NUM; i++) {
-        if(storage_pages_index[i] == addr) {
-            storage_pages_index[i] = INVALID_ADDR;
-            return;
-        }
-    }
-}
+    return slot;
+} // end of write_back
 
 /**
- * Return physical address of page with virtual address addr
- * in storage.
+ * Evicts the present page at virt_address and frees its frame. Modified
+ * pages are written to their swap slot first, the number of the slot
+ * is kept in the page table entry. Returns the physical address of the
+ * freed frame.
  **/
-uint32_t index_storage_get_physical_address(uint32_t addr)  {
-    addr &= PAGE_ADDR_MASK;
-    for(int i = 0; i < PAGES_SWAPPED_NUM; i++) {
-        if(storage_pages_index[i] == addr) {
-            return (PAGES_SWAPPED_START + i * PAGE_SIZE);
-        }
-    }
-    
-    return INVALID_ADDR;
-}
-
-//==============================================================================
-//START OF DISK FUNCTIONS
-//==============================================================================
-
 uint32_t swap(uint32_t virt_address)
 {
     //Compute pde and pte for virtAddr
@@ -408,57 +630,33 @@ uint32_t swap(uint32_t virt_address)
     //Get address of page directory using kernel call
     uint32_t *page_directory = get_page_dir_addr();
 
-    //Create variable for place in storage
-    uint32_t storage_address;
-
-    //Invalidate address in TLB because page is going to be relocated to disk
-    invalidate_addr(virt_address);
-    
     //Get page table coresponding to virtAddr
     uint32_t * page_table = LOGADDR(page_directory[pde] & PAGE_ADDR_MASK);
 
-    //Get physical memory address and flags of the page to swap
+    //Get physical memory address, flags and frame of the page to swap
     uint32_t memory_address = page_table[pte] & PAGE_ADDR_MASK;
     uint32_t flags = page_table[pte] & PAGE_FLAGS_MASK;
+    uint32_t frame = FRAME_INDEX(memory_address);
 
     // Check if page was modified, only save it then
     if ((flags & PAGE_IS_DIRTY) == PAGE_IS_DIRTY) {
-        
-        stat_number_swapped++;
-        
-        // Check if page to swap is on disk
-        if ((flags & PAGE_IS_SWAPPED) == PAGE_IS_SWAPPED) {
-        
-            // Get address of page copy on disk
-            storage_address = index_storage_get_physical_address(virt_address);
-        
-            // Overwrite copy on disk with modified page 
-            copy_page(virt_address, storage_address);
-            // TODO: THIS IS UGLY, should be fixed
-            pg_struct.sec_addr = storage_address;
-        }
-        // Page is not on disk
-        else {
-            //Get free page on storage
-            uint32_t storage_address = index_storage_add(virt_address);
-            
-            // Write page to disk
-            copy_page(virt_address, storage_address);
-            
-            // TODO: THIS IS UGLY, should be fixed
-            pg_struct.sec_addr = storage_address;
+        if (write_back(virt_address) == INVALID_INDEX) {
+            asm_printf("Swap is full, contents of page 0x%08X are lost\r\n", virt_address);
         }
-        
-        //set swapped bit
-        page_table[pte] |= PAGE_IS_SWAPPED;
-        //remove dirty bit
-        page_table[pte] &= (~PAGE_IS_DIRTY);
     }
     
-    // Reset present bit
-    index_memory_remove(virt_address);
+    // Reset present bit, keep only the number of the swap slot
+    uint32_t slot = frame_table[frame].swap_slot;
+    if (slot != INVALID_INDEX) {
+        pte_set(&page_table[pte], PTE_SWAP_ENTRY(slot));
+    } else {
+        pte_set(&page_table[pte], 0x00000000);
+    }
 
-    page_table[pte] &= (~PAGE_IS_PRESENT);
+    //Invalidate address in TLB because page is going to be relocated to disk
+    invalidate_addr(virt_address);
+
+    frame_free(frame);
 
     return memory_address;
 } // end of swap
@@ -481,7 +679,7 @@ uint32_t get_address_of_page_to_replace() {
 //==============================================================================
 
 /**
- * Initialise the user pages. Also initialize the index of memory pages and disk pages.
+ * Initialise the user pages. Also initialize the frame table and the swap slots.
  **/
 void
 init_user_pages()
@@ -489,21 +687,34 @@ init_user_pages()
     uint32_t *page_directory = get_page_dir_addr();
     asm_printf("Page Directory is at linear address 0x%08x\r\n", LINADDR(page_directory));
 
-    //set physical memory bitfield to blank
-    for (uint32_t i = 0; i < PAGES_PHYSICAL_NUM; i++) {
-        physical_pages_index[i] = INVALID_ADDR;
+    //Split the detected memory above the frame pool start between
+    //frames and swap slots
+    uint32_t memory_end = PAGES_SWAPPED_START + PAGES_SWAPPED_NUM * PAGE_SIZE;
+    if (memsizes[1] != 0) {
+        memory_end = 0x100000 + memsizes[1] * 1024;
     }
-
-    for (uint32_t i = 0; i < PAGES_SWAPPED_NUM; i++) {
-        storage_pages_index[i] = INVALID_ADDR;
+    if (memsizes[2] != 0 || memory_end > PAGES_POOL_END_MAX) {
+        memory_end = PAGES_POOL_END_MAX;
     }
 
+    uint32_t pool_num = (memory_end - PAGES_PHYSICAL_START) / PAGE_SIZE;
+    uint32_t swap_num = pool_num / 2;
+    pool_num -= swap_num;
+
+    frame_init(pool_num);
+    swap_area_init(PAGES_PHYSICAL_START + pool_num * PAGE_SIZE, swap_num);
+    asm_printf("Frame pool: %d frames at 0x%08x, swap: %d slots at 0x%08x\r\n",
+               frame_pool_num, PAGES_PHYSICAL_START, swap_slot_num, swap_area_start);
+
     page_directory[PDE_PROGRAMM_PT] = LINADDR(page_table_program) | PAGE_IS_PRESENT | PAGE_IS_RW | PAGE_IS_USER;
     page_directory[PDE_STACK_PT] = LINADDR(page_table_stack) | PAGE_IS_PRESENT | PAGE_IS_RW | PAGE_IS_USER;
+    pt_register(PDE_PROGRAMM_PT, page_table_program);
+    pt_register(PDE_STACK_PT, page_table_stack);
     asm_printf("Test out 0x%X\r\n", page_directory[PDE_PROGRAMM_PT]);
     //Initialize with paging algorithm FIFO
     algo_get_address_of_page_to_replace = &algo_fifo_get_address_of_page_to_replace;
     algo_new_page_in_ram = &algo_fifo_new_page_in_ram;
+    algo_remove_page = &algo_fifo_remove_page;
     algo_init = &algo_fifo_init;
     algo_init();
 } //end of init_user_pages
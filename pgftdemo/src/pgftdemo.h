@@ -43,12 +43,31 @@ extern uint32_t LD_IMAGE_START;
 #define PAGE_IS_DIRTY              0x040
 #define PAGE_IS_SWAPPED            0x400
 
-#define PAGES_PHYSICAL_NUM             4
+/*
+ * A page that is not present but has a copy in swap keeps the number
+ * of its swap slot in the address bits of its page table entry
+ */
+#define PTE_SWAP_SLOT(entry)  (((entry) & PAGE_ADDR_MASK) >> PTE_SHIFT)
+#define PTE_SWAP_ENTRY(slot)  (((slot) << PTE_SHIFT) | PAGE_IS_SWAPPED)
+
+/*
+ * Error code bits pushed by the CPU on a page fault
+ */
+#define PGFT_ERR_PRESENT           0x001
+#define PGFT_ERR_WRITE             0x002
+
+/*
+ * The frame pool and the swap area share the memory between
+ * PAGES_PHYSICAL_START and the end of the detected memory, which is
+ * limited to the memory mapped 1:1 by the kernel page tables.
+ * The PAGES_SWAPPED_* values are used if no memory size is known.
+ */
+#define PAGES_PHYSICAL_NUM             4    // default number of user frames
 #define PAGES_PHYSICAL_START    0x200000
-#define PAGES_PHYSICAL_END    (PAGES_PHYSICAL_START+PAGES_PHYSICAL_NUM*PAGE_SIZE-1)
 #define PAGES_SWAPPED_NUM            256
 #define PAGES_SWAPPED_START     0x300000
-#define PAGES_SWAPPED_END     (PAGES_SWAPPED_START+PAGES_SWAPPED_NUM*PAGE_SIZE-1)
+#define PAGES_POOL_END_MAX     0x1000000
+#define PAGES_POOL_MAX_NUM    ((PAGES_POOL_END_MAX-PAGES_PHYSICAL_START)/PAGE_SIZE)
 
 #define PDE_NUM                     1024
 #define PDE_MAX_INDEX         (PDE_NUM-1)
@@ -79,7 +98,9 @@ extern uint32_t LD_IMAGE_START;
 #define PDE_PROGRAMM_PT       PDE(PROGRAM_START_ADDR)
 #define PDE_STACK_PT          PDE(STACK_START_ADDR)
 
-#define FIRST_PDE_INDEX       1
+#define KERNEL_PDE_NUM        (PAGES_POOL_END_MAX >> PDE_SHIFT)
+
+#define FIRST_PDE_INDEX       KERNEL_PDE_NUM
 #define FIRST_PTE_INDEX       0
 
 
@@ -96,12 +117,28 @@ typedef struct pg_struct {
 
 
 /* pfhandler.c */
+extern uint32_t pinned_page;
 extern void init_user_pages(void);
-extern void freeAllPages(void);
+extern void free_all_pages(void);
+extern void set_user_frames(uint32_t num);
+extern void set_zero_page(uint32_t enable);
+extern void set_swap_backend(uint32_t backend);
+extern uint32_t page_in(uint32_t virt_addr, uint32_t *entry, uint32_t write);
+extern uint32_t write_back(uint32_t virt_address);
+extern uint32_t swap(uint32_t virt_address);
+extern uint32_t get_address_of_page_to_replace(void);
+extern void (*algo_new_page_in_ram)(uint32_t addr);
+extern void (*algo_remove_page)(uint32_t addr);
 extern pg_struct_t *pfhandler(uint32_t ft_addr, uint32_t error_code);
+extern void copy_page(uint32_t src_address, uint32_t dst_address);
+extern void clear_page(uint32_t address);
+
+/* idle.c */
+extern void idle_task(void);
 
 /* paging.s */
 extern void invalidate_addr(uint32_t);
+extern void flush_tlb(void);
 extern uint32_t *get_page_dir_addr(void);
 
 #endif  /* _PGFTDEMO_H */
@@ -35,6 +35,7 @@
         #----------------------------------------------------------
         .equ    IRQ_PIT_ID,     0x00
         .equ    IRQ_UART_ID,    0x04
+        .equ    IRQ_ATA_ID,     0x0E   # primary IDE channel
 
 
 #==================================================================
@@ -125,6 +126,7 @@ main:
         #----------------------------------------------------------
         INSTALL_IRQ IRQ_PIT_ID, irqPIT
         #INSTALL_IRQ IRQ_UART_ID, irqUART
+        INSTALL_IRQ IRQ_ATA_ID, irqATA
         INSTALL_ISR ISR_PFE_ID, isrPFE
 
         #----------------------------------------------------------
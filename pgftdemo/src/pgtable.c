@@ -0,0 +1,222 @@
+#include "pgtable.h"
+#include "frame.h"
+#include "stat.h"
+
+pt_info_t pt_info[PT_INFO_MAX];
+
+//Number of page tables taken from the frame pool
+uint32_t pt_dynamic_num = 0;
+
+//Index in pt_info plus one of the page table at each page of the
+//identity map, 0 for other pages. Page tables are page aligned, so
+//pte_set finds the bookkeeping of an entry without a search
+static uint8_t pt_slot[PAGES_POOL_END_MAX >> PTE_SHIFT];
+
+//Page tables taken from the frame pool that lost their last entry
+static uint8_t pt_empty[PT_INFO_MAX];
+static uint32_t pt_empty_num = 0;
+
+//Number of present entries of all user page tables
+static uint32_t pt_present_total = 0;
+
+/**
+ * Returns a free bookkeeping entry, or NULL if all are in use
+ **/
+static pt_info_t *
+pt_info_free()
+{
+    for (uint32_t i = 0; i < PT_INFO_MAX; i++) {
+        if (pt_info[i].table == NULL) {
+            return &pt_info[i];
+        }
+    }
+    return NULL;
+} // end of pt_info_free
+
+/**
+ * Fills the bookkeeping entry info for an empty page table
+ **/
+static void
+pt_info_init(pt_info_t *info, uint32_t pde, uint32_t *table, uint32_t frame)
+{
+    info->table = table;
+    info->pde = pde;
+    info->frame = frame;
+    info->used = 0;
+    info->present = 0;
+    info->reclaim = 0;
+    for (uint32_t w = 0; w < PTE_NUM / 32; w++) {
+        info->bitmap[w] = 0;
+    }
+    pt_slot[LINADDR(table) >> PTE_SHIFT] = info - pt_info + 1;
+} // end of pt_info_init
+
+/**
+ * Queues an empty page table of the frame pool for pt_reclaim
+ **/
+static void
+pt_queue_empty(pt_info_t *info)
+{
+    if (info->frame != INVALID_INDEX && !info->reclaim) {
+        info->reclaim = 1;
+        pt_empty[pt_empty_num++] = info - pt_info;
+    }
+} // end of pt_queue_empty
+
+/**
+ * Starts tracking the static user page table at logical address table,
+ * which is entered at index pde of the page directory. All its entries
+ * must be zero.
+ **/
+void
+pt_register(uint32_t pde, uint32_t *table)
+{
+    pt_info_t *info = pt_info_free();
+
+    if (info != NULL) {
+        pt_info_init(info, pde, table, INVALID_INDEX);
+    }
+} // end of pt_register
+
+/**
+ * Takes an empty page table for the 4 MiB region at index pde of the
+ * page directory from the frame pool and enters it as user page table.
+ * Table frames are not user frames, the replacement algorithms never
+ * see them. Returns the logical address of the table, or NULL if no
+ * frame or no bookkeeping entry is free.
+ **/
+uint32_t *
+pt_alloc(uint32_t pde)
+{
+    pt_info_t *info = pt_info_free();
+    if (info == NULL) {
+        return NULL;
+    }
+
+    uint32_t frame = frame_alloc_pages(0);
+    if (frame == INVALID_INDEX) {
+        return NULL;
+    }
+
+    //All entries of a new table must be zero
+    if ((frame_table[frame].flags & FRAME_IS_ZEROED) != FRAME_IS_ZEROED) {
+        clear_page(FRAME_ADDR(frame));
+    }
+    frame_table[frame].flags &= ~FRAME_IS_ZEROED;
+    frame_table[frame].flags |= FRAME_IS_PGTABLE;
+    frame_table[frame].virt_addr = JOIN_ADDR(pde, 0);
+
+    uint32_t *table = LOGADDR(FRAME_ADDR(frame));
+    pt_info_init(info, pde, table, frame);
+
+    //Released again if the fault fails before an entry is set
+    pt_queue_empty(info);
+
+    uint32_t *page_directory = get_page_dir_addr();
+    page_directory[pde] = FRAME_ADDR(frame) | PAGE_IS_PRESENT | PAGE_IS_RW | PAGE_IS_USER;
+
+    pt_dynamic_num++;
+    stat_number_pt_alloc++;
+
+    return table;
+} // end of pt_alloc
+
+/**
+ * Returns the page tables taken from the frame pool that have no entries
+ * left. Tables are not released by pte_set, so a table emptied by the
+ * eviction of a victim stays valid until the fault is handled. Only the
+ * tables queued since the last call are visited.
+ **/
+void
+pt_reclaim()
+{
+    if (pt_empty_num == 0) {
+        return;
+    }
+
+    uint32_t *page_directory = get_page_dir_addr();
+
+    while (pt_empty_num > 0) {
+        pt_info_t *info = &pt_info[pt_empty[--pt_empty_num]];
+        info->reclaim = 0;
+
+        //Entries were added after the table was queued
+        if (info->table == NULL || info->used != 0) {
+            continue;
+        }
+
+        //invlpg also drops the cached directory entry of the region
+        page_directory[info->pde] = 0;
+        invalidate_addr(JOIN_ADDR(info->pde, 0));
+
+        pt_slot[LINADDR(info->table) >> PTE_SHIFT] = 0;
+        frame_free_pages(info->frame);
+        info->table = NULL;
+
+        pt_dynamic_num--;
+        stat_number_pt_freed++;
+    }
+} // end of pt_reclaim
+
+/**
+ * Stores value in the page table entry at entry and updates the
+ * bookkeeping of its page table. Page tables are page aligned, so the
+ * table and the index follow from the address of the entry.
+ **/
+void
+pte_set(uint32_t *entry, uint32_t value)
+{
+    uint32_t *table = (uint32_t *)((uint32_t)entry & PAGE_ADDR_MASK);
+    uint32_t index = entry - table;
+    uint32_t page = LINADDR(table) >> PTE_SHIFT;
+    uint32_t old = *entry;
+
+    *entry = value;
+
+    if (page >= sizeof(pt_slot) || pt_slot[page] == 0) {
+        return;
+    }
+    pt_info_t *info = &pt_info[pt_slot[page] - 1];
+
+    if (old == 0 && value != 0) {
+        info->bitmap[index / 32] |= 1U << (index % 32);
+        info->used++;
+    } else if (old != 0 && value == 0) {
+        info->bitmap[index / 32] &= ~(1U << (index % 32));
+        if (--info->used == 0) {
+            pt_queue_empty(info);
+        }
+    }
+
+    if ((old ^ value) & PAGE_IS_PRESENT) {
+        if (value & PAGE_IS_PRESENT) {
+            info->present++;
+            pt_present_total++;
+        } else {
+            info->present--;
+            pt_present_total--;
+        }
+    }
+} // end of pte_set
+
+/**
+ * Updates the bookkeeping of a page table whose entries were all
+ * cleared without pte_set. The bitmap has to be cleared by the caller.
+ **/
+void
+pt_emptied(pt_info_t *info)
+{
+    pt_present_total -= info->present;
+    info->used = 0;
+    info->present = 0;
+    pt_queue_empty(info);
+} // end of pt_emptied
+
+/**
+ * Returns the number of present user pages
+ **/
+uint32_t
+pt_present_num()
+{
+    return pt_present_total;
+} // end of pt_present_num
@@ -0,0 +1,33 @@
+#ifndef _PGTABLE_H
+#define _PGTABLE_H      1
+
+#include "pgftdemo.h"
+
+#define PT_INFO_MAX                   64    // user page tables tracked
+#define TLB_FLUSH_THRESHOLD           32    // more invalidations reload CR3
+
+/*
+ * Bookkeeping of a user page table, so operations on all pages only
+ * visit the entries in use
+ */
+typedef struct {
+    uint32_t *table;                    // logical address, NULL if unused
+    uint32_t pde;                       // index in the page directory
+    uint32_t frame;                     // pool frame of the table, INVALID_INDEX if static
+    uint32_t used;                      // number of non-zero entries
+    uint32_t present;                   // number of present entries
+    uint32_t reclaim;                   // queued for pt_reclaim
+    uint32_t bitmap[PTE_NUM / 32];      // non-zero entries
+} pt_info_t;
+
+extern pt_info_t pt_info[PT_INFO_MAX];
+extern uint32_t pt_dynamic_num;
+
+extern void pt_register(uint32_t pde, uint32_t *table);
+extern uint32_t *pt_alloc(uint32_t pde);
+extern void pt_reclaim(void);
+extern void pte_set(uint32_t *entry, uint32_t value);
+extern void pt_emptied(pt_info_t *info);
+extern uint32_t pt_present_num(void);
+
+#endif  /* _PGTABLE_H */
@@ -0,0 +1,141 @@
+#include "readahead.h"
+#include "frame.h"
+#include "pgtable.h"
+#include "stat.h"
+
+extern int asm_printf(char *fmt, ...);
+
+//Enabled kinds of clustered page-ins
+uint32_t cluster_flags = 0;
+
+//A fault at ra_next continues the sequential scan, ra_start is the
+//first page read ahead for it
+static uint32_t ra_next = INVALID_ADDR;
+static uint32_t ra_start = INVALID_ADDR;
+
+//Number of pages to read ahead
+static uint32_t ra_window = 1;
+
+/**
+ * Called after the swapped page at ft_addr was loaded. If the fault
+ * continues a sequential scan, the following swapped pages of the
+ * same page table are loaded as well. The window doubles as long as
+ * all pages read ahead were used and shrinks otherwise. The faulting
+ * page is pinned meanwhile, read-ahead stops when only it could be
+ * replaced.
+ **/
+void
+read_ahead(uint32_t ft_addr, uint32_t *page_table)
+{
+    uint32_t page = ft_addr & PAGE_ADDR_MASK;
+
+    if ((cluster_flags & CLUSTER_READ_AHEAD) != CLUSTER_READ_AHEAD) {
+        return;
+    }
+
+    if (page != ra_next) {
+        //Not sequential, start over with the smallest window
+        ra_window = 1;
+        ra_start = INVALID_ADDR;
+        ra_next = page + PAGE_SIZE;
+        return;
+    }
+
+    //Check which pages of the last window were accessed
+    if (ra_start != INVALID_ADDR) {
+        uint32_t missed = 0;
+
+        for (uint32_t addr = ra_start; addr < page; addr += PAGE_SIZE) {
+            if ((page_table[PTE(addr)] & (PAGE_IS_PRESENT | PAGE_IS_ACCESSED))
+                    == (PAGE_IS_PRESENT | PAGE_IS_ACCESSED)) {
+                stat_number_readahead_hits++;
+            } else {
+                missed++;
+            }
+        }
+
+        if (missed == 0) {
+            if (ra_window < READ_AHEAD_MAX) {
+                ra_window *= 2;
+            }
+        } else if (ra_window > 1) {
+            ra_window /= 2;
+        }
+    }
+
+    //Never replace more than half of the user frames for read-ahead
+    uint32_t window = ra_window;
+    if (window > frame_user_max / 2) {
+        window = frame_user_max / 2;
+    }
+
+    ra_start = page + PAGE_SIZE;
+    ra_next = ra_start;
+
+    //The pages read ahead must not replace the faulting page
+    pinned_page = page;
+
+    for (uint32_t i = 0; i < window; i++) {
+        uint32_t addr = ra_next;
+
+        //Stay within the page table of the faulting page
+        if (PDE(addr) != PDE(page)) {
+            break;
+        }
+
+        uint32_t entry = page_table[PTE(addr)];
+        if ((entry & (PAGE_IS_PRESENT | PAGE_IS_SWAPPED)) != PAGE_IS_SWAPPED) {
+            break;
+        }
+
+        if (page_in(addr, &page_table[PTE(addr)], 0) == INVALID_ADDR) {
+            break;
+        }
+        stat_number_readahead++;
+        ra_next += PAGE_SIZE;
+    }
+
+    pinned_page = INVALID_ADDR;
+
+    if (ra_next == ra_start) {
+        ra_start = INVALID_ADDR;
+    }
+} // end of read_ahead
+
+/**
+ * Maps the shared zero page to all untouched pages in the aligned
+ * block of ZERO_AROUND_PAGES around ft_addr, so reading them causes
+ * no further faults. Swapped neighbours are left to read-ahead, there
+ * is no page cache whose resident pages could be mapped as well.
+ **/
+void
+zero_around(uint32_t ft_addr, uint32_t *page_table)
+{
+    if ((cluster_flags & CLUSTER_ZERO_AROUND) != CLUSTER_ZERO_AROUND) {
+        return;
+    }
+
+    uint32_t first = PTE(ft_addr) & ~(ZERO_AROUND_PAGES - 1);
+
+    for (uint32_t i = first; i < first + ZERO_AROUND_PAGES; i++) {
+        if (page_table[i] == 0x00000000) {
+            pte_set(&page_table[i], ZERO_PAGE_ADDR | PAGE_IS_PRESENT | PAGE_IS_USER);
+            stat_number_zero_around++;
+        }
+    }
+} // end of zero_around
+
+/**
+ * Selects the kinds of clustered page-ins
+ **/
+void
+set_cluster_flags(uint32_t flags)
+{
+    cluster_flags = flags & (CLUSTER_READ_AHEAD | CLUSTER_ZERO_AROUND);
+    ra_next = INVALID_ADDR;
+    ra_start = INVALID_ADDR;
+    ra_window = 1;
+    asm_printf("Read-ahead %s, zero-around %s\r\n",
+               (cluster_flags & CLUSTER_READ_AHEAD) ? "on" : "off",
+               (cluster_flags & CLUSTER_ZERO_AROUND) ? "on" : "off");
+} // end of set_cluster_flags
@@ -0,0 +1,21 @@
+#ifndef _READAHEAD_H
+#define _READAHEAD_H    1
+
+#include "pgftdemo.h"
+
+/*
+ * Flags selecting clustered page-ins
+ */
+#define CLUSTER_READ_AHEAD         0x001
+#define CLUSTER_ZERO_AROUND        0x002
+
+#define READ_AHEAD_MAX                16    // maximum read-ahead window in pages
+#define ZERO_AROUND_PAGES             16    // aligned block of untouched pages mapped to the zero page
+
+extern uint32_t cluster_flags;
+
+extern void read_ahead(uint32_t ft_addr, uint32_t *page_table);
+extern void zero_around(uint32_t ft_addr, uint32_t *page_table);
+extern void set_cluster_flags(uint32_t flags);
+
+#endif  /* _READAHEAD_H */
@@ -0,0 +1,238 @@
+#include "region.h"
+#include "frame.h"
+
+extern int asm_printf(char *fmt, ...);
+
+region_t regions[REGION_NUM] = {
+    { .name = "Program" },
+    { .name = "Stack" },
+    { .name = "Other" },
+};
+
+//Frame allowances are only enforced while the controller is enabled
+uint32_t pff_enabled = 0;
+
+//Faults of all regions in the current window
+static uint32_t pff_window = 0;
+
+static void pff_adjust(void);
+
+/**
+ * Returns the region of the user page at virt_addr
+ **/
+uint32_t
+region_of(uint32_t virt_addr)
+{
+    switch (PDE(virt_addr)) {
+        case PDE_PROGRAMM_PT:
+            return REGION_PROGRAM;
+        case PDE_STACK_PT:
+            return REGION_STACK;
+        default:
+            return REGION_OTHER;
+    }
+} // end of region_of
+
+/**
+ * Counts a fault at virt_addr. At the end of each window the controller
+ * adjusts the frame allowances.
+ **/
+void
+region_fault(uint32_t virt_addr)
+{
+    region_t *region = &regions[region_of(virt_addr)];
+
+    region->faults++;
+    region->window++;
+
+    if (++pff_window < PFF_WINDOW) {
+        return;
+    }
+
+    if (pff_enabled) {
+        pff_adjust();
+    }
+
+    pff_window = 0;
+    for (uint32_t i = 0; i < REGION_NUM; i++) {
+        regions[i].window = 0;
+    }
+} // end of region_fault
+
+/**
+ * Counts a frame taken for the user page at virt_addr
+ **/
+void
+region_frame_add(uint32_t virt_addr)
+{
+    regions[region_of(virt_addr)].resident++;
+} // end of region_frame_add
+
+/**
+ * Counts a frame released by the user page at virt_addr
+ **/
+void
+region_frame_remove(uint32_t virt_addr)
+{
+    region_t *region = &regions[region_of(virt_addr)];
+
+    if (region->resident > 0) {
+        region->resident--;
+    }
+} // end of region_frame_remove
+
+/**
+ * Forgets the frames of all regions, called when the frame pool is reset
+ **/
+void
+region_frames_clear()
+{
+    for (uint32_t i = 0; i < REGION_NUM; i++) {
+        regions[i].resident = 0;
+    }
+} // end of region_frames_clear
+
+/**
+ * Splits the user frames evenly between the regions, the program
+ * region gets the remainder
+ **/
+void
+region_allowance_init()
+{
+    uint32_t share = frame_user_max / REGION_NUM;
+
+    if (share < PFF_MIN) {
+        share = PFF_MIN;
+    }
+    for (uint32_t i = 0; i < REGION_NUM; i++) {
+        regions[i].allowance = share;
+        regions[i].grown = 0;
+        regions[i].shrunk = 0;
+    }
+    if (frame_user_max > share * REGION_NUM) {
+        regions[REGION_PROGRAM].allowance += frame_user_max - share * REGION_NUM;
+    }
+
+    pff_window = 0;
+    for (uint32_t i = 0; i < REGION_NUM; i++) {
+        regions[i].window = 0;
+    }
+} // end of region_allowance_init
+
+/**
+ * Returns 1 if the region of virt_addr holds all frames it may hold, so
+ * a fault there has to replace one of its own pages
+ **/
+uint32_t
+region_at_limit(uint32_t virt_addr)
+{
+    region_t *region = &regions[region_of(virt_addr)];
+
+    return pff_enabled && region->resident >= region->allowance;
+} // end of region_at_limit
+
+/**
+ * Returns the region whose page is replaced for a fault at virt_addr:
+ * the faulting region if it reached its allowance, otherwise the region
+ * exceeding its allowance most, or REGION_ANY
+ **/
+uint32_t
+region_victim(uint32_t virt_addr)
+{
+    if (!pff_enabled) {
+        return REGION_ANY;
+    }
+    if (region_at_limit(virt_addr)) {
+        return region_of(virt_addr);
+    }
+
+    uint32_t victim = REGION_ANY;
+    uint32_t excess = 0;
+    for (uint32_t i = 0; i < REGION_NUM; i++) {
+        if (regions[i].resident > regions[i].allowance
+                && regions[i].resident - regions[i].allowance > excess) {
+            excess = regions[i].resident - regions[i].allowance;
+            victim = i;
+        }
+    }
+    return victim;
+} // end of region_victim
+
+/**
+ * Moves frames from regions faulting rarely to regions faulting often.
+ * Shrinking only lowers the allowance, the pages above it are replaced
+ * by the next faults of other regions.
+ **/
+static void
+pff_adjust()
+{
+    uint32_t total = 0;
+
+    //Regions with a low fault rate give frames back
+    for (uint32_t i = 0; i < REGION_NUM; i++) {
+        region_t *region = &regions[i];
+        if (region->window < PFF_LOW && region->allowance >= PFF_MIN + PFF_STEP) {
+            region->allowance -= PFF_STEP;
+            region->shrunk++;
+        }
+        total += region->allowance;
+    }
+
+    //Regions with a high fault rate get frames, first unassigned ones,
+    //then from the region with the lowest fault rate
+    for (uint32_t i = 0; i < REGION_NUM; i++) {
+        region_t *region = &regions[i];
+        if (region->window <= PFF_HIGH) {
+            continue;
+        }
+
+        if (total + PFF_STEP > frame_user_max) {
+            uint32_t donor = REGION_ANY;
+            for (uint32_t j = 0; j < REGION_NUM; j++) {
+                if (j != i && regions[j].window <= PFF_HIGH
+                        && regions[j].allowance >= PFF_MIN + PFF_STEP
+                        && (donor == REGION_ANY || regions[j].window < regions[donor].window)) {
+                    donor = j;
+                }
+            }
+            if (donor == REGION_ANY) {
+                continue;
+            }
+            regions[donor].allowance -= PFF_STEP;
+            regions[donor].shrunk++;
+            total -= PFF_STEP;
+        }
+
+        region->allowance += PFF_STEP;
+        region->grown++;
+        total += PFF_STEP;
+    }
+} // end of pff_adjust
+
+/**
+ * Prints the fault and frame counters of all regions
+ **/
+void
+region_print()
+{
+    asm_printf("Region\tFaults\tFrames\tAllowed\tGrown\tShrunk\r\n");
+    for (uint32_t i = 0; i < REGION_NUM; i++) {
+        region_t *region = &regions[i];
+        asm_printf("%s\t%d\t%d\t%d\t%d\t%d\r\n", region->name, region->faults,
+                   region->resident, region->allowance, region->grown, region->shrunk);
+    }
+} // end of region_print
+
+/**
+ * Enables (1) or disables (0) the page-fault-frequency controller. The
+ * user frames are split evenly between the regions when it is enabled.
+ **/
+void
+set_pff(uint32_t enable)
+{
+    pff_enabled = enable ? 1 : 0;
+    if (pff_enabled) {
+        region_allowance_init();
+    }
+    asm_printf("Page-fault-frequency control %s\r\n", pff_enabled ? "enabled" : "disabled");
+} // end of set_pff
@@ -0,0 +1,51 @@
+#ifndef _REGION_H
+#define _REGION_H       1
+
+#include "pgftdemo.h"
+
+/*
+ * Regions of the user address space, faults and frames are counted
+ * per region
+ */
+#define REGION_PROGRAM                 0    // 4 MiB region of the program
+#define REGION_STACK                   1    // 4 MiB region of the stack
+#define REGION_OTHER                   2    // all other regions (mappings)
+#define REGION_NUM                     3
+#define REGION_ANY            REGION_NUM    // victim may be any page
+
+/*
+ * Page-fault-frequency controller: every PFF_WINDOW faults, a region
+ * with more than PFF_HIGH of them gets PFF_STEP frames more, a region
+ * with less than PFF_LOW of them PFF_STEP frames less
+ */
+#define PFF_WINDOW                    32
+#define PFF_HIGH                       8
+#define PFF_LOW                        2
+#define PFF_STEP                       1
+#define PFF_MIN                        1    // smallest frame allowance
+
+typedef struct {
+    char *name;
+    uint32_t faults;            // faults since start
+    uint32_t window;            // faults in the current window
+    uint32_t resident;          // frames holding pages of the region
+    uint32_t allowance;         // frames the region may hold
+    uint32_t grown;             // number of allowance increases
+    uint32_t shrunk;            // number of allowance decreases
+} region_t;
+
+extern region_t regions[REGION_NUM];
+extern uint32_t pff_enabled;
+
+extern uint32_t region_of(uint32_t virt_addr);
+extern void region_fault(uint32_t virt_addr);
+extern void region_frame_add(uint32_t virt_addr);
+extern void region_frame_remove(uint32_t virt_addr);
+extern void region_frames_clear(void);
+extern void region_allowance_init(void);
+extern uint32_t region_at_limit(uint32_t virt_addr);
+extern uint32_t region_victim(uint32_t virt_addr);
+extern void region_print(void);
+extern void set_pff(uint32_t enable);
+
+#endif  /* _REGION_H */
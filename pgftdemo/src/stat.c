@@ -5,9 +5,52 @@ uint32_t stat_number_pgft_read = 0;
 uint32_t stat_number_pgft_write = 0;
 uint32_t stat_number_swapped = 0;
 uint32_t stat_number_unswapped = 0;
+uint32_t stat_number_zero_mapped = 0;
+uint32_t stat_number_prezeroed = 0;
+uint32_t stat_number_cleared = 0;
+uint32_t stat_number_readahead = 0;
+uint32_t stat_number_readahead_hits = 0;
+uint32_t stat_number_zero_around = 0;
+uint32_t stat_number_pageout_runs = 0;
+uint32_t stat_number_pageout = 0;
+uint32_t stat_number_pageout_written = 0;
+uint32_t stat_number_disk_reads = 0;
+uint32_t stat_number_disk_writes = 0;
+uint32_t stat_number_disk_buffer_hits = 0;
+uint32_t stat_number_swap_errors = 0;
+uint32_t stat_number_tlb_flushes = 0;
+uint32_t stat_number_pt_alloc = 0;
+uint32_t stat_number_pt_freed = 0;
+uint32_t stat_number_ksm_merged = 0;
+uint32_t stat_number_ksm_unmerged = 0;
+uint32_t stat_number_zram_pattern = 0;
+uint32_t stat_number_zram_compressed = 0;
+uint32_t stat_number_zram_raw = 0;
+uint32_t stat_number_zram_loaded = 0;
+uint32_t stat_zram_bytes_in = 0;
+uint32_t stat_zram_bytes_written = 0;
+uint32_t stat_zram_bytes_stored = 0;
+uint64_t stat_zram_cycles_compress = 0;
+uint64_t stat_zram_cycles_decompress = 0;
 
 extern int asm_printf(char *fmt, ...);
 
+/**
+ * Returns sum / num without 64 bit division, the sum is scaled down
+ * until it fits into 32 bits
+ **/
+uint32_t stat_average(uint64_t sum, uint32_t num) {
+    uint32_t shift = 0;
+
+    if (num == 0) {
+        return 0;
+    }
+    while ((sum >> shift) > 0xffffffff) {
+        shift++;
+    }
+    return ((uint32_t)(sum >> shift) / num) << shift;
+}
+
 void stat_print() {
     asm_printf("Statistics:\r\n");
     asm_printf("Page Faults:\t\t%d\r\n", stat_number_pgft_read + stat_number_pgft_write);
@@ -15,4 +58,35 @@ void stat_print() {
     asm_printf("Write Page Faults:\t%d\r\n", stat_number_pgft_write);
     asm_printf("Pages Swapped:\t\t%d\r\n", stat_number_swapped);
     asm_printf("Pages Unswapped:\t%d\r\n", stat_number_unswapped);
+    asm_printf("Zero Page Mappings:\t%d\r\n", stat_number_zero_mapped);
+    asm_printf("Pre-zeroed Frames:\t%d\r\n", stat_number_prezeroed);
+    asm_printf("Frames Cleared:\t\t%d\r\n", stat_number_cleared);
+    asm_printf("Pages Read Ahead:\t%d\r\n", stat_number_readahead);
+    asm_printf("Read-ahead Hits:\t%d\r\n", stat_number_readahead_hits);
+    asm_printf("Zero-around Maps:\t%d\r\n", stat_number_zero_around);
+    asm_printf("Page-out Runs:\t\t%d\r\n", stat_number_pageout_runs);
+    asm_printf("Pages Paged Out:\t%d\r\n", stat_number_pageout);
+    asm_printf("Pages Written Ahead:\t%d\r\n", stat_number_pageout_written);
+    asm_printf("Disk Page Reads:\t%d\r\n", stat_number_disk_reads);
+    asm_printf("Disk Page Writes:\t%d\r\n", stat_number_disk_writes);
+    asm_printf("Disk Buffer Hits:\t%d\r\n", stat_number_disk_buffer_hits);
+    asm_printf("Swap Errors:\t\t%d\r\n", stat_number_swap_errors);
+    asm_printf("TLB Flushes:\t\t%d\r\n", stat_number_tlb_flushes);
+    asm_printf("Page Tables Allocated:\t%d\r\n", stat_number_pt_alloc);
+    asm_printf("Page Tables Freed:\t%d\r\n", stat_number_pt_freed);
+    asm_printf("Pages Merged:\t\t%d\r\n", stat_number_ksm_merged);
+    asm_printf("Pages Unmerged:\t\t%d\r\n", stat_number_ksm_unmerged);
+    asm_printf("ZRAM Pattern Pages:\t%d\r\n", stat_number_zram_pattern);
+    asm_printf("ZRAM LZ Pages:\t\t%d\r\n", stat_number_zram_compressed);
+    asm_printf("ZRAM Raw Pages:\t\t%d\r\n", stat_number_zram_raw);
+    asm_printf("ZRAM Bytes Stored:\t%d\r\n", stat_zram_bytes_stored);
+    if (stat_zram_bytes_written >= 100) {
+        uint32_t ratio = stat_zram_bytes_in / (stat_zram_bytes_written / 100);
+        asm_printf("ZRAM Ratio:\t\t%d.%02d\r\n", ratio / 100, ratio % 100);
+    }
+    asm_printf("ZRAM Cycles/Store:\t%d\r\n",
+               stat_average(stat_zram_cycles_compress,
+                            stat_number_zram_pattern + stat_number_zram_compressed + stat_number_zram_raw));
+    asm_printf("ZRAM Cycles/Load:\t%d\r\n",
+               stat_average(stat_zram_cycles_decompress, stat_number_zram_loaded));
 }
@@ -5,5 +5,33 @@ extern uint32_t stat_number_pgft_read;
 extern uint32_t stat_number_pgft_write;
 extern uint32_t stat_number_swapped;
 extern uint32_t stat_number_unswapped;
+extern uint32_t stat_number_zero_mapped;
+extern uint32_t stat_number_prezeroed;
+extern uint32_t stat_number_cleared;
+extern uint32_t stat_number_readahead;
+extern uint32_t stat_number_readahead_hits;
+extern uint32_t stat_number_zero_around;
+extern uint32_t stat_number_pageout_runs;
+extern uint32_t stat_number_pageout;
+extern uint32_t stat_number_pageout_written;
+extern uint32_t stat_number_disk_reads;
+extern uint32_t stat_number_disk_writes;
+extern uint32_t stat_number_disk_buffer_hits;
+extern uint32_t stat_number_swap_errors;
+extern uint32_t stat_number_tlb_flushes;
+extern uint32_t stat_number_pt_alloc;
+extern uint32_t stat_number_pt_freed;
+extern uint32_t stat_number_ksm_merged;
+extern uint32_t stat_number_ksm_unmerged;
+extern uint32_t stat_number_zram_pattern;
+extern uint32_t stat_number_zram_compressed;
+extern uint32_t stat_number_zram_raw;
+extern uint32_t stat_number_zram_loaded;
+extern uint32_t stat_zram_bytes_in;
+extern uint32_t stat_zram_bytes_written;
+extern uint32_t stat_zram_bytes_stored;
+extern uint64_t stat_zram_cycles_compress;
+extern uint64_t stat_zram_cycles_decompress;
 
+extern uint32_t stat_average(uint64_t sum, uint32_t num);
 extern void stat_print();
@@ -0,0 +1,170 @@
+#include "swap.h"
+
+#define SWAP_BITMAP_WORDS     ((SWAP_SLOT_MAX_NUM + 31) / 32)
+
+extern int asm_printf(char *fmt, ...);
+
+//Physical start address and number of slots of the swap area in RAM
+uint32_t swap_area_start = PAGES_SWAPPED_START;
+uint32_t swap_area_num = PAGES_SWAPPED_NUM;
+
+//Number of slots of the selected backend
+uint32_t swap_slot_num = PAGES_SWAPPED_NUM;
+
+//One bit per swap slot, a set bit marks a slot in use
+static uint32_t swap_bitmap[SWAP_BITMAP_WORDS];
+
+//Lowest bitmap word that may contain a free slot
+static uint32_t swap_bitmap_hint = 0;
+
+//==============================================================================
+//SWAP AREA IN RAM
+//==============================================================================
+
+static uint32_t
+swap_ram_init()
+{
+    return swap_area_num;
+}
+
+static void
+swap_ram_read(uint32_t slot, uint32_t phys)
+{
+    copy_page(SWAP_SLOT_ADDR(slot), phys);
+}
+
+static uint32_t
+swap_ram_write(uint32_t slot, uint32_t phys)
+{
+    copy_page(phys, SWAP_SLOT_ADDR(slot));
+    return 0;
+}
+
+static void
+swap_ram_discard(uint32_t slot)
+{
+    (void)slot;
+}
+
+static void
+swap_ram_clear()
+{
+}
+
+static uint32_t
+swap_ram_addr(uint32_t slot)
+{
+    return SWAP_SLOT_ADDR(slot);
+}
+
+static swap_backend_t swap_ram_backend = {
+    "RAM", swap_ram_init, swap_ram_read, swap_ram_write, swap_ram_discard, swap_ram_clear,
+    swap_ram_addr
+};
+
+//Selected backend and all backends by number
+swap_backend_t *swap_backend = &swap_ram_backend;
+static swap_backend_t *swap_backends[SWAP_BACKEND_NUM] = {
+    &swap_ram_backend, &swap_ata_backend, &swap_zram_backend
+};
+
+/**
+ * Sets up the swap area in RAM with num slots at physical address start
+ * and selects it as backend
+ **/
+void
+swap_area_init(uint32_t start, uint32_t num)
+{
+    swap_area_start = start;
+    swap_area_num = num;
+    swap_backend = &swap_ram_backend;
+    swap_slot_init(num);
+} // end of swap_area_init
+
+/**
+ * Selects the device holding the swap slots. All slots must be free.
+ * Returns the number of slots, 0 if the device is not available.
+ **/
+uint32_t
+swap_select_backend(uint32_t backend)
+{
+    if (backend >= SWAP_BACKEND_NUM) {
+        asm_printf("Illegal swap backend!\r\n");
+        return 0;
+    }
+
+    swap_backend->clear();
+
+    uint32_t num = swap_backends[backend]->init();
+    if (num == 0) {
+        asm_printf("Swap backend %s not available\r\n", swap_backends[backend]->name);
+        return 0;
+    }
+
+    swap_backend = swap_backends[backend];
+    swap_slot_init(num);
+    asm_printf("Swap backend %s: %d slots\r\n", swap_backend->name, swap_slot_num);
+
+    return swap_slot_num;
+} // end of swap_select_backend
+
+//==============================================================================
+//SWAP SLOT ALLOCATION
+//==============================================================================
+
+/**
+ * Marks all num slots of the selected backend as free
+ **/
+void
+swap_slot_init(uint32_t num)
+{
+    if (num > SWAP_SLOT_MAX_NUM) {
+        num = SWAP_SLOT_MAX_NUM;
+    }
+    swap_slot_num = num;
+
+    for (uint32_t i = 0; i < SWAP_BITMAP_WORDS; i++) {
+        swap_bitmap[i] = 0;
+    }
+    swap_bitmap_hint = 0;
+} // end of swap_slot_init
+
+/**
+ * Allocates the lowest free swap slot and returns its number,
+ * or INVALID_INDEX if the swap area is full.
+ **/
+uint32_t
+swap_slot_alloc()
+{
+    for (uint32_t i = swap_bitmap_hint; i * 32 < swap_slot_num; i++) {
+        if (swap_bitmap[i] != 0xffffffff) {
+            uint32_t slot = i * 32 + __builtin_ctz(~swap_bitmap[i]);
+            if (slot >= swap_slot_num) {
+                break;
+            }
+            swap_bitmap[i] |= 1U << (slot % 32);
+            swap_bitmap_hint = i;
+            return slot;
+        }
+    }
+
+    swap_bitmap_hint = SWAP_BITMAP_WORDS;
+    return INVALID_INDEX;
+} // end of swap_slot_alloc
+
+/**
+ * Releases a swap slot
+ **/
+void
+swap_slot_free(uint32_t slot)
+{
+    if (slot >= swap_slot_num) {
+        return;
+    }
+
+    swap_backend->discard(slot);
+    swap_bitmap[slot / 32] &= ~(1U << (slot % 32));
+    if (slot / 32 < swap_bitmap_hint) {
+        swap_bitmap_hint = slot / 32;
+    }
+} // end of swap_slot_free
@@ -0,0 +1,44 @@
+#ifndef _SWAP_H
+#define _SWAP_H         1
+
+#include "pgftdemo.h"
+
+/*
+ * Physical address of a slot of the swap area in RAM
+ */
+#define SWAP_SLOT_ADDR(slot)  (swap_area_start + ((slot) << PTE_SHIFT))
+
+#define SWAP_SLOT_MAX_NUM         0x2000    // 32 MiB of swap
+
+/*
+ * Devices holding the swap slots
+ */
+#define SWAP_BACKEND_RAM               0
+#define SWAP_BACKEND_ATA               1
+#define SWAP_BACKEND_ZRAM              2    // compressed store in the RAM area
+#define SWAP_BACKEND_NUM               3
+
+typedef struct {
+    char *name;
+    uint32_t (*init)(void);                         // returns the number of slots
+    void (*read)(uint32_t slot, uint32_t phys);     // load slot into frame
+    uint32_t (*write)(uint32_t slot, uint32_t phys);// store frame in slot, INVALID_INDEX if full
+    void (*discard)(uint32_t slot);                 // slot was freed
+    void (*clear)(void);                            // finish pending writes, drop all slots
+    uint32_t (*addr)(uint32_t slot);                // address of slot on its device
+} swap_backend_t;
+
+extern uint32_t swap_area_start;
+extern uint32_t swap_area_num;
+extern uint32_t swap_slot_num;
+extern swap_backend_t *swap_backend;
+extern swap_backend_t swap_ata_backend;
+extern swap_backend_t swap_zram_backend;
+
+extern void swap_area_init(uint32_t start, uint32_t num);
+extern uint32_t swap_select_backend(uint32_t backend);
+extern void swap_slot_init(uint32_t num);
+extern uint32_t swap_slot_alloc(void);
+extern void swap_slot_free(uint32_t slot);
+
+#endif  /* _SWAP_H */
@@ -0,0 +1,135 @@
+#include "swap.h"
+#include "ata.h"
+#include "frame.h"
+#include "stat.h"
+
+extern int asm_printf(char *fmt, ...);
+
+#define SWAP_SECTORS_PER_SLOT  (PAGE_SIZE / ATA_SECTOR_SIZE)
+
+//Pages are copied to a buffer before they are written, so the frame can
+//be reused while the write is in progress. The buffers keep the last
+//pages written and serve page-ins of these pages without disk access.
+//They are one block of ATA_QUEUE_LEN frames of the frame pool, taken
+//when the backend is selected the first time.
+static uint32_t swap_disk_buf_frame = INVALID_INDEX;
+#define SWAP_DISK_BUF(buf)     FRAME_ADDR(swap_disk_buf_frame + (buf))
+static uint32_t swap_disk_buf_slot[ATA_QUEUE_LEN];
+static uint32_t swap_disk_buf_req[ATA_QUEUE_LEN];
+static uint32_t swap_disk_buf_next = 0;
+
+/**
+ * Waits until all writes are on disk and forgets the buffered pages
+ **/
+static void
+swap_disk_clear()
+{
+    for (uint32_t i = 0; i < ATA_QUEUE_LEN; i++) {
+        if (swap_disk_buf_slot[i] != INVALID_INDEX) {
+            ata_wait(swap_disk_buf_req[i]);
+        }
+        swap_disk_buf_slot[i] = INVALID_INDEX;
+    }
+    swap_disk_buf_next = 0;
+} // end of swap_disk_clear
+
+/**
+ * Detects the disk and takes the write buffers from the frame pool,
+ * returns the number of slots the disk holds
+ **/
+static uint32_t
+swap_disk_init()
+{
+    if (ata_sectors == 0) {
+        for (uint32_t i = 0; i < ATA_QUEUE_LEN; i++) {
+            swap_disk_buf_slot[i] = INVALID_INDEX;
+        }
+        if (ata_init() == 0) {
+            return 0;
+        }
+    }
+    if (swap_disk_buf_frame == INVALID_INDEX) {
+        swap_disk_buf_frame = frame_alloc_pages(ATA_QUEUE_ORDER);
+        if (swap_disk_buf_frame == INVALID_INDEX) {
+            return 0;
+        }
+        asm_printf("Disk write buffers: %d frames at 0x%08x\r\n", ATA_QUEUE_LEN, SWAP_DISK_BUF(0));
+    }
+    swap_disk_clear();
+
+    uint32_t num = ata_sectors / SWAP_SECTORS_PER_SLOT;
+    if (num > SWAP_SLOT_MAX_NUM) {
+        num = SWAP_SLOT_MAX_NUM;
+    }
+    return num;
+} // end of swap_disk_init
+
+/**
+ * Loads slot into the frame at physical address phys. The page fault
+ * handler needs the data, so this waits for the read.
+ **/
+static void
+swap_disk_read(uint32_t slot, uint32_t phys)
+{
+    //Search the buffers from the newest write backwards
+    for (uint32_t i = 1; i <= ATA_QUEUE_LEN; i++) {
+        uint32_t buf = (swap_disk_buf_next + ATA_QUEUE_LEN - i) % ATA_QUEUE_LEN;
+        if (swap_disk_buf_slot[buf] == slot) {
+            stat_number_disk_buffer_hits++;
+            copy_page(SWAP_DISK_BUF(buf), phys);
+            return;
+        }
+    }
+
+    stat_number_disk_reads++;
+    uint32_t req = ata_submit(ATA_OP_READ, slot * SWAP_SECTORS_PER_SLOT,
+                              SWAP_SECTORS_PER_SLOT, LOGADDR(phys));
+    ata_wait(req);
+} // end of swap_disk_read
+
+/**
+ * Queues a write of the frame at physical address phys to slot and
+ * returns without waiting for the disk
+ **/
+static uint32_t
+swap_disk_write(uint32_t slot, uint32_t phys)
+{
+    uint32_t buf = swap_disk_buf_next;
+    swap_disk_buf_next = (swap_disk_buf_next + 1) % ATA_QUEUE_LEN;
+
+    //Oldest buffer may still be on its way to disk
+    if (swap_disk_buf_slot[buf] != INVALID_INDEX) {
+        ata_wait(swap_disk_buf_req[buf]);
+    }
+
+    stat_number_disk_writes++;
+    copy_page(phys, SWAP_DISK_BUF(buf));
+    swap_disk_buf_slot[buf] = slot;
+    swap_disk_buf_req[buf] = ata_submit(ATA_OP_WRITE, slot * SWAP_SECTORS_PER_SLOT,
+                                        SWAP_SECTORS_PER_SLOT, LOGADDR(SWAP_DISK_BUF(buf)));
+    return 0;
+} // end of swap_disk_write
+
+/**
+ * A freed slot needs no disk access, a queued write to it completes
+ * before any later request for the slot
+ **/
+static void
+swap_disk_discard(uint32_t slot)
+{
+    (void)slot;
+} // end of swap_disk_discard
+
+/**
+ * Returns the first sector of slot
+ **/
+static uint32_t
+swap_disk_addr(uint32_t slot)
+{
+    return slot * SWAP_SECTORS_PER_SLOT;
+} // end of swap_disk_addr
+
+swap_backend_t swap_ata_backend = {
+    "ATA", swap_disk_init, swap_disk_read, swap_disk_write, swap_disk_discard, swap_disk_clear,
+    swap_disk_addr
+};
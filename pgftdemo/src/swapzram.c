@@ -0,0 +1,245 @@
+#include "swap.h"
+#include "lz.h"
+#include "stat.h"
+
+extern uint64_t read_tsc(void);
+
+#define ZRAM_GRANULE_SIZE             64    // allocation unit of the store
+#define ZRAM_GRANULE_SHIFT             6
+#define ZRAM_GRANULE_MAX      ((PAGES_POOL_MAX_NUM / 2) * (PAGE_SIZE / ZRAM_GRANULE_SIZE))
+#define ZRAM_GRANULES(size)   (((size) + ZRAM_GRANULE_SIZE - 1) >> ZRAM_GRANULE_SHIFT)
+#define ZRAM_MAX_COMPRESSED         3072    // larger pages are stored uncompressed
+#define ZRAM_SLOTS_PER_PAGE            4    // slots offered per page of the store
+
+/*
+ * Ways a slot is stored
+ */
+#define ZRAM_EMPTY                     0
+#define ZRAM_PATTERN                   1    // dword i is value + i * step
+#define ZRAM_LZ                        2
+#define ZRAM_RAW                       3
+
+typedef struct {
+    uint16_t type;
+    uint16_t size;              // bytes in the store
+    uint32_t data;              // first granule, or value of a pattern
+    uint32_t step;              // step of a pattern, 0 if same-filled
+} zram_slot_t;
+
+static zram_slot_t zram_slots[SWAP_SLOT_MAX_NUM];
+
+//One bit per granule of the store, a set bit marks a granule in use
+static uint32_t zram_bitmap[(ZRAM_GRANULE_MAX + 31) / 32];
+static uint32_t zram_granule_num = 0;
+
+//Output of the compressor
+static uint8_t zram_buf[PAGE_SIZE];
+
+/**
+ * Allocates num consecutive granules, returns the first one or
+ * INVALID_INDEX if the store has no such gap
+ **/
+static uint32_t
+zram_granule_alloc(uint32_t num)
+{
+    uint32_t run = 0;
+
+    for (uint32_t g = 0; g < zram_granule_num; g++) {
+        //Skip full words at the start of a run
+        if (run == 0 && g % 32 == 0 && zram_bitmap[g / 32] == 0xffffffff) {
+            g += 31;
+            continue;
+        }
+        if (zram_bitmap[g / 32] & (1U << (g % 32))) {
+            run = 0;
+            continue;
+        }
+        if (++run == num) {
+            uint32_t first = g + 1 - num;
+            for (uint32_t i = first; i <= g; i++) {
+                zram_bitmap[i / 32] |= 1U << (i % 32);
+            }
+            return first;
+        }
+    }
+    return INVALID_INDEX;
+} // end of zram_granule_alloc
+
+static void
+zram_granule_free(uint32_t first, uint32_t num)
+{
+    for (uint32_t i = first; i < first + num; i++) {
+        zram_bitmap[i / 32] &= ~(1U << (i % 32));
+    }
+}
+
+/**
+ * Releases the store of slot
+ **/
+static void
+zram_discard(uint32_t slot)
+{
+    zram_slot_t *s = &zram_slots[slot];
+
+    if (s->type == ZRAM_LZ || s->type == ZRAM_RAW) {
+        zram_granule_free(s->data, ZRAM_GRANULES(s->size));
+        stat_zram_bytes_stored -= s->size;
+    }
+    s->type = ZRAM_EMPTY;
+} // end of zram_discard
+
+/**
+ * Drops all slots
+ **/
+static void
+zram_clear()
+{
+    for (uint32_t i = 0; i < SWAP_SLOT_MAX_NUM; i++) {
+        zram_slots[i].type = ZRAM_EMPTY;
+    }
+    for (uint32_t i = 0; i < (ZRAM_GRANULE_MAX + 31) / 32; i++) {
+        zram_bitmap[i] = 0;
+    }
+    stat_zram_bytes_stored = 0;
+} // end of zram_clear
+
+/**
+ * Uses the swap area in RAM as store, returns the number of slots
+ **/
+static uint32_t
+zram_init()
+{
+    zram_granule_num = swap_area_num * (PAGE_SIZE / ZRAM_GRANULE_SIZE);
+    if (zram_granule_num > ZRAM_GRANULE_MAX) {
+        zram_granule_num = ZRAM_GRANULE_MAX;
+    }
+    zram_clear();
+
+    uint32_t num = swap_area_num * ZRAM_SLOTS_PER_PAGE;
+    if (num > SWAP_SLOT_MAX_NUM) {
+        num = SWAP_SLOT_MAX_NUM;
+    }
+    return num;
+} // end of zram_init
+
+/**
+ * Stores the frame at physical address phys in slot. Pages whose dwords
+ * form an arithmetic sequence (e.g. all zero) only keep the first value
+ * and the step, others are compressed. Returns INVALID_INDEX if the
+ * store is full.
+ **/
+static uint32_t
+zram_write(uint32_t slot, uint32_t phys)
+{
+    zram_slot_t *s = &zram_slots[slot];
+    uint32_t *page = LOGADDR(phys & PAGE_ADDR_MASK);
+    uint64_t start = read_tsc();
+
+    zram_discard(slot);
+    stat_zram_bytes_in += PAGE_SIZE;
+
+    //Check for a pattern first, it is cheap and common
+    uint32_t step = page[1] - page[0];
+    uint32_t i;
+    for (i = 2; i < PAGE_SIZE / 4; i++) {
+        if (page[i] - page[i - 1] != step) {
+            break;
+        }
+    }
+    if (i == PAGE_SIZE / 4) {
+        s->type = ZRAM_PATTERN;
+        s->size = 0;
+        s->data = page[0];
+        s->step = step;
+        stat_number_zram_pattern++;
+        stat_zram_cycles_compress += read_tsc() - start;
+        return 0;
+    }
+
+    uint32_t size = lz_compress((uint8_t *)page, PAGE_SIZE, zram_buf, ZRAM_MAX_COMPRESSED);
+    uint8_t *src = zram_buf;
+    s->type = ZRAM_LZ;
+    if (size == 0) {
+        size = PAGE_SIZE;
+        src = (uint8_t *)page;
+        s->type = ZRAM_RAW;
+    }
+
+    uint32_t first = zram_granule_alloc(ZRAM_GRANULES(size));
+    if (first == INVALID_INDEX) {
+        s->type = ZRAM_EMPTY;
+        stat_zram_bytes_in -= PAGE_SIZE;
+        return INVALID_INDEX;
+    }
+
+    uint8_t *dst = (uint8_t *)LOGADDR(swap_area_start + (first << ZRAM_GRANULE_SHIFT));
+    for (i = 0; i < size; i++) {
+        dst[i] = src[i];
+    }
+    s->size = size;
+    s->data = first;
+    s->step = 0;
+
+    if (s->type == ZRAM_LZ) {
+        stat_number_zram_compressed++;
+    } else {
+        stat_number_zram_raw++;
+    }
+    stat_zram_bytes_stored += size;
+    stat_zram_bytes_written += size;
+    stat_zram_cycles_compress += read_tsc() - start;
+    return 0;
+} // end of zram_write
+
+/**
+ * Loads slot into the frame at physical address phys
+ **/
+static void
+zram_read(uint32_t slot, uint32_t phys)
+{
+    zram_slot_t *s = &zram_slots[slot];
+    uint32_t *page = LOGADDR(phys & PAGE_ADDR_MASK);
+    uint8_t *src = (uint8_t *)LOGADDR(swap_area_start + (s->data << ZRAM_GRANULE_SHIFT));
+    uint64_t start = read_tsc();
+
+    switch (s->type) {
+        case ZRAM_PATTERN:
+            for (uint32_t i = 0, v = s->data; i < PAGE_SIZE / 4; i++, v += s->step) {
+                page[i] = v;
+            }
+            break;
+        case ZRAM_LZ:
+            if (lz_decompress(src, s->size, (uint8_t *)page, PAGE_SIZE) != PAGE_SIZE) {
+                stat_number_swap_errors++;
+            }
+            break;
+        case ZRAM_RAW:
+            for (uint32_t i = 0; i < PAGE_SIZE; i++) {
+                ((uint8_t *)page)[i] = src[i];
+            }
+            break;
+        default:
+            clear_page(phys);
+            break;
+    }
+
+    stat_number_zram_loaded++;
+    stat_zram_cycles_decompress += read_tsc() - start;
+} // end of zram_read
+
+/**
+ * Returns the physical address of the store of slot, INVALID_ADDR for
+ * patterns
+ **/
+static uint32_t
+zram_addr(uint32_t slot)
+{
+    if (zram_slots[slot].type == ZRAM_PATTERN) {
+        return INVALID_ADDR;
+    }
+    return swap_area_start + (zram_slots[slot].data << ZRAM_GRANULE_SHIFT);
+} // end of zram_addr
+
+swap_backend_t swap_zram_backend = {
+    "ZRAM", zram_init, zram_read, zram_write, zram_discard, zram_clear, zram_addr
+};
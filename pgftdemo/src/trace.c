@@ -0,0 +1,119 @@
+#include "trace.h"
+#include "stat.h"
+
+extern int asm_printf(char *fmt, ...);
+extern uint64_t read_tsc(void);
+
+//Print every fault on the console (isrPFE), 0 records them only
+uint32_t trace_verbose = 1;
+
+//Faults are recorded in a ring, trace_next counts all recorded faults
+static trace_entry_t trace_ring[TRACE_LEN];
+static uint32_t trace_next = 0;
+
+/**
+ * Records a fault in the trace ring. Called by isrPFE after pfhandler,
+ * start is the time stamp counter read when the fault was taken.
+ **/
+void
+trace_fault(uint32_t ft_addr, uint32_t eip, uint32_t error, pg_struct_t *pg, uint64_t start)
+{
+    trace_entry_t *entry = &trace_ring[trace_next % TRACE_LEN];
+
+    entry->ft_addr = ft_addr;
+    entry->eip = eip;
+    entry->error = error;
+    entry->ph_addr = pg->ph_addr;
+    entry->vic_addr = pg->vic_addr;
+    entry->sec_addr = pg->sec_addr;
+    entry->cycles = (uint32_t)(read_tsc() - start);
+    entry->tsc = start;
+    trace_next++;
+} // end of trace_fault
+
+/**
+ * Prints a summary of the faults in the trace ring
+ **/
+static void
+trace_summary()
+{
+    uint32_t num = trace_next < TRACE_LEN ? trace_next : TRACE_LEN;
+    uint32_t reads = 0, writes = 0, protection = 0, unresolved = 0, victims = 0;
+    uint32_t cycles_max = 0;
+    uint64_t cycles = 0;
+
+    for (uint32_t i = trace_next - num; i != trace_next; i++) {
+        trace_entry_t *entry = &trace_ring[i % TRACE_LEN];
+
+        if ((entry->error & PF_ERR_PRESENT) == PF_ERR_PRESENT) {
+            protection++;
+        } else if ((entry->error & PF_ERR_WRITE) == PF_ERR_WRITE) {
+            writes++;
+        } else {
+            reads++;
+        }
+        if (entry->ph_addr == INVALID_ADDR) {
+            unresolved++;
+        }
+        if (entry->vic_addr != INVALID_ADDR) {
+            victims++;
+        }
+        if (entry->cycles > cycles_max) {
+            cycles_max = entry->cycles;
+        }
+        cycles += entry->cycles;
+    }
+
+    asm_printf("Fault Trace:\r\n");
+    asm_printf("Faults Recorded:\t%d (last %d kept)\r\n", trace_next, num);
+    asm_printf("Read Faults:\t\t%d\r\n", reads);
+    asm_printf("Write Faults:\t\t%d\r\n", writes);
+    asm_printf("Protection Faults:\t%d\r\n", protection);
+    asm_printf("Unresolved Faults:\t%d\r\n", unresolved);
+    asm_printf("Victim Pages:\t\t%d\r\n", victims);
+    if (num > 0) {
+        asm_printf("Cycles/Fault:\t\t%u (max %u)\r\n", stat_average(cycles, num), cycles_max);
+        uint64_t span = trace_ring[(trace_next - 1) % TRACE_LEN].tsc -
+                        trace_ring[(trace_next - num) % TRACE_LEN].tsc;
+        asm_printf("Cycles Spanned:\t\t0x%08x%08x\r\n", (uint32_t)(span >> 32), (uint32_t)span);
+    }
+} // end of trace_summary
+
+/**
+ * Prints the last num faults of the trace ring, oldest first. 0 prints
+ * a summary of all faults in the ring.
+ **/
+void
+trace_dump(uint32_t num)
+{
+    if (num == 0) {
+        trace_summary();
+        return;
+    }
+    if (num > trace_next) {
+        num = trace_next;
+    }
+    if (num > TRACE_LEN) {
+        num = TRACE_LEN;
+    }
+
+    asm_printf("Address  EIP      Err Physical Victim   Storage  Cycles\r\n");
+    for (uint32_t i = trace_next - num; i != trace_next; i++) {
+        trace_entry_t *entry = &trace_ring[i % TRACE_LEN];
+
+        asm_printf("%08x %08x %3x %08x %08x %08x %u\r\n", entry->ft_addr, entry->eip,
+                   entry->error, entry->ph_addr, entry->vic_addr, entry->sec_addr,
+                   entry->cycles);
+    }
+} // end of trace_dump
+
+/**
+ * Enables (1) or disables (0) printing every fault. Faults are
+ * recorded in the trace ring in both cases.
+ **/
+void
+set_trace_verbose(uint32_t flag)
+{
+    trace_verbose = flag ? 1 : 0;
+    asm_printf("Fault messages %s\r\n", trace_verbose ? "enabled" : "disabled");
+} // end of set_trace_verbose
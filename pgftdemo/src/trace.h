@@ -0,0 +1,32 @@
+#ifndef _TRACE_H
+#define _TRACE_H        1
+
+#include "pgftdemo.h"
+
+#define TRACE_LEN                    256    // entries of the fault trace ring, power of two
+
+/*
+ * Error code bits of a page fault
+ */
+#define PF_ERR_PRESENT             0x001
+#define PF_ERR_WRITE               0x002
+
+typedef struct {
+    uint32_t ft_addr;           // faulting linear memory address
+    uint32_t eip;               // faulting instruction
+    uint32_t error;             // error code of the fault
+    uint32_t ph_addr;           // physical address, INVALID_ADDR if unresolved
+    uint32_t vic_addr;          // victim page address
+    uint32_t sec_addr;          // secondary storage address
+    uint32_t cycles;            // cycles spent in pfhandler
+    uint64_t tsc;               // time stamp counter at the fault
+} trace_entry_t;
+
+extern uint32_t trace_verbose;
+
+extern void trace_fault(uint32_t ft_addr, uint32_t eip, uint32_t error,
+                        pg_struct_t *pg, uint64_t start);
+extern void trace_dump(uint32_t num);
+extern void set_trace_verbose(uint32_t flag);
+
+#endif  /* _TRACE_H */
@@ -0,0 +1,24 @@
+
+#==================================================================
+# S E C T I O N   T E X T
+#==================================================================
+        .section        .text
+
+
+#-------------------------------------------------------------------
+# FUNCTION:   read_tsc
+#
+# PURPOSE:    read the time stamp counter of the CPU
+#
+# C Call:     uint64_t read_tsc(void)
+#
+# PARAMETERS: none
+#
+# RETURN:     EDX:EAX - number of clock cycles since reset
+#
+#-------------------------------------------------------------------
+        .type   read_tsc, @function
+        .global read_tsc
+read_tsc:
+        rdtsc
+        ret
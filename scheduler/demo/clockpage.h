@@ -0,0 +1,64 @@
+// clockpage.h: Reading the TSC based clock of libkernel without a system call
+
+////////////////
+// Structures //
+////////////////
+
+// Layout of the clock page (see libkernel/src/clock.s)
+typedef struct {
+	unsigned long version;		// 0 if the TSC was not calibrated
+	unsigned long long tsc;		// TSC at the epoch
+	unsigned long mult;		// nanoseconds per TSC tick << shift
+	unsigned long shift;		// 1 to 32
+	unsigned long khz;		// TSC frequency in kHz
+	unsigned long epoch;		// seconds since 1970-01-01 at tsc
+} __attribute__((packed)) clock_page_t;
+
+// Result of clock_gettime
+struct timespec_k {
+	long tv_sec;
+	long tv_nsec;
+};
+
+#define CLOCK_REALTIME 0
+#define CLOCK_MONOTONIC 1
+
+#define SYS_CLOCK_GETTIME 265
+#define SYS_CLOCK_PAGE 351
+
+//////////////////////
+// Inline Functions //
+//////////////////////
+
+// Get the read-only clock page (once, keep the pointer), NULL if the
+// kernel cannot write-protect it
+static inline const volatile clock_page_t *clock_page(void)
+{
+	unsigned long addr;
+	__asm__ volatile ("int $0x80" : "=a" (addr) : "a" (SYS_CLOCK_PAGE) : "memory");
+	if (addr == (unsigned long)-1)
+		return 0;
+	return (const volatile clock_page_t *)addr;
+}
+
+// Clock with system call (seconds and nanoseconds), 0 on success
+static inline int clock_gettime_k(int id, struct timespec_k *ts)
+{
+	int ret;
+	__asm__ volatile ("int $0x80" : "=a" (ret) : "a" (SYS_CLOCK_GETTIME), "b" (id), "c" (ts) : "memory");
+	return ret;
+}
+
+// Nanoseconds since the epoch of the clock page, computed from the TSC
+static inline unsigned long long clock_page_ns(const volatile clock_page_t *cp)
+{
+	unsigned long lo, hi;
+	__asm__ volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+	unsigned long long delta = (((unsigned long long)hi << 32) | lo) - cp->tsc;
+	unsigned long shift = cp->shift;
+
+	// 96 bit product shifted right, as clock_ns in the kernel does
+	unsigned long long low = (unsigned long long)(unsigned long)delta * cp->mult;
+	unsigned long long high = (unsigned long long)(unsigned long)(delta >> 32) * cp->mult;
+	return (high << (32 - shift)) + (low >> shift);
+}
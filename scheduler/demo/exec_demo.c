@@ -0,0 +1,70 @@
+// exec_demo.c: Several processes of one program started by name
+
+////////////
+// Header //
+////////////
+
+#include <unistd.h>
+#include "pthreads.h"
+#include "schedexec.h"
+
+/////////////////
+// Definitions //
+/////////////////
+
+// Name in the ramdisk, the scheduler starts the program as PID 1
+#define PROGRAM "exec_demo"
+#define FIRST_PID 1
+
+// Processes of the program and rounds each of them counts
+#define INSTANCES 3
+#define ROUNDS 3
+
+///////////////////////
+// Globale Variablen //
+///////////////////////
+
+// Own copy in every process, only the text is shared
+int counter = 0;
+
+//////////////////////
+// Helper functions //
+//////////////////////
+
+// Print text and unsigned number
+static void print_num(const char* str, int len, unsigned long num)
+{
+	char buf[10];
+	int i = sizeof(buf);
+	do {
+		buf[--i] = (char)(num % 10) + '0';
+		num /= 10;
+	} while(num && i);
+	write(1, str, len);
+	write(1, buf+i, sizeof(buf)-i);
+}
+
+// Main-function
+int main(int argc, char* argv[])
+{
+	pthread_t pid = pthread_self();
+
+	// The first process starts the others
+	if(pid == FIRST_PID) {
+		int started = 1;
+		for(int i = 1; i < INSTANCES; ++i) {
+			if(sched_execname(PROGRAM) != -1)
+				++started;
+		}
+		print_num("Instances ", 10, started);
+	}
+
+	// Count in the own data page, interleaved with the others
+	for(int i = 0; i < ROUNDS; ++i) {
+		++counter;
+		print_num(" PID ", 5, pid);
+		print_num(" counter ", 9, counter);
+		pthread_yield();
+	}
+	return counter;
+}
@@ -0,0 +1,94 @@
+// rt_demo.c: Periodic real-time thread under background load
+
+////////////
+// Header //
+////////////
+
+#include <unistd.h>
+#include "pthreads.h"
+#include "schedrt.h"
+
+/////////////////
+// Definitions //
+/////////////////
+
+// Job every 10 ms with 2 ms of CPU time, due at the end of its period
+#define PERIOD 10000000UL
+#define BUDGET 2000000UL
+#define JOBS 200
+
+//////////////////////
+// Helper functions //
+//////////////////////
+
+// Print text and unsigned number
+static void print_num(const char* str, int len, unsigned long num)
+{
+	char buf[10];
+	int i = sizeof(buf);
+	do {
+		buf[--i] = (char)(num % 10) + '0';
+		num /= 10;
+	} while(num && i);
+	write(1, str, len);
+	write(1, buf+i, sizeof(buf)-i);
+}
+
+//////////////////////
+// Thread-functions //
+//////////////////////
+
+// Background load: never yields
+void* spinner(void* arg)
+{
+	while(1) {
+		for(volatile int i=0; i<0x7FFFFF; ++i);
+	}
+	return arg;
+}
+
+// Periodic control-style task
+void* control(void* arg)
+{
+	// Register real-time parameters
+	if(sched_setrt(PERIOD, BUDGET, 0) != 0) {
+		const char str[] = "RT admission failed";
+		write(1, str, sizeof(str));
+		return arg;
+	}
+
+	// One short job per period, yield when done
+	for(int j=0; j<JOBS; ++j) {
+		for(volatile int i=0; i<0x3FFF; ++i);
+		pthread_yield();
+	}
+
+	// Report counters
+	sched_rtstat_t stat;
+	if(sched_rtstat(&stat) == 0) {
+		print_num("RT jobs ", 8, stat.jobs);
+		print_num("RT misses ", 10, stat.misses);
+		print_num("RT overruns ", 12, stat.overruns);
+	}
+
+	// Normal task again
+	sched_setrt(0, 0, 0);
+	return arg;
+}
+
+// Main-function
+int main(int argc, char* argv[])
+{
+	// Background load and real-time thread
+	pthread_t load[2], rt;
+	pthread_create(&load[0], 0, &spinner, (void*)0);
+	pthread_create(&load[1], 0, &spinner, (void*)1);
+	int ret = pthread_create(&rt, 0, &control, (void*)2);
+
+	// Wait for the real-time thread, then stop the load
+	if(ret == 0)
+		pthread_join(rt, 0);
+	pthread_cancel(load[0]);
+	pthread_cancel(load[1]);
+	return ret;
+}
@@ -0,0 +1,18 @@
+// schedexec.h: Starting processes of a program of the ramdisk by name
+
+#define SYS_EXECNAME 354
+
+//////////////////////
+// Inline Functions //
+//////////////////////
+
+// Start another process of the program named name in the ramdisk, it
+// shares the text of the program and gets own data and BSS. Only the
+// program the scheduler was booted with can be started. Returns the
+// PID of the new process, or -1
+static inline int sched_execname(const char *name)
+{
+	int ret;
+	__asm__ volatile ("int $0x80" : "=a" (ret) : "a" (SYS_EXECNAME), "b" (name) : "memory");
+	return ret;
+}
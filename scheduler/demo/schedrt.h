@@ -0,0 +1,43 @@
+// schedrt.h: Real-time scheduling class of the DHBW kernel (earliest deadline first)
+
+////////////////
+// Structures //
+////////////////
+
+// Counters of a real-time task
+typedef struct {
+	unsigned long misses;	// jobs not done before their deadline
+	unsigned long overruns;	// jobs throttled at their budget
+	unsigned long jobs;	// jobs released
+} sched_rtstat_t;
+
+#define SYS_SCHED_SETRT 352
+#define SYS_SCHED_RTSTAT 353
+
+//////////////////////
+// Inline Functions //
+//////////////////////
+
+// Make the calling task real-time: a job is released every period and
+// gets budget ns of CPU time until deadline ns after its release (0 =
+// period). The task ends each job with sched_yield. Period 0 makes it
+// a normal task again. Returns 0, or -1 if admission control refuses it
+static inline int sched_setrt(unsigned long period, unsigned long budget, unsigned long deadline)
+{
+	int ret;
+	__asm__ volatile ("int $0x80" : "=a" (ret) : "a" (SYS_SCHED_SETRT), "b" (period), "c" (budget), "d" (deadline) : "memory");
+	return ret;
+}
+
+// Counters of the calling task, -1 if it is not a real-time task
+static inline int sched_rtstat(sched_rtstat_t *stat)
+{
+	unsigned long misses, overruns, jobs;
+	__asm__ volatile ("int $0x80" : "=a" (misses), "=b" (overruns), "=c" (jobs) : "a" (SYS_SCHED_RTSTAT) : "memory");
+	if(misses == 0xFFFFFFFF)
+		return -1;
+	stat->misses = misses;
+	stat->overruns = overruns;
+	stat->jobs = jobs;
+	return 0;
+}
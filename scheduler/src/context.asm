@@ -13,7 +13,7 @@
 ; C O N S T A N T S
 ;==================================================================
 
-STACKBUFFER_SIZE EQU 0x3FC ; size of stack per task (1KB)
+STACKBUFFER_SIZE EQU 0xFFC ; size of stack per task (4KB, one page with the used flag)
 
 ; Memory addrs for stack and PCB storage (privDS offset is added for physical addresses)
 PCBBUFFER_ADDR EQU 0x100000
@@ -65,6 +65,9 @@ BITS 32
 EXTERN userCS
 EXTERN userDS
 
+; Address spaces
+%INCLUDE 'src/paging.inc'
+
 ;------------------------------------------------------------------
 ; M A I N   F U N C T I O N S
 ;------------------------------------------------------------------
@@ -72,6 +75,7 @@ EXTERN userDS
 ;------------------------------------------------------------------
 ; INPUT
 ;   ebx      Function address for new task
+;   edx      Page directory to share (0 for new address space)
 ; RETURN
 ;   eax      Pointer to PCB (0 on failure)
 ;------------------------------------------------------------------
@@ -81,6 +85,7 @@ context_new:
 	; Setup new stack
 	;----------------------------------------------------------
 
+	MOV esi, edx				; Store page directory (untouched by malloc)
 	PUSH ebx				; Store new task address
 	CALL stack_malloc			; allocate stack space
 	TEST eax, eax				; check if it worked
@@ -161,10 +166,59 @@ context_new:
 	MOV DWORD [eax+PCB.reg_fs], ebx
 	MOV DWORD [eax+PCB.reg_gs], ebx
 
+	;----------------------------------------------------------
+	; Setup address space
+	;----------------------------------------------------------
+
+	PUSH eax				; Save PCB ptr
+	MOV ebx, esi				; page directory to share
+	TEST ebx, ebx				; new address space?
+	JZ .new_space				; yes
+	CALL pd_get				; no, share it (thread)
+	JMP .set_space
+.new_space:
+	CALL pd_new				; own page directory (process)
+.set_space:
+	MOV edx, eax				; 0 -> runs in kernel address space
+	POP eax					; Restore PCB ptr
+	MOV DWORD [eax+PCB.cr3], edx
+
+	;----------------------------------------------------------
+	; Open stack for ring 3, kernel memory is not accessible
+	;----------------------------------------------------------
+
+	TEST edx, edx				; own address space?
+	JNZ .user_stack				; yes
+	CMP DWORD [kernel_pd], 0		; paging enabled?
+	JE .done				; no, segmentation only
+	JMP .failed				; page directory pool exhausted
+.user_stack:
+	PUSH eax				; Save PCB ptr
+	MOV ebx, DWORD [eax+PCB.stack]		; stack bottom
+	MOV ecx, STACKBUFFER_SIZE		; stack size
+	MOV eax, PD_USER_RW			; read and write for ring 3
+	CALL pd_user
+	MOV ecx, eax				; keep return code
+	POP eax					; Restore PCB ptr
+	TEST ecx, ecx				; check if it worked
+	JZ .done				; it worked
+.failed:
+	PUSH eax				; Save PCB ptr
+	MOV ebx, edx				; page directory
+	CALL pd_put				; release address space
+	POP eax					; Restore PCB ptr
+	MOV ebx, DWORD [eax+PCB.stack]		; get stack-bottom from PCB
+	MOV DWORD [ebx-4], 0			; free user stack
+	MOV DWORD [eax-4], 0			; free PCB
+	XOR eax, eax				; set error code
+	SYSLOG 19, 'PD  '
+	RET					; return eax is passed thru as error code
+
 	;----------------------------------------------------------
 	; Cleanup
 	;----------------------------------------------------------
 
+.done:
 	SYSLOG 9
 	RET					; return eax is passed thru as PCB ptr
 
@@ -189,6 +243,22 @@ context_del:
 	;----------------------------------------------------------
 
 	MOV DWORD [ebx-4], 0		; free PCB -> still valid till function return
+	PUSH ebx			; Save PCB ptr
+	PUSH ecx
+	PUSH edx
+	MOV edx, DWORD [ebx+PCB.cr3]	; get page directory from PCB
+	TEST edx, edx			; own address space?
+	JZ .closed			; no
+	MOV ecx, STACKBUFFER_SIZE	; stack size
+	MOV ebx, DWORD [ebx+PCB.stack]	; stack bottom
+	MOV eax, PD_KERNEL		; close stack for ring 3 before reuse
+	CALL pd_user
+.closed:
+	MOV ebx, edx			; page directory
+	CALL pd_put			; release address space
+	POP edx
+	POP ecx
+	POP ebx				; Restore PCB ptr
 	MOV ebx, DWORD [ebx+PCB.stack]	; get stack-bottom from PCB
 	MOV DWORD [ebx-4], 0		; free user stack
 
@@ -272,6 +342,26 @@ context_set:
 
 	MOV DWORD [eax+PCB.status], 1		; Set status as executing
 
+	;----------------------------------------------------------
+	; Switch address space
+	;----------------------------------------------------------
+
+	; Threads of one process share the page directory, so CR3
+	; is only reloaded if it changes (global kernel pages stay
+	; in the TLB anyways)
+	MOV edx, DWORD [eax+PCB.cr3]		; Load page directory of new task
+	TEST edx, edx				; own address space?
+	JNZ .check_space			; yes
+	MOV edx, DWORD [kernel_pd]		; no, run in kernel address space
+	TEST edx, edx				; paging enabled?
+	JZ .same_space				; no
+.check_space:
+	MOV ecx, cr3				; Load current page directory
+	CMP ecx, edx				; address space changed?
+	JE .same_space				; no -> keep TLB entries
+	MOV cr3, edx				; yes -> switch address space
+.same_space:
+
 	;----------------------------------------------------------
 	; Restore registers
 	;----------------------------------------------------------
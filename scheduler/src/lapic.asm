@@ -0,0 +1,339 @@
+;-----------------------------------------------------------------
+; lapic.asm
+;
+; Local APIC timer for the time slices of the scheduler
+; Architecture specific
+;
+; The timer is armed for every time slice, in TSC-deadline mode if
+; the CPU supports it and in one-shot mode otherwise, so no slow
+; port I/O is needed on a task switch. The execution time of a task
+; is taken from the TSC (calibrated by clock_init of libkernel).
+; The registers are reached thru sel_apic (see scheduler.s), which
+; paging_init maps uncached. If the local APIC is used the PIC is
+; masked completely.
+;
+;-----------------------------------------------------------------
+
+;==================================================================
+; C O N S T A N T S
+;==================================================================
+
+; Interrupt IDs (IDT gates in libkernel isr.s)
+APIC_TIMER_ID EQU 0x30
+APIC_SPURIOUS_ID EQU 0xFF
+
+; Timer modes
+LAPIC_NONE EQU 0
+LAPIC_ONESHOT EQU 1
+LAPIC_DEADLINE EQU 2
+
+; Local APIC registers (offsets in sel_apic)
+APIC_EOI EQU 0x0B0
+APIC_SVR EQU 0x0F0
+APIC_LVT_TIMER EQU 0x320
+APIC_TIMER_ICR EQU 0x380
+APIC_TIMER_CCR EQU 0x390
+APIC_TIMER_DCR EQU 0x3E0
+
+; Register values
+APIC_SVR_ENABLE EQU 0x100 ; software enable
+LVT_MASKED EQU 0x10000
+LVT_DEADLINE EQU 0x40000 ; timer mode TSC-deadline (one-shot is 0)
+DCR_DIV1 EQU 0xB ; divide bus clock by 1
+
+; Model specific registers
+MSR_APIC_BASE EQU 0x1B
+MSR_TSC_DEADLINE EQU 0x6E0
+APIC_BASE_ENABLE EQU 0x800
+APIC_BASE_MASK EQU 0xFFFFF000
+APIC_PHYS EQU 0xFEE00000 ; address mapped by sel_apic
+
+; CPUID features (function 1)
+CPUID_APIC EQU 0x00000200 ; edx
+CPUID_TSC_DEADLINE EQU 0x01000000 ; ecx
+
+; Clock page of libkernel (see libkernel/src/clock.s)
+CP_VERSION EQU 0
+CP_KHZ EQU 20
+
+; Nanoseconds per millisecond
+NS_PER_MS EQU 1000000
+
+;==================================================================
+; S E C T I O N   D A T A
+;==================================================================
+
+SECTION .data
+
+; Timer mode used for time slices
+GLOBAL lapic_mode
+lapic_mode dd LAPIC_NONE
+
+; Local APIC timer ticks per millisecond (one-shot mode)
+lapic_khz dd 0
+
+; TSC at the start of the current time slice
+slice_tsc dq 0
+
+;==================================================================
+; S E C T I O N   C O D E
+;==================================================================
+
+SECTION .text
+BITS 32
+
+;------------------------------------------------------------------
+; E X T E R N A L   S Y M B O L S
+;------------------------------------------------------------------
+
+EXTERN sel_apic
+EXTERN clock_page
+
+;------------------------------------------------------------------
+; M A I N   F U N C T I O N S
+;------------------------------------------------------------------
+
+;------------------------------------------------------------------
+; INPUT
+;   none
+; RETURN
+;   eax      Timer mode (LAPIC_NONE if the PIT has to be used)
+; REMARKS
+;   Has to be called with interrupts disabled after paging_init,
+;   masks the PIC if the local APIC is used. A calibrated TSC is
+;   required, so CPUID is available as well.
+;------------------------------------------------------------------
+GLOBAL lapic_init
+lapic_init:
+	PUSH ebx
+	PUSH ecx
+	PUSH edx
+	PUSH esi
+	PUSH es
+
+	MOV esi, LAPIC_NONE			; set mode for failure
+	CMP DWORD [clock_page+CP_VERSION], 0	; TSC calibrated?
+	JE .cleanup				; no
+
+	;----------------------------------------------------------
+	; Check for a local APIC at its default address
+	;----------------------------------------------------------
+
+	MOV eax, 1				; processor features
+	CPUID
+	TEST edx, CPUID_APIC			; local APIC present?
+	JZ .cleanup				; no
+	MOV ebx, ecx				; keep feature flags
+
+	MOV ecx, MSR_APIC_BASE
+	RDMSR
+	TEST edx, edx				; above 4 GiB?
+	JNZ .cleanup				; yes, not mapped
+	MOV edx, eax
+	AND edx, APIC_BASE_MASK
+	CMP edx, APIC_PHYS			; mapped by sel_apic?
+	JNE .cleanup				; no
+	XOR edx, edx
+	OR eax, APIC_BASE_ENABLE		; enable local APIC
+	WRMSR
+
+	MOV ax, sel_apic			; address local APIC
+	MOV es, ax				;  with ES register
+	MOV DWORD [es:APIC_SVR], APIC_SVR_ENABLE|APIC_SPURIOUS_ID
+
+	;----------------------------------------------------------
+	; TSC-deadline mode needs no calibration
+	;----------------------------------------------------------
+
+	TEST ebx, CPUID_TSC_DEADLINE		; supported?
+	JZ .oneshot				; no
+	MOV DWORD [es:APIC_LVT_TIMER], LVT_DEADLINE|APIC_TIMER_ID
+	MOV esi, LAPIC_DEADLINE
+	JMP .mask_pic
+
+	;----------------------------------------------------------
+	; Count timer ticks during 1 ms of the TSC for one-shot mode
+	;----------------------------------------------------------
+
+.oneshot:
+	MOV DWORD [es:APIC_TIMER_DCR], DCR_DIV1
+	MOV DWORD [es:APIC_LVT_TIMER], LVT_MASKED|APIC_TIMER_ID
+	RDTSC
+	MOV ecx, eax				; TSC at start
+	MOV DWORD [es:APIC_TIMER_ICR], 0xFFFFFFFF
+.calwait:
+	RDTSC
+	SUB eax, ecx				; TSC ticks passed
+	CMP eax, DWORD [clock_page+CP_KHZ]	; 1 ms passed?
+	JB .calwait				; no
+	MOV eax, 0xFFFFFFFF
+	SUB eax, DWORD [es:APIC_TIMER_CCR]	; timer ticks in 1 ms
+	MOV DWORD [es:APIC_TIMER_ICR], 0	; stop timer
+	TEST eax, eax				; timer counting?
+	JZ .cleanup				; no, keep the PIT
+	MOV DWORD [lapic_khz], eax
+	MOV DWORD [es:APIC_LVT_TIMER], APIC_TIMER_ID	; unmask one-shot
+	MOV esi, LAPIC_ONESHOT
+
+	;----------------------------------------------------------
+	; Mask all lines of the PIC
+	;----------------------------------------------------------
+
+.mask_pic:
+	MOV al, 0xFF
+	OUT 0x21, al				; master PIC
+	OUT 0xA1, al				; slave PIC
+
+	;----------------------------------------------------------
+	; Cleanup
+	;----------------------------------------------------------
+
+.cleanup:
+	MOV DWORD [lapic_mode], esi
+	MOV eax, esi				; return mode
+	POP es
+	POP esi
+	POP edx
+	POP ecx
+	POP ebx
+	RET
+
+;------------------------------------------------------------------
+; INPUT
+;   eax      Length of the time slice in nanoseconds (up to 1 s)
+; RETURN
+;   none
+; REMARKS
+;   Starts the time slice even without local APIC, so lapic_elapsed
+;   can be used for accounting
+;------------------------------------------------------------------
+GLOBAL lapic_arm
+lapic_arm:
+	PUSH eax
+	PUSH ebx
+	PUSH ecx
+	PUSH edx
+
+	MOV ecx, eax				; keep length
+	RDTSC
+	MOV DWORD [slice_tsc], eax		; start of time slice
+	MOV DWORD [slice_tsc+4], edx
+
+	CMP DWORD [lapic_mode], LAPIC_DEADLINE
+	JNE .oneshot
+
+	;----------------------------------------------------------
+	; Deadline = start + ns * kHz / NS_PER_MS, the quotient is
+	; divided in two steps as it passes 32 bits above 4.3 GHz
+	;----------------------------------------------------------
+
+	MOV eax, ecx
+	MUL DWORD [clock_page+CP_KHZ]
+	MOV ecx, eax				; keep low dword
+	MOV eax, edx
+	XOR edx, edx
+	MOV ebx, NS_PER_MS
+	DIV ebx					; high dword of quotient
+	XCHG eax, ecx
+	DIV ebx					; low dword of quotient
+	MOV edx, ecx				; TSC ticks of time slice
+	ADD eax, DWORD [slice_tsc]
+	ADC edx, DWORD [slice_tsc+4]
+	MOV ecx, MSR_TSC_DEADLINE
+	WRMSR					; arm timer
+	JMP .cleanup
+
+	;----------------------------------------------------------
+	; Initial count = ns * timer kHz / NS_PER_MS (at least 1,
+	; at most 0xFFFFFFFF)
+	;----------------------------------------------------------
+
+.oneshot:
+	CMP DWORD [lapic_mode], LAPIC_ONESHOT
+	JNE .cleanup
+	MOV eax, ecx
+	MUL DWORD [lapic_khz]
+	MOV ecx, NS_PER_MS
+	CMP edx, ecx				; quotient fits?
+	JAE .maxcount				; no
+	DIV ecx					; timer ticks of time slice
+	CMP eax, 1				; zero?
+	ADC eax, 0				;  count at least 1
+	JMP .setcount
+.maxcount:
+	MOV eax, 0xFFFFFFFF
+.setcount:
+	PUSH es
+	MOV cx, sel_apic			; address local APIC
+	MOV es, cx				;  with ES register
+	MOV DWORD [es:APIC_TIMER_ICR], eax	; arm timer
+	POP es
+
+	;----------------------------------------------------------
+	; Cleanup
+	;----------------------------------------------------------
+
+.cleanup:
+	POP edx
+	POP ecx
+	POP ebx
+	POP eax
+	RET
+
+;------------------------------------------------------------------
+; INPUT
+;   none
+; RETURN
+;   eax      Nanoseconds since the last lapic_arm (0xFFFFFFFF if
+;            longer than 4 s)
+;------------------------------------------------------------------
+GLOBAL lapic_elapsed
+lapic_elapsed:
+	PUSH ecx
+	PUSH edx
+
+	RDTSC
+	SUB eax, DWORD [slice_tsc]		; TSC ticks passed
+	SBB edx, DWORD [slice_tsc+4]
+	JNZ .overflow				; way too long
+	MOV ecx, NS_PER_MS
+	MUL ecx					; ticks * NS_PER_MS
+	MOV ecx, DWORD [clock_page+CP_KHZ]
+	CMP edx, ecx				; quotient fits (kHz > 0)?
+	JAE .overflow				; no
+	DIV ecx					; nanoseconds
+	JMP .cleanup
+.overflow:
+	MOV eax, 0xFFFFFFFF
+
+	;----------------------------------------------------------
+	; Cleanup
+	;----------------------------------------------------------
+
+.cleanup:
+	POP edx
+	POP ecx
+	RET
+
+;------------------------------------------------------------------
+; INPUT
+;   none
+; RETURN
+;   none
+; REMARKS
+;   Signals the end of a local APIC interrupt, does nothing if the
+;   local APIC is not used
+;------------------------------------------------------------------
+GLOBAL lapic_eoi
+lapic_eoi:
+	CMP DWORD [lapic_mode], LAPIC_NONE	; local APIC used?
+	JE .done				; no
+	PUSH eax
+	PUSH es
+	MOV ax, sel_apic			; address local APIC
+	MOV es, ax				;  with ES register
+	MOV DWORD [es:APIC_EOI], 0		; end of interrupt
+	POP es
+	POP eax
+.done:
+	RET
@@ -29,6 +29,38 @@ p_offset	EQU	0x04    ; offset to seg file-offset
 p_paddr		EQU	0x0C    ; offset to seg phys addr
 p_filesz	EQU	0x10    ; offset to seg size in file
 p_memsz		EQU	0x14    ; offset to seg size in mem
+p_flags		EQU	0x18    ; offset to seg flags
+PF_W		EQU	   2    ; segment is writable
+
+;------------------------------------------------------------------
+; equates for demand loading
+;------------------------------------------------------------------
+PAGE_SIZE	EQU   0x1000
+PF_PRESENT	EQU	   1    ; error code: page was present
+ISR_PGF_ID	EQU	0x0E    ; page fault exception
+ELF_REGION_MAX	EQU	   8    ; max number of loadable segments
+ELF_IMAGE_MAX	EQU  0x20000    ; file data above is overwritten by PCBs
+ELF_IMAGE	EQU 0x100000    ; linear address of the image (see sel_extmem)
+RAMFS_MAX_NAME	EQU	  32    ; length of a program name
+
+;==================================================================
+; S T R U C T U R E S
+;==================================================================
+
+;------------------------------------------------------------------
+; Loadable segment of the ELF image (filled on first touch)
+;------------------------------------------------------------------
+
+STRUC REGION
+.vaddr:		RESD 1 ; start address in memory
+.memsz:		RESD 1 ; size in memory
+.offset:	RESD 1 ; offset in file
+.filesz:	RESD 1 ; size in file (rest is zeroed)
+.flags:		RESD 1 ; segment flags (PF_W -> private per process)
+
+; Struct size
+.size:
+ENDSTRUC
 
 ;==================================================================
 ; S E C T I O N   D A T A
@@ -42,6 +74,14 @@ SECTION .data
 
 PID dd 0
 
+;------------------------------------------------------------------
+; E L F   R E G I O N S
+;------------------------------------------------------------------
+
+elf_region_num dd 0
+elf_regions times ELF_REGION_MAX*REGION.size db 0
+elf_entry dd 0
+
 ;------------------------------------------------------------------
 ; S T R I N G S
 ;------------------------------------------------------------------
@@ -72,19 +112,31 @@ BITS 32
 ; Converter "Syscall"
 EXTERN uint32_to_dec
 
+; Ramdisk
+EXTERN ramfs_exec
+EXTERN ramfs_name
+
 ; Syslog
 %INCLUDE 'src/syslog.inc'
 
 ; Scheduler Syscalls
 %INCLUDE 'src/scheduler.inc'
 EXTERN scheduler_start
+EXTERN scheduler_newTask
+
+; Address spaces
+%INCLUDE 'src/paging.inc'
 
 ; IRQ
 EXTERN remap_isr_pm
 EXTERN register_isr
 
+; Local APIC timer
+%INCLUDE 'src/lapic.inc'
+
 ; Task-Switching
 EXTERN selTSS
+EXTERN bail_out
 EXTERN sel_extmem
 EXTERN userDS
 EXTERN privDS
@@ -95,10 +147,105 @@ EXTERN privDS
 
 timer_irq:
 	SYSLOG 16, "PIT "
+	CALL lapic_eoi			; local APIC timer (PIC gets EOI from isr.s)
+	CALL sched_preempt		; task did not yield
 	EXTERN scheduler_yield
 	JMP scheduler_yield		; Call scheduler from timer interrupt
 	; tickcounter is not updated! -> does not work with used timer mode
 	
+;------------------------------------------------------------------
+; P A G E   F A U L T
+;------------------------------------------------------------------
+
+page_fault:
+	;----------------------------------------------------------
+	; Find ELF region of faulting address
+	;----------------------------------------------------------
+
+	TEST DWORD [ebp+52], PF_PRESENT	; protection violation?
+	JNZ .Lpferror			;  yes, not a lazy page
+	MOV ebx, cr2			; faulting address
+	MOV esi, elf_regions		; first region
+	MOV ecx, DWORD [elf_region_num]	; count of regions
+	JECXZ .Lpferror			;  nothing loaded on demand
+.Lpfregion:
+	MOV eax, ebx			; faulting address
+	SUB eax, DWORD [esi+REGION.vaddr]	; offset in region
+	CMP eax, DWORD [esi+REGION.memsz]	; inside region?
+	JB .Lpffound			;  yes
+	ADD esi, REGION.size		; next region
+	LOOP .Lpfregion
+	JMP .Lpferror			; not part of the ELF image
+
+	;----------------------------------------------------------
+	; Map and clear page
+	;----------------------------------------------------------
+
+.Lpffound:
+	PUSHFD				; Save flags
+	CLI				; no task switch before page is filled
+	AND ebx, ~(PAGE_SIZE-1)		; page of faulting address
+	CALL pte_map			; map page, ebx is passed thru
+	TEST eax, eax			; check if it worked
+	JZ .Lpfmapped			;  yes, page has to be filled
+	POPFD				; restore flags
+	CMP eax, 1			; shared page filled by another task?
+	JNE .Lpferror			;  no, no page table or frame
+	RET				; retry faulting instruction
+.Lpfmapped:
+	MOV ax, userDS			; address entire memory
+	MOV es, ax			;  with ES register
+	MOV edi, ebx			; ES:EDI is page
+	MOV ecx, PAGE_SIZE/4		; dwords to clear
+	XOR eax, eax			; use zero for filling
+	CLD				; do forward processing
+	REP STOSD			; clear page (BSS)
+
+	;----------------------------------------------------------
+	; Copy file data of all regions sharing the page
+	;----------------------------------------------------------
+
+	MOV edx, elf_regions		; first region
+	MOV ecx, DWORD [elf_region_num]	; count of regions
+.Lpfcopy:
+	PUSH ecx			; save loop-counter
+	MOV edi, DWORD [edx+REGION.vaddr]	; start of file data
+	MOV ecx, edi
+	ADD ecx, DWORD [edx+REGION.filesz]	; end of file data
+	LEA eax, [ebx+PAGE_SIZE]	; end of page
+	CMP ecx, eax			; file data ends in page?
+	JBE .Lpfend			;  yes
+	MOV ecx, eax			;  no, copy till end of page
+.Lpfend:
+	CMP edi, ebx			; file data starts in page?
+	JAE .Lpfstart			;  yes
+	MOV edi, ebx			;  no, copy from start of page
+.Lpfstart:
+	SUB ecx, edi			; length for copying
+	JBE .Lpfnext			;  no file data in page
+	MOV esi, edi			; address in memory
+	SUB esi, DWORD [edx+REGION.vaddr]	; offset in region
+	ADD esi, DWORD [edx+REGION.offset]	; offset in file
+	PUSH ds				; save data segment
+	MOV ax, sel_extmem		; address ELF file-image
+	MOV ds, ax			;  with DS register
+	REP MOVSB			; 'load' part of program-segment
+	POP ds				; restore data segment
+.Lpfnext:
+	POP ecx				; recover loop-counter
+	ADD edx, REGION.size		; next region
+	LOOP .Lpfcopy
+	POPFD				; restore flags
+	RET				; retry faulting instruction
+
+	;----------------------------------------------------------
+	; Page fault outside of the ELF image
+	;----------------------------------------------------------
+
+.Lpferror:
+	SYSLOG 20
+	JMP bail_out			; halt system
+
 ;------------------------------------------------------------------
 ; M A I N   F U N C T I O N
 ;------------------------------------------------------------------
@@ -112,6 +259,15 @@ main:
 	CALL remap_isr_pm		; remap IRQ-lines
 	STI				; enable here because flags are copied on task creation
 
+	;----------------------------------------------------------
+	; Setup Page Fault Handler
+	;----------------------------------------------------------
+
+	PUSH page_fault
+	PUSH ISR_PGF_ID			; Interrupt ID
+	CALL register_isr
+	ADD esp, 8
+
 ;-------;----------------------------------------------------------
 	; Copied and rewritten in Intel syntax from elfexec subproject
 	;----------------------------------------------------------
@@ -128,6 +284,24 @@ main:
 	CMP WORD [fs:e_type], ET_EXEC	; check type is 'executable'
 	JNE .Lelferror			;  no, handle elf error
 
+;-------;----------------------------------------------------------
+
+	;----------------------------------------------------------
+	; Enable paging -> every task gets its own page directory
+	;----------------------------------------------------------
+
+	CALL paging_init		; keeps segmentation only if unsupported
+
+	;----------------------------------------------------------
+	; Record program-segments -> loaded on first touch
+	;----------------------------------------------------------
+
+	CALL elf_record			; all segments recorded?
+	TEST eax, eax
+	JZ .Lloaded			;  yes, loading isn't needed
+
+;-------;----------------------------------------------------------
+	; Fallback: eager loading as in the original elfexec subproject
 	;-----------------------------------------------------------
 	; setup segment-registers for 'loading' program-segments
 	;-----------------------------------------------------------
@@ -170,14 +344,19 @@ main:
 ;-------;----------------------------------------------------------
 
 	;----------------------------------------------------------
-	; Scheduler Tasks Setup (Original loaded ELF-file might be overwritten)
+	; Scheduler Tasks Setup (Original loaded ELF-file might be
+	; overwritten above ELF_IMAGE_MAX), every process shares the
+	; text of the ELF image and gets own data and BSS pages, the
+	; program starts more processes by name (SYS_EXECNAME)
 	;----------------------------------------------------------
 	
+.Lloaded:
 	MOV ebx, DWORD [fs:e_entry]	; start address of task
 	MOV ax, privDS			; setup data segments to be sure
 	MOV ds, ax
 	MOV es, ax
 	MOV fs, ax
+	MOV DWORD [elf_entry], ebx	; for exec by name
 	MOV eax, SYS_EXEC
 	INT 0x80			; create new task
 	MOV DWORD [PID], eax		; store new task PID
@@ -187,9 +366,15 @@ main:
 	;----------------------------------------------------------
 
 	; Register IRQ handler
-	CLI				; disable interrupts until PIT is properly setup
+	CLI				; disable interrupts until timer is properly setup
+	CALL lapic_init			; local APIC timer instead of PIT?
+	MOV ebx, APIC_TIMER_ID		; Interrupt ID
+	TEST eax, eax
+	JNZ .Lsettimer			;  yes, PIC is masked
+	MOV ebx, 0x20			; Interrupt ID of PIT
+.Lsettimer:
 	PUSH timer_irq
-	PUSH 0x20			; Interrupt ID
+	PUSH ebx
 	CALL register_isr
 	ADD esp, 8
 
@@ -233,3 +418,159 @@ main:
 	INT 0x80
 	RET				; return from kernel main
 
+;------------------------------------------------------------------
+; (ONLY FROM USER MODE thru INT)
+; INPUT
+;   ebx			Name of program in the ramdisk
+; RETURN
+;   eax on STACK	PID (0xFFFFFFFF on failure)
+; REMARKS
+;   The program is looked up in the directory of the ramdisk. The
+;   regions loaded on demand are recorded once for all address
+;   spaces, so only the image the scheduler was booted with can be
+;   started, as another process sharing its text.
+;------------------------------------------------------------------
+GLOBAL scheduler_execName
+scheduler_execName:
+	;----------------------------------------------------------
+	; Copy name from the caller's segment
+	;----------------------------------------------------------
+
+	PUSH ds				; save data segment
+	MOV ax, userDS			; address caller's memory
+	MOV ds, ax			;  with DS register
+	MOV esi, ebx			; DS:ESI is name
+	MOV edi, ramfs_name		; ES:EDI is buffer
+	MOV ecx, RAMFS_MAX_NAME		; length of buffer
+	CLD				; do forward processing
+.Lxcopy:
+	LODSB				; copy character
+	STOSB
+	TEST al, al			; end of name?
+	JZ .Lxcopied			;  yes
+	LOOP .Lxcopy
+	MOV BYTE [es:edi], 0		; terminate a long name
+.Lxcopied:
+	POP ds				; restore data segment
+
+	;----------------------------------------------------------
+	; Look up program and start it
+	;----------------------------------------------------------
+
+	PUSH ramfs_name
+	CALL ramfs_exec			; C function overwrites registers
+	ADD esp, 4
+	CMP eax, ELF_IMAGE		; image the scheduler was booted with?
+	JNE .Lxerror			;  no, or not found
+	MOV ebx, DWORD [elf_entry]	; start address of task
+	JMP scheduler_newTask		; PID is saved in interrupt stack
+.Lxerror:
+	MOV DWORD [ebp+44], 0xFFFFFFFF	; save eax error code in interrupt stack
+	RET				; return to interrupt handler
+
+;------------------------------------------------------------------
+; H E L P E R   F U N C T I O N S
+;------------------------------------------------------------------
+
+;------------------------------------------------------------------
+; INPUT
+;   fs       ELF file-image
+; RETURN
+;   eax      0 if all program-segments are loaded on demand
+; REMARKS
+;   Needs paging and file data below ELF_IMAGE_MAX, otherwise the
+;   program-segments have to be copied right away. Pages already
+;   marked for demand loading are then filled by the copy itself.
+;------------------------------------------------------------------
+elf_record:
+	MOV eax, -1			; set error code
+	CMP DWORD [kernel_pd], 0	; paging enabled?
+	JE .Lrecret			;  no
+
+	;----------------------------------------------------------
+	; extract load-information from the ELF-file's image
+	;----------------------------------------------------------
+
+	MOV ebx, DWORD [fs:e_phoff]	; segment-table's offset
+	MOVZX ecx, WORD [fs:e_phnum]	; count of table entries
+	MOVZX edx, WORD [fs:e_phentsize]	; length of table entries
+	MOV edi, elf_regions		; first region
+	JECXZ .Lrecdone			;  no segments at all
+
+.Lrecseg:
+	CMP DWORD [fs:ebx+p_type], PT_LOAD	; segment-type 'LOADABLE'?
+	JNE .Lrecnext			;  no, loading isn't needed
+	CMP edi, elf_regions+ELF_REGION_MAX*REGION.size	; space left?
+	JAE .Lrecfail			;  no
+	MOV eax, DWORD [fs:ebx+p_offset]	; offset in file
+	MOV DWORD [edi+REGION.offset], eax
+	ADD eax, DWORD [fs:ebx+p_filesz]	; end of file data
+	CMP eax, ELF_IMAGE_MAX		; still intact when task runs?
+	JA .Lrecfail			;  no
+	MOV eax, DWORD [fs:ebx+p_filesz]
+	MOV DWORD [edi+REGION.filesz], eax
+	MOV eax, DWORD [fs:ebx+p_paddr]
+	MOV DWORD [edi+REGION.vaddr], eax
+	MOV eax, DWORD [fs:ebx+p_memsz]
+	MOV DWORD [edi+REGION.memsz], eax
+	MOV eax, DWORD [fs:ebx+p_flags]
+	MOV DWORD [edi+REGION.flags], eax
+	ADD edi, REGION.size		; next region
+.Lrecnext:
+	ADD ebx, edx			; advance to next record
+	LOOP .Lrecseg			; process another record
+
+.Lrecdone:
+	SUB edi, elf_regions		; size of recorded regions
+	MOV eax, edi
+	XOR edx, edx
+	MOV ecx, REGION.size
+	DIV ecx				; count of regions
+	MOV DWORD [elf_region_num], eax
+
+	;----------------------------------------------------------
+	; mark pages of the regions as not present
+	;----------------------------------------------------------
+
+	MOV esi, elf_regions		; first region
+	MOV edx, eax			; count of regions
+	TEST edx, edx
+	JZ .Lrecret			;  nothing to load, eax is 0
+.Lreclazy:
+	MOV ebx, DWORD [esi+REGION.vaddr]	; start of region
+	MOV ecx, DWORD [esi+REGION.memsz]	; length of region
+	CALL paging_lazy		; eax 0 on success
+	TEST eax, eax
+	JNZ .Lrecret			; copy segments, faults fill marked pages
+	ADD esi, REGION.size		; next region
+	DEC edx
+	JNZ .Lreclazy
+
+	;----------------------------------------------------------
+	; mark pages of writable regions as private, afterwards so
+	; a page shared with text is private as well
+	;----------------------------------------------------------
+
+	MOV esi, elf_regions		; first region
+	MOV edx, DWORD [elf_region_num]	; count of regions
+.Lrecpriv:
+	TEST DWORD [esi+REGION.flags], PF_W	; data or BSS?
+	JZ .Lrecshared			;  no, text is shared by all tasks
+	MOV ebx, DWORD [esi+REGION.vaddr]	; start of region
+	MOV ecx, DWORD [esi+REGION.memsz]	; length of region
+	CALL paging_private		; eax 0 on success
+	TEST eax, eax
+	JNZ .Lrecret			; copy segments, faults fill marked pages
+.Lrecshared:
+	ADD esi, REGION.size		; next region
+	DEC edx
+	JNZ .Lrecpriv
+	XOR eax, eax			; set return code success
+	JMP .Lrecret
+
+.Lrecfail:
+	MOV DWORD [elf_region_num], 0	; load everything right away
+	MOV eax, -1			; set error code
+.Lrecret:
+	RET
+
@@ -0,0 +1,1008 @@
+;-----------------------------------------------------------------
+; paging.asm
+;
+; Page directories for the address spaces of the tasks
+; Architecture specific
+;
+; Every process gets its own page directory, threads share the
+; page directory of the process which created them. Like the
+; identity map of pgftdemo (see pgftdemo/src/paging.s) 4 MiB pages
+; are used, the kernel part is marked global so it survives CR3
+; reloads on context switches.
+;
+; Kernel memory is mapped for ring 0 only. The entries holding the
+; task stacks point to page tables of their own in every page
+; directory, where only the stacks of the tasks using it (and the
+; code of the idle task) are made accessible for ring 3. These
+; entries are not global, as their user bits differ between the
+; address spaces.
+;
+; Regions which are loaded on demand (the ELF image) are mapped by
+; page tables instead. Pages of text and read-only data are filled
+; once into the frame at the same physical address and mapped
+; read-only into every address space. Page tables holding data or
+; BSS pages are copied for each process, which gets own frames from
+; the pool for these pages.
+;
+;-----------------------------------------------------------------
+
+;==================================================================
+; C O N S T A N T S
+;==================================================================
+
+; Linear address offset of privDS
+PRIVDS_BASE EQU 0x20000
+
+; Stack storage of the tasks (see context.asm), ring 3 uses the
+; privDS offsets as linear addresses
+STACKBUFFER_ADDR EQU 0x200000
+STACKBUFFER_MAX EQU 0x800000
+STACK_PDE_FIRST EQU STACKBUFFER_ADDR>>22
+STACK_PDE_END EQU (STACKBUFFER_MAX+(1<<22)-1)>>22
+
+; Memory addrs for page directory, page table and private frame storage (privDS offset is added for physical addresses)
+PAGE_SIZE EQU 0x1000
+PD_SIZE EQU PAGE_SIZE
+PDPOOL_ADDR EQU 0xF00000
+PDPOOL_MAX EQU 0x1000000
+PDPOOL_NUM EQU (PDPOOL_MAX-PDPOOL_ADDR)/PD_SIZE
+
+; Page directory layout
+; Entries below KERNEL_PDE_NUM map the kernel memory (code, PCBs,
+; stacks, syslog and page directories) and are global, entries up
+; to USER_PDE_NUM map the memory reachable thru userDS (512 MiB)
+; and the entry of the local APIC registers is kernel only
+KERNEL_PDE_NUM EQU 8 ; 32 MiB
+USER_PDE_NUM EQU 128 ; 512 MiB
+PDE_ENTRIES EQU 1024
+PTE_ENTRIES EQU 1024
+
+; Page directory entry flags
+PG_PRESENT EQU 0x001
+PG_WRITE EQU 0x002
+PG_USER EQU 0x004
+PG_PWT EQU 0x008
+PG_PCD EQU 0x010
+PG_LARGE EQU 0x080
+PG_GLOBAL EQU 0x100
+PG_PRIVATE EQU 0x200 ; available bit: page gets an own frame per process
+PG_LARGE_MASK EQU 0xFFC00000
+
+; Registers of the local APIC (see lapic.asm)
+APIC_PHYS EQU 0xFEE00000
+
+; CPUID and control register bits
+EFLAGS_ID EQU 0x00200000
+CPUID_PSE EQU 0x00000008
+CPUID_PGE EQU 0x00002000
+CR0_PG EQU 0x80000000
+CR4_PSE EQU 0x00000010
+CR4_PGE EQU 0x00000080
+
+;==================================================================
+; S E C T I O N   D A T A
+;==================================================================
+
+SECTION .data
+
+;------------------------------------------------------------------
+; P A G E   D I R E C T O R I E S
+;------------------------------------------------------------------
+
+; Physical address of the page directory of the kernel (0 without paging)
+GLOBAL kernel_pd
+kernel_pd dd 0
+
+; Number of tasks using each page directory of the pool (0 = free)
+; page tables and frames keep a count of 1, the ones of the kernel
+; page directory are never freed, private ones are freed together
+; with their page directory
+pd_refs times PDPOOL_NUM dd 0
+
+; Page directory entries whose page table is copied for each process
+pde_private times USER_PDE_NUM db 0
+
+;==================================================================
+; S E C T I O N   C O D E
+;==================================================================
+
+SECTION .text
+BITS 32
+
+;------------------------------------------------------------------
+; M A I N   F U N C T I O N S
+;------------------------------------------------------------------
+
+;------------------------------------------------------------------
+; INPUT
+;   none
+; RETURN
+;   eax      Physical address of kernel page directory (0 if
+;            paging is not supported)
+; REMARKS
+;   Paging needs 4 MiB pages (PSE), without them the scheduler
+;   keeps running with segmentation only
+;------------------------------------------------------------------
+GLOBAL paging_init
+paging_init:
+	PUSH ebx
+	PUSH ecx
+	PUSH edx
+	PUSH esi
+	PUSH edi
+
+	;----------------------------------------------------------
+	; Check CPUID support (EFLAGS.ID can be toggled)
+	;----------------------------------------------------------
+
+	PUSHFD					; load flags
+	POP eax
+	MOV ecx, eax				; keep original flags
+	XOR eax, EFLAGS_ID			; toggle ID flag
+	PUSH eax
+	POPFD					; and try to store it
+	PUSHFD					; reload flags
+	POP eax
+	PUSH ecx
+	POPFD					; restore original flags
+	XOR eax, ecx				; check if ID flag changed
+	JZ .no_paging				; no CPUID -> no paging
+
+	;----------------------------------------------------------
+	; Check for 4 MiB pages and global pages
+	;----------------------------------------------------------
+
+	MOV eax, 1				; processor features
+	CPUID
+	TEST edx, CPUID_PSE			; 4 MiB pages supported?
+	JZ .no_paging				; no
+	MOV esi, edx				; keep feature flags
+
+	;----------------------------------------------------------
+	; Build kernel page directory (first entry of pool)
+	;----------------------------------------------------------
+
+	MOV edi, PDPOOL_ADDR			; dest addr of kernel page directory
+	XOR ecx, ecx				; clear counter
+	MOV edx, PG_LARGE|PG_WRITE|PG_PRESENT	; flags of identity mapping
+.kernel_pde:
+	MOV eax, ecx				; page directory index
+	SHL eax, 22				; to linear address
+	OR eax, edx				; add flags
+	CMP ecx, KERNEL_PDE_NUM			; kernel memory?
+	JAE .user_pde				; no
+	CMP ecx, STACK_PDE_FIRST		; task stacks in it?
+	JB .global_pde				; no
+	CMP ecx, STACK_PDE_END
+	JB .store_pde				; yes, user bits differ per address space
+.global_pde:
+	OR eax, PG_GLOBAL			; keep in TLB on CR3 reload
+	JMP .store_pde
+.user_pde:
+	OR eax, PG_USER				; accessible for ring 3
+	CMP ecx, USER_PDE_NUM			; memory reachable thru userDS?
+	JB .store_pde				; yes
+	XOR eax, eax				; no, not present
+.store_pde:
+	MOV DWORD [edi+4*ecx], eax		; store entry
+	INC ecx					; increment counter
+	CMP ecx, PDE_ENTRIES			; all entries done?
+	JB .kernel_pde				; no, next one
+
+	;----------------------------------------------------------
+	; Map the local APIC registers uncached (kernel only)
+	;----------------------------------------------------------
+
+	MOV DWORD [edi+4*(APIC_PHYS>>22)], (APIC_PHYS&PG_LARGE_MASK)|PG_LARGE|PG_GLOBAL|PG_PCD|PG_PWT|PG_WRITE|PG_PRESENT
+
+	MOV DWORD [pd_refs], 1			; kernel page directory is never freed
+	LEA eax, [edi+PRIVDS_BASE]		; physical address
+	MOV DWORD [kernel_pd], eax		; store for new page directories
+
+	;----------------------------------------------------------
+	; Enable paging
+	;----------------------------------------------------------
+
+	MOV cr3, eax				; load kernel page directory
+	MOV eax, cr4
+	OR eax, CR4_PSE				; enable 4 MiB pages
+	MOV cr4, eax
+	MOV eax, cr0
+	OR eax, CR0_PG				; enable paging
+	MOV cr0, eax
+
+	TEST esi, CPUID_PGE			; global pages supported?
+	JZ .done				; no
+	MOV eax, cr4
+	OR eax, CR4_PGE				; enable global pages
+	MOV cr4, eax
+
+.done:
+	MOV eax, DWORD [kernel_pd]		; return kernel page directory
+	JMP .cleanup
+
+.no_paging:
+	XOR eax, eax				; paging not supported
+
+	;----------------------------------------------------------
+	; Cleanup
+	;----------------------------------------------------------
+
+.cleanup:
+	POP edi
+	POP esi
+	POP edx
+	POP ecx
+	POP ebx
+	RET
+
+;------------------------------------------------------------------
+; INPUT
+;   none
+; RETURN
+;   eax      Physical address of new page directory (0 on failure
+;            or if paging is not enabled)
+;------------------------------------------------------------------
+GLOBAL pd_new
+pd_new:
+	PUSH ebx
+	PUSH ecx
+	PUSH edx
+	PUSH esi
+	PUSH edi
+
+	;----------------------------------------------------------
+	; Check paging
+	;----------------------------------------------------------
+
+	XOR eax, eax				; set error code
+	CMP DWORD [kernel_pd], 0		; paging enabled?
+	JE .cleanup				; no
+
+	;----------------------------------------------------------
+	; Claim page directory from pool
+	;----------------------------------------------------------
+
+	CALL pool_alloc				; claim page directory
+	TEST eax, eax				; check if it worked
+	JZ .cleanup				; pool exhausted, eax is still 0
+
+	;----------------------------------------------------------
+	; Copy kernel page directory (global entries and shared
+	; page tables included)
+	;----------------------------------------------------------
+
+	MOV edi, eax				; dest addr of new page directory
+	MOV esi, DWORD [kernel_pd]		; src addr of kernel page directory
+	SUB esi, PRIVDS_BASE			; physical to privDS address
+	MOV ecx, PDE_ENTRIES			; dwords to copy
+	PUSH es					; Save extra segment
+	PUSH ds					; Replace extra with data segment
+	POP es
+	CLD					; Process copy upwards
+	REP MOVSD				; Move dword from ds:esi to es:edi and decrement ecx by 1
+	POP es					; Restore extra segment
+
+	LEA edx, [edi-PD_SIZE]			; new page directory
+
+	;----------------------------------------------------------
+	; Own page tables for the entries holding the task stacks,
+	; all pages are kernel only until pd_user opens them
+	;----------------------------------------------------------
+
+	MOV ebx, STACK_PDE_FIRST		; first entry with stacks
+.stack_pde:
+	CALL pool_alloc				; claim page table
+	TEST eax, eax				; check if it worked
+	JZ .failed				; pool exhausted
+	MOV edi, eax				; dest addr of page table
+	LEA eax, [edi+PRIVDS_BASE+(PG_USER|PG_WRITE|PG_PRESENT)]	; physical address and flags
+	MOV DWORD [edx+4*ebx], eax		; replace 4 MiB page
+	MOV eax, ebx				; page directory index
+	SHL eax, 22				; to linear address
+	OR eax, PG_WRITE|PG_PRESENT		; identity mapping, kernel only
+	MOV ecx, PTE_ENTRIES			; entries to fill
+.fill_stack_pte:
+	MOV DWORD [edi], eax			; store entry
+	ADD eax, PAGE_SIZE			; next frame
+	ADD edi, 4				; next entry
+	LOOP .fill_stack_pte
+	INC ebx					; increment counter
+	CMP ebx, STACK_PDE_END			; all entries with stacks done?
+	JB .stack_pde				; no, next one
+
+	;----------------------------------------------------------
+	; Copy page tables with private pages, their entries are
+	; reset so the pages are filled on first touch
+	;----------------------------------------------------------
+
+	MOV ebx, KERNEL_PDE_NUM			; first user entry
+.private_pde:
+	CMP BYTE [pde_private+ebx], 0		; private pages in it?
+	JE .next_pde				; no, keep shared page table
+	CALL pool_alloc				; claim page table
+	TEST eax, eax				; check if it worked
+	JZ .failed				; pool exhausted
+	MOV edi, eax				; dest addr of page table
+	MOV esi, DWORD [edx+4*ebx]		; shared page table (split by paging_private)
+	AND esi, ~(PAGE_SIZE-1)
+	SUB esi, PRIVDS_BASE			; physical to privDS address
+	LEA eax, [edi+PRIVDS_BASE+(PG_USER|PG_WRITE|PG_PRESENT)]	; physical address and flags
+	MOV DWORD [edx+4*ebx], eax		; replace shared page table
+	MOV ecx, PTE_ENTRIES			; entries to copy
+.copy_pte:
+	MOV eax, DWORD [esi]			; load shared entry
+	TEST eax, PG_PRIVATE			; private page?
+	JZ .store_pte				; no, share frame
+	MOV eax, PG_PRIVATE			; yes, not present in new address space
+.store_pte:
+	MOV DWORD [edi], eax			; store entry
+	ADD esi, 4				; next entries
+	ADD edi, 4
+	LOOP .copy_pte
+.next_pde:
+	INC ebx					; increment counter
+	CMP ebx, USER_PDE_NUM			; all user entries done?
+	JB .private_pde				; no, next one
+
+	LEA eax, [edx+PRIVDS_BASE]		; physical address of new page directory
+	JMP .cleanup
+
+.failed:
+	LEA ebx, [edx+PRIVDS_BASE]		; physical address of new page directory
+	CALL pd_put				; release it with copied page tables
+	XOR eax, eax				; set error code
+
+	;----------------------------------------------------------
+	; Cleanup
+	;----------------------------------------------------------
+
+.cleanup:
+	POP edi
+	POP esi
+	POP edx
+	POP ecx
+	POP ebx
+	RET
+
+;------------------------------------------------------------------
+; INPUT
+;   ebx      Physical address of page directory to share
+; RETURN
+;   eax      Physical address of page directory (ebx is passed thru)
+;------------------------------------------------------------------
+GLOBAL pd_get
+pd_get:
+	CALL pd_index			; get index in pool
+	CMP eax, PDPOOL_NUM		; valid page directory?
+	JAE .cleanup			; no
+	INC DWORD [pd_refs+4*eax]	; one more user
+.cleanup:
+	MOV eax, ebx			; return page directory
+	RET
+
+;------------------------------------------------------------------
+; INPUT
+;   ebx      Physical address of page directory to release
+; RETURN
+;   none
+; REMARKS
+;   The page directory is freed with its private page tables and
+;   frames if it is not used by any other task, but stays intact
+;   until it is reused, so the current CR3 may still point to it
+;   until the next context is set
+;------------------------------------------------------------------
+GLOBAL pd_put
+pd_put:
+	CALL pd_index			; get index in pool
+	TEST eax, eax			; kernel page directory?
+	JZ .cleanup			; yes, never freed
+	CMP eax, PDPOOL_NUM		; valid page directory?
+	JAE .cleanup			; no
+	CMP DWORD [pd_refs+4*eax], 0	; already free?
+	JE .cleanup			; yes
+	DEC DWORD [pd_refs+4*eax]	; one user less
+	JNZ .cleanup			; still used
+	CALL pd_release			; free private page tables and frames
+.cleanup:
+	RET
+
+;------------------------------------------------------------------
+; INPUT
+;   eax      Access for ring 3: PG_USER|PG_WRITE, PG_USER (read-only)
+;            or 0 (kernel only)
+;   ebx      Linear start address of region
+;   ecx      Length of region in bytes
+;   edx      Physical address of page directory
+; RETURN
+;   eax      0 on success, -1 if the region is not mapped by own
+;            page tables of the page directory
+; REMARKS
+;   Opens (or closes) kernel memory for ring 3 in one address space,
+;   used for the task stacks. Their entries are not global, so a
+;   CR3 reload flushes them if the page directory is the current one.
+;------------------------------------------------------------------
+GLOBAL pd_user
+pd_user:
+	PUSH ebx
+	PUSH ecx
+	PUSH esi
+	PUSH edi
+
+	MOV esi, eax				; access for ring 3
+	TEST esi, esi				; kernel only?
+	JNZ .region				; no
+	MOV esi, PG_WRITE			; yes, writable for ring 0
+
+	;----------------------------------------------------------
+	; Loop over pages of region
+	;----------------------------------------------------------
+
+.region:
+	ADD ecx, ebx				; end of region
+	AND ebx, ~(PAGE_SIZE-1)			; first page of region
+.next:
+	CMP ebx, ecx				; end of region reached?
+	JAE .done				; yes
+	MOV eax, ebx				; linear address
+	SHR eax, 22				; page directory index
+	CMP eax, STACK_PDE_FIRST		; entry with own page tables?
+	JB .failed				; no
+	CMP eax, STACK_PDE_END
+	JAE .failed				; no
+	MOV edi, edx				; page directory
+	SUB edi, PRIVDS_BASE			; physical to privDS address
+	MOV edi, DWORD [edi+4*eax]		; load entry
+	TEST edi, PG_LARGE			; 4 MiB page of kernel page directory?
+	JNZ .failed				; yes, shared by all tasks
+	AND edi, ~(PAGE_SIZE-1)			; page table
+	SUB edi, PRIVDS_BASE			; physical to privDS address
+	MOV eax, ebx				; linear address
+	SHR eax, 12				; page number
+	AND eax, PTE_ENTRIES-1			; page table index
+	LEA edi, [edi+4*eax]			; page table entry
+	AND DWORD [edi], ~(PG_USER|PG_WRITE)	; clear access bits
+	OR DWORD [edi], esi			; and set new ones
+	ADD ebx, PAGE_SIZE			; next page
+	JMP .next
+.done:
+	XOR esi, esi				; set return code success
+	JMP .flush
+.failed:
+	MOV esi, -1				; set error code
+
+	;----------------------------------------------------------
+	; Flush TLB if the address space is the current one
+	;----------------------------------------------------------
+
+.flush:
+	MOV eax, cr3				; current page directory
+	MOV edi, eax
+	AND edi, ~(PAGE_SIZE-1)
+	CMP edi, edx				; changed one?
+	JNE .cleanup				; no, its entries are not cached
+	MOV cr3, eax				; yes, reload
+
+	;----------------------------------------------------------
+	; Cleanup
+	;----------------------------------------------------------
+
+.cleanup:
+	MOV eax, esi				; return code
+	POP edi
+	POP esi
+	POP ecx
+	POP ebx
+	RET
+
+;------------------------------------------------------------------
+; INPUT
+;   ebx      Linear start address of region
+;   ecx      Length of region in bytes
+; RETURN
+;   eax      0 on success, -1 if the region can't be protected
+; REMARKS
+;   Opens kernel memory read-only for ring 3 in the address space of
+;   the current task, used by the mmap2 and clock page system calls
+;   of libkernel (the ramdisk and the clock page lie in the stack
+;   entries). Without paging userDS reaches all memory writable, so
+;   the region is refused.
+;------------------------------------------------------------------
+GLOBAL pg_readonly
+pg_readonly:
+	MOV eax, -1				; set error code
+	CMP DWORD [kernel_pd], 0		; paging enabled?
+	JE .cleanup				; no
+	PUSH edx
+	MOV edx, cr3				; current page directory
+	AND edx, ~(PAGE_SIZE-1)
+	MOV eax, PG_USER			; read-only for ring 3
+	CALL pd_user				; ebx & ecx are passed thru
+	POP edx
+.cleanup:
+	RET
+
+;------------------------------------------------------------------
+; INPUT
+;   ebx      Linear start address of region
+;   ecx      Length of region in bytes
+; RETURN
+;   eax      0 on success
+; REMARKS
+;   The pages of the region are marked not present, so they are
+;   filled by the page fault handler on first touch. Has to be called
+;   before the first task is created, as new page directories are
+;   copied from the kernel page directory.
+;------------------------------------------------------------------
+GLOBAL paging_lazy
+paging_lazy:
+	PUSH ebx
+	PUSH edx
+
+	;----------------------------------------------------------
+	; Check paging
+	;----------------------------------------------------------
+
+	MOV eax, -1				; set error code
+	CMP DWORD [kernel_pd], 0		; paging enabled?
+	JE .cleanup				; no
+
+	;----------------------------------------------------------
+	; Loop over pages of region
+	;----------------------------------------------------------
+
+	LEA edx, [ebx+ecx]			; end of region
+	AND ebx, ~(PAGE_SIZE-1)			; first page of region
+.next:
+	CMP ebx, edx				; end of region reached?
+	JAE .done				; yes
+	CALL pte_addr				; get page table entry
+	TEST eax, eax				; check if it worked
+	JZ .failed				; no page table available
+	MOV DWORD [eax], 0			; not present -> filled on first touch
+	ADD ebx, PAGE_SIZE			; next page
+	JMP .next
+.done:
+	XOR eax, eax				; set return code success
+	JMP .cleanup
+.failed:
+	MOV eax, -1				; set error code
+
+	;----------------------------------------------------------
+	; Cleanup
+	;----------------------------------------------------------
+
+.cleanup:
+	POP edx
+	POP ebx
+	RET
+
+;------------------------------------------------------------------
+; INPUT
+;   ebx      Linear start address of region
+;   ecx      Length of region in bytes
+; RETURN
+;   eax      0 on success
+; REMARKS
+;   The pages of the region (data and BSS) get an own frame in every
+;   process, pd_new copies their page tables. Has to be called after
+;   paging_lazy for all regions and before the first task is created.
+;   Regions in the kernel part of the page directory are refused.
+;------------------------------------------------------------------
+GLOBAL paging_private
+paging_private:
+	PUSH ebx
+	PUSH edx
+
+	;----------------------------------------------------------
+	; Check paging
+	;----------------------------------------------------------
+
+	MOV eax, -1				; set error code
+	CMP DWORD [kernel_pd], 0		; paging enabled?
+	JE .cleanup				; no
+
+	;----------------------------------------------------------
+	; Loop over pages of region
+	;----------------------------------------------------------
+
+	LEA edx, [ebx+ecx]			; end of region
+	AND ebx, ~(PAGE_SIZE-1)			; first page of region
+.next:
+	CMP ebx, edx				; end of region reached?
+	JAE .done				; yes
+	MOV eax, ebx				; linear address
+	SHR eax, 22				; page directory index
+	CMP eax, KERNEL_PDE_NUM			; kernel memory?
+	JB .failed				; yes, shared by all tasks
+	CMP eax, USER_PDE_NUM			; reachable thru userDS?
+	JAE .failed				; no
+	MOV BYTE [pde_private+eax], 1		; copy page table per process
+	CALL pte_addr				; get page table entry
+	TEST eax, eax				; check if it worked
+	JZ .failed				; no page table available
+	MOV DWORD [eax], PG_PRIVATE		; not present, own frame on first touch
+	ADD ebx, PAGE_SIZE			; next page
+	JMP .next
+.done:
+	XOR eax, eax				; set return code success
+	JMP .cleanup
+.failed:
+	MOV eax, -1				; set error code
+
+	;----------------------------------------------------------
+	; Cleanup
+	;----------------------------------------------------------
+
+.cleanup:
+	POP edx
+	POP ebx
+	RET
+
+;------------------------------------------------------------------
+; INPUT
+;   ebx      Linear address of page to map
+; RETURN
+;   eax      0 if the page is mapped and has to be filled,
+;            1 if it is mapped to a frame filled before, -1 on failure
+; REMARKS
+;   Shared pages are mapped read-only to the frame at the same
+;   physical address in the kernel page directory and the current
+;   one, a frame is only filled by the first task touching it.
+;   Private pages get a frame from the pool in the current address
+;   space, or the identity mapped frame in the kernel address space.
+;   Entries which are not present are never cached by the TLB, so
+;   there is nothing to invalidate.
+;------------------------------------------------------------------
+GLOBAL pte_map
+pte_map:
+	PUSH ecx
+	PUSH edx
+	PUSH esi
+
+	;----------------------------------------------------------
+	; Load page table entries
+	;----------------------------------------------------------
+
+	CALL pte_addr				; get shared page table entry
+	TEST eax, eax				; check if it worked
+	JZ .failed				; no page table available
+	MOV esi, eax				; shared entry
+	CALL pte_own				; get private page table entry
+	MOV ecx, eax				; 0 -> page table is shared
+	MOV edx, ebx				; linear address
+	AND edx, ~(PAGE_SIZE-1)			; page frame (identity mapping)
+	TEST DWORD [esi], PG_PRIVATE		; own frame per process?
+	JNZ .private				; yes
+
+	;----------------------------------------------------------
+	; Shared page (text and read-only data)
+	;----------------------------------------------------------
+
+	MOV eax, 1				; frame already filled
+	TEST DWORD [esi], PG_PRESENT		; touched by another task?
+	JNZ .shared				; yes
+	OR edx, PG_USER|PG_PRESENT		; read-only
+	MOV DWORD [esi], edx			; store shared entry
+	XOR eax, eax				; frame has to be filled
+.shared:
+	JECXZ .cleanup				; page table is shared
+	MOV edx, DWORD [esi]			; load shared entry
+	MOV DWORD [ecx], edx			; and store in own page table
+	JMP .cleanup
+
+	;----------------------------------------------------------
+	; Private page (data and BSS)
+	;----------------------------------------------------------
+
+.private:
+	JECXZ .kernel_space			; no own page table
+	CALL pool_alloc				; claim frame
+	TEST eax, eax				; check if it worked
+	JZ .failed				; pool exhausted
+	LEA edx, [eax+PRIVDS_BASE+(PG_PRIVATE|PG_USER|PG_WRITE|PG_PRESENT)]	; physical address and flags
+	MOV DWORD [ecx], edx			; store private entry
+	XOR eax, eax				; frame has to be filled
+	JMP .cleanup
+.kernel_space:
+	OR edx, PG_PRIVATE|PG_USER|PG_WRITE|PG_PRESENT	; add flags
+	MOV DWORD [esi], edx			; store shared entry, reset by pd_new
+	XOR eax, eax				; frame has to be filled
+	JMP .cleanup
+
+.failed:
+	MOV eax, -1				; set error code
+
+	;----------------------------------------------------------
+	; Cleanup
+	;----------------------------------------------------------
+
+.cleanup:
+	POP esi
+	POP edx
+	POP ecx
+	RET
+
+;------------------------------------------------------------------
+; H E L P E R   F U N C T I O N S
+;------------------------------------------------------------------
+
+;------------------------------------------------------------------
+; INPUT
+;   none
+; RETURN
+;   eax      Pointer to claimed page of pool (0 if pool is exhausted)
+;------------------------------------------------------------------
+pool_alloc:
+	PUSH ecx
+
+	;----------------------------------------------------------
+	; Loop to find free page
+	;----------------------------------------------------------
+
+	MOV ecx, 1				; first entry is kernel page directory
+.next:
+	CMP DWORD [pd_refs+4*ecx], 0		; see if page is in use
+	JE .unused				; no, so use it
+	INC ecx					; increment counter
+	CMP ecx, PDPOOL_NUM			; end of pool?
+	JB .next				; no, next iteration
+	XOR eax, eax				; pool exhausted -> set error code 0
+	JMP .cleanup
+
+	;----------------------------------------------------------
+	; Claim page
+	;----------------------------------------------------------
+
+.unused:
+	MOV DWORD [pd_refs+4*ecx], 1		; set page as used
+	MOV eax, ecx				; index
+	SHL eax, 12				; index to offset in pool
+	ADD eax, PDPOOL_ADDR			; add base address
+
+.cleanup:
+	POP ecx
+	RET
+
+;------------------------------------------------------------------
+; INPUT
+;   ebx      Physical address of page of pool (flags are ignored)
+; RETURN
+;   none
+;------------------------------------------------------------------
+pool_free:
+	CALL pd_index				; get index in pool
+	TEST eax, eax				; kernel page directory?
+	JZ .cleanup				; yes, never freed
+	CMP eax, PDPOOL_NUM			; valid page?
+	JAE .cleanup				; no
+	MOV DWORD [pd_refs+4*eax], 0		; set page as free
+.cleanup:
+	RET
+
+;------------------------------------------------------------------
+; INPUT
+;   ebx      Physical address of page directory
+; RETURN
+;   none
+; REMARKS
+;   Frees the page tables the page directory does not share with
+;   the kernel page directory (the ones of the stack entries
+;   included) and the private frames they map
+;------------------------------------------------------------------
+pd_release:
+	PUSH eax
+	PUSH ebx
+	PUSH ecx
+	PUSH edx
+	PUSH esi
+	PUSH edi
+
+	MOV esi, ebx				; page directory
+	SUB esi, PRIVDS_BASE			; physical to privDS address
+	MOV edi, DWORD [kernel_pd]		; kernel page directory
+	SUB edi, PRIVDS_BASE			; physical to privDS address
+
+	;----------------------------------------------------------
+	; Loop over entries of page directory
+	;----------------------------------------------------------
+
+	XOR ecx, ecx				; first entry
+.next_pde:
+	MOV ebx, DWORD [esi+4*ecx]		; load entry
+	CMP ebx, DWORD [edi+4*ecx]		; shared page table?
+	JE .shared				; yes
+	PUSH ecx				; Save counter
+	AND ebx, ~(PAGE_SIZE-1)			; private page table
+	MOV edx, ebx
+	SUB edx, PRIVDS_BASE			; physical to privDS address
+
+	;----------------------------------------------------------
+	; Free private frames of page table
+	;----------------------------------------------------------
+
+	XOR ecx, ecx				; clear counter
+.next_pte:
+	MOV eax, DWORD [edx+4*ecx]		; load entry
+	AND eax, PG_PRIVATE|PG_PRESENT		; mapped private page?
+	CMP eax, PG_PRIVATE|PG_PRESENT
+	JNE .skip_pte				; no
+	PUSH ebx				; Save page table
+	MOV ebx, DWORD [edx+4*ecx]		; frame
+	CALL pool_free				; free frame
+	POP ebx					; Restore page table
+.skip_pte:
+	INC ecx					; increment counter
+	CMP ecx, PTE_ENTRIES			; all entries done?
+	JB .next_pte				; no, next one
+
+	CALL pool_free				; free page table
+	POP ecx					; Restore counter
+.shared:
+	INC ecx					; increment counter
+	CMP ecx, USER_PDE_NUM			; all user entries done?
+	JB .next_pde				; no, next one
+
+	;----------------------------------------------------------
+	; Cleanup
+	;----------------------------------------------------------
+
+	POP edi
+	POP esi
+	POP edx
+	POP ecx
+	POP ebx
+	POP eax
+	RET
+
+;------------------------------------------------------------------
+; INPUT
+;   ebx      Linear address
+; RETURN
+;   eax      Pointer to page table entry in kernel page directory
+;            (0 on failure)
+; REMARKS
+;   A 4 MiB page is split into a page table with the same mapping
+;------------------------------------------------------------------
+pte_addr:
+	PUSH ecx
+	PUSH esi
+	PUSH edi
+
+	;----------------------------------------------------------
+	; Load page directory entry
+	;----------------------------------------------------------
+
+	MOV eax, ebx				; linear address
+	SHR eax, 22				; page directory index
+	MOV esi, DWORD [kernel_pd]		; kernel page directory
+	SUB esi, PRIVDS_BASE			; physical to privDS address
+	LEA esi, [esi+4*eax]			; page directory entry
+	MOV eax, DWORD [esi]			; load entry
+	TEST eax, PG_PRESENT			; mapped at all?
+	JZ .failed				; no
+	TEST eax, PG_LARGE			; 4 MiB page?
+	JZ .table				; no, page table exists
+
+	;----------------------------------------------------------
+	; Split 4 MiB page into page table
+	;----------------------------------------------------------
+
+	CALL pool_alloc				; claim page table
+	TEST eax, eax				; check if it worked
+	JZ .failed				; pool exhausted
+	MOV edi, eax				; page table
+	MOV eax, DWORD [esi]			; load entry
+	AND eax, PG_LARGE_MASK			; first frame
+	OR eax, PG_USER|PG_WRITE|PG_PRESENT	; add flags
+	XOR ecx, ecx				; clear counter
+.fill:
+	MOV DWORD [edi+4*ecx], eax		; store entry
+	ADD eax, PAGE_SIZE			; next frame
+	INC ecx					; increment counter
+	CMP ecx, PTE_ENTRIES			; all entries done?
+	JB .fill				; no, next one
+	LEA eax, [edi+PRIVDS_BASE+(PG_USER|PG_WRITE|PG_PRESENT)]	; physical address and flags
+	MOV DWORD [esi], eax			; replace 4 MiB page
+	MOV eax, cr3				; flush TLB (entry is not global)
+	MOV cr3, eax
+
+	;----------------------------------------------------------
+	; Load page table entry
+	;----------------------------------------------------------
+
+.table:
+	MOV eax, DWORD [esi]			; load entry
+	AND eax, ~(PAGE_SIZE-1)			; page table
+	SUB eax, PRIVDS_BASE			; physical to privDS address
+	MOV ecx, ebx				; linear address
+	SHR ecx, 12				; page number
+	AND ecx, PTE_ENTRIES-1			; page table index
+	LEA eax, [eax+4*ecx]			; page table entry
+	JMP .cleanup
+.failed:
+	XOR eax, eax				; set error code
+
+	;----------------------------------------------------------
+	; Cleanup
+	;----------------------------------------------------------
+
+.cleanup:
+	POP edi
+	POP esi
+	POP ecx
+	RET
+
+;------------------------------------------------------------------
+; INPUT
+;   ebx      Linear address
+; RETURN
+;   eax      Pointer to page table entry in current page directory
+;            (0 if the page table is shared with the kernel page
+;            directory)
+;------------------------------------------------------------------
+pte_own:
+	PUSH ecx
+	PUSH edx
+
+	;----------------------------------------------------------
+	; Compare page directory entries
+	;----------------------------------------------------------
+
+	MOV eax, cr3				; current page directory
+	AND eax, ~(PAGE_SIZE-1)
+	CMP eax, DWORD [kernel_pd]		; kernel address space?
+	JE .shared				; yes
+	SUB eax, PRIVDS_BASE			; physical to privDS address
+	MOV ecx, ebx				; linear address
+	SHR ecx, 22				; page directory index
+	MOV edx, DWORD [kernel_pd]		; kernel page directory
+	SUB edx, PRIVDS_BASE			; physical to privDS address
+	MOV eax, DWORD [eax+4*ecx]		; load own entry
+	CMP eax, DWORD [edx+4*ecx]		; same as kernel entry?
+	JE .shared				; yes
+	TEST eax, PG_PRESENT			; mapped at all?
+	JZ .shared				; no
+	TEST eax, PG_LARGE			; 4 MiB page?
+	JNZ .shared				; yes, no page table
+
+	;----------------------------------------------------------
+	; Load page table entry
+	;----------------------------------------------------------
+
+	AND eax, ~(PAGE_SIZE-1)			; page table
+	SUB eax, PRIVDS_BASE			; physical to privDS address
+	MOV ecx, ebx				; linear address
+	SHR ecx, 12				; page number
+	AND ecx, PTE_ENTRIES-1			; page table index
+	LEA eax, [eax+4*ecx]			; page table entry
+	JMP .cleanup
+.shared:
+	XOR eax, eax				; page table is shared
+
+	;----------------------------------------------------------
+	; Cleanup
+	;----------------------------------------------------------
+
+.cleanup:
+	POP edx
+	POP ecx
+	RET
+
+;------------------------------------------------------------------
+; INPUT
+;   ebx      Physical address of page directory
+; RETURN
+;   eax      Index in pool (PDPOOL_NUM if not in pool)
+;------------------------------------------------------------------
+pd_index:
+	MOV eax, ebx				; page directory
+	SUB eax, PDPOOL_ADDR+PRIVDS_BASE	; offset in pool
+	JB .invalid				; below pool
+	SHR eax, 12				; offset to index
+	CMP eax, PDPOOL_NUM			; beyond pool?
+	JB .valid				; no
+.invalid:
+	MOV eax, PDPOOL_NUM			; not in pool
+.valid:
+	RET
@@ -49,6 +49,13 @@ theGDT:
 	.globl  userDS
 	.quad   0x00C1F2000000FFFF       # data segment-descriptor
 	#----------------------------------------------------------
+	# Code/Data, 32 bit, Byte, Priv 0, Type 0x02, 'Read/Write'
+	# Base Address: 0xFEE00000   Limit: 0x00000FFF
+	# Used to access the local APIC registers
+	.equ    sel_apic, (.-theGDT)+0   # selector for local APIC
+	.globl  sel_apic
+	.quad   0xFE4092E000000FFF       # data segment-descriptor
+	#----------------------------------------------------------
 	.equ    selTSS, (.-theGDT)+0     # selector for Task-State
 	.global selTSS
 	.word   limTSS, theTSS+0x0000, 0x8902, 0x0000  # task descriptor
@@ -13,22 +13,52 @@
 // Max number of PCBs to store (>=2)
 #define MAX_PCBS 128
 
+// Real-time class: longest period and share of the CPU all real-time
+// tasks together may claim (parts per million of budget/deadline)
+#define RT_PERIOD_MAX 1000000000UL
+#define RT_DENSITY_MAX 900000UL
+
+// Shortest time slice in ns (keeps timer interrupts apart)
+#define SLICE_MIN 10000UL
+
+// Real-time statistics (sched_rtstat)
+#define RT_STAT_MISSES 0
+#define RT_STAT_OVERRUNS 1
+#define RT_STAT_JOBS 2
+
 /******************************************************************
 ** Scheduler C structures
 ******************************************************************/
 
+// Real-time parameters and state of a task (period 0 = normal task)
+// A job is released every period and has to be done before its
+// deadline, the task yields when it is done with a job
+typedef struct {
+	unsigned long period;		// ns
+	unsigned long budget;		// ns of CPU time per job
+	unsigned long deadline;		// ns after release (<= period)
+	unsigned long long release;	// start of current job (clock_ns)
+	unsigned long used;		// ns used by current job
+	unsigned long done;		// current job done or throttled
+	unsigned long missed;		// current job missed its deadline
+	unsigned long misses;		// jobs not done before their deadline
+	unsigned long overruns;		// jobs throttled at their budget
+	unsigned long jobs;		// jobs released
+} RT_t;
+
 // List structure
 typedef struct _PCBlist_t {
 	void* PCB;
 	struct _PCBlist_t* next;
 	struct _PCBlist_t* last;
+	RT_t rt;
 } PCBlist_t;
 
 // PCB structure (full implementation in context_pcb.inc)
 typedef struct {
 	unsigned long PID;
 	unsigned long status;
-	unsigned long ticks;
+	unsigned long ticks; // ns of last execution
 	unsigned long wait;
 	// and more but that's irrelevant here
 } PCB_t;
@@ -46,6 +76,94 @@ PCBlist_t* active = PCBlist;
 // next never used spot in PCB list
 PCBlist_t* next = 0;
 
+// Last normal task -> round-robin continues behind it
+PCBlist_t* rr = PCBlist;
+
+// Current task was preempted by the timer (did not yield)
+unsigned long preempted = 0;
+
+/******************************************************************
+** External functions
+******************************************************************/
+
+// Nanoseconds since the TSC calibration, 0 if it is not calibrated
+// (libkernel clock.s, result in edx:eax)
+extern unsigned long long clock_ns(void);
+
+/******************************************************************
+** Real-time helpers
+******************************************************************/
+
+// Reset real-time state -> normal task
+static void rt_clear(PCBlist_t* ptr)
+{
+	char* p = (char*)&(*ptr).rt;
+	for(unsigned int i=0; i<sizeof(RT_t); ++i)
+		p[i] = 0;
+}
+
+// part * 1000000 / whole, bitwise so no 64 bit division is needed
+static unsigned long rt_ppm(unsigned long part, unsigned long whole)
+{
+	unsigned long long n = (unsigned long long)part * 1000000;
+	unsigned long long d = (unsigned long long)whole << 31;
+	unsigned long q = 0;
+	for(int i=31; i>=0; --i) {
+		q <<= 1;
+		if(n >= d) {
+			n -= d;
+			q |= 1;
+		}
+		d >>= 1;
+	}
+	return q;
+}
+
+// n / d, bitwise so no 64 bit division is needed
+static unsigned long long rt_div(unsigned long long n, unsigned long d)
+{
+	unsigned long long q = 0;
+	unsigned long long r = 0;
+	for(int i=63; i>=0; --i) {
+		r = (r << 1) | ((n >> i) & 1);
+		q <<= 1;
+		if(r >= d) {
+			r -= d;
+			q |= 1;
+		}
+	}
+	return q;
+}
+
+// Release new jobs and count deadline misses up to now
+static void rt_update(PCBlist_t* ptr, unsigned long long now)
+{
+	RT_t* rt = &(*ptr).rt;
+
+	// Deadline of current job passed before it was done
+	if(!(*rt).done && !(*rt).missed && now >= (*rt).release + (*rt).deadline) {
+		(*rt).missed = 1;
+		++(*rt).misses;
+	}
+
+	// Next job(s) released, all but the last one were skipped
+	if(now >= (*rt).release + (*rt).period) {
+		unsigned long long n = rt_div(now - (*rt).release, (*rt).period);
+		(*rt).release += n * (*rt).period;
+		(*rt).used = 0;
+		(*rt).done = 0;
+		(*rt).missed = 0;
+		(*rt).jobs += n;
+		(*rt).misses += n - 1;
+
+		// Deadline of new job passed already
+		if(now >= (*rt).release + (*rt).deadline) {
+			(*rt).missed = 1;
+			++(*rt).misses;
+		}
+	}
+}
+
 /******************************************************************
 ** Scheduler C functions
 ******************************************************************/
@@ -83,6 +201,7 @@ unsigned long sched_new(void* PCB)
 	if(next == 0) {
 		// Initial setup -> first PCB in queue
 		PCBlist[1].PCB = PCB;
+		rt_clear(&PCBlist[1]);
 		PCBlist[0].next = &PCBlist[1];
 		PCBlist[0].last = &PCBlist[1];
 		PCBlist[1].next = &PCBlist[0];
@@ -100,6 +219,7 @@ unsigned long sched_new(void* PCB)
 			if((*ptr).PCB == 0) {
 				// Found free space
 				(*ptr).PCB = PCB;
+				rt_clear(ptr);
 
 				// Close list loop again
 				(*ptr).next = (*active).next;
@@ -123,6 +243,7 @@ unsigned long sched_new(void* PCB)
 
 		// New space at the end
 		(*next).PCB = PCB;
+		rt_clear(next);
 
 		// Close list loop again
 		(*next).next = (*active).next;
@@ -175,6 +296,10 @@ void* sched_remove(unsigned long PID)
 			if(active == ptr)
 				return 0;
 
+			// Round-robin continues behind the previous one
+			if(rr == ptr)
+				rr = (*ptr).last;
+
 			// Delete it
 			(*((*ptr).last)).next = (*ptr).next;
 			(*((*ptr).next)).last = (*ptr).last;
@@ -232,28 +357,166 @@ void* sched_getPCB(void)
 }
 
 // Select ANOTHER PCB
-// IN: Execution time of old task in ticks
+// IN: Execution time of old task in ns
 // RET: Pointer to new PCB
 void* sched_next(unsigned long exec_time)
 {
 	// Store tick count
 	(*((PCB_t*)((*active).PCB))).ticks = exec_time;
 
-	// Select next PCB
-	active = (*active).next;
+	// Charge real-time task, yielding ends its job
+	if((*active).rt.period) {
+		RT_t* rt = &(*active).rt;
+		(*rt).used += exec_time;
+		if(!preempted) {
+			(*rt).done = 1;
+		}
+		else if((*rt).used >= (*rt).budget && !(*rt).done) {
+			// Budget exhausted -> throttled until next release
+			(*rt).done = 1;
+			++(*rt).overruns;
+		}
+	}
+	preempted = 0;
 
-	// Check if it is blocked
-	while((*((PCB_t*)((*active).PCB))).status == 0xFFFFFFFF) {
+	// Earliest deadline first among ready real-time tasks
+	unsigned long long now = clock_ns();
+	PCBlist_t* edf = 0;
+	PCBlist_t* ptr = &PCBlist[0];
+	do {
+		if((*ptr).rt.period) {
+			rt_update(ptr, now);
+			if(!(*ptr).rt.done && (*((PCB_t*)((*ptr).PCB))).status != 0xFFFFFFFF) {
+				if(edf == 0 || (*ptr).rt.release + (*ptr).rt.deadline < (*edf).rt.release + (*edf).rt.deadline)
+					edf = ptr;
+			}
+		}
+
+		// Next entry
+		ptr = (*ptr).next;
+	} while(ptr != &PCBlist[0]);
+	if(edf) {
+		active = edf;
+		return (*active).PCB;
+	}
+
+	// Select next normal PCB
+	active = (*rr).next;
+
+	// Check if it is blocked or real-time
+	while((*((PCB_t*)((*active).PCB))).status == 0xFFFFFFFF || (*active).rt.period) {
 		// Possible deadlock if all tasks are blocked -> idle task schould never be blocked
 		active = (*active).next;
 	}
+	rr = active;
 
 	// Return next PCB
 	return (*active).PCB;
 }
 
+// Current task is preempted by the timer interrupt
+// IN: ---
+// RET: ---
+void sched_preempt(void)
+{
+	preempted = 1;
+}
+
+// Length of the time slice of the current task: real-time tasks run
+// until their budget is used, every task until the next release
+// IN: Default time slice in ns
+// RET: Time slice in ns
+unsigned long sched_slice(unsigned long slice)
+{
+	unsigned long long now = clock_ns();
+
+	// Rest of the budget
+	if((*active).rt.period) {
+		unsigned long used = (*active).rt.used;
+		unsigned long rest = used < (*active).rt.budget ? (*active).rt.budget - used : 0;
+		if(rest < slice)
+			slice = rest;
+	}
+
+	// Next release of any real-time task
+	PCBlist_t* ptr = &PCBlist[0];
+	do {
+		if((*ptr).rt.period) {
+			unsigned long long release = (*ptr).rt.release + (*ptr).rt.period;
+			if(release <= now)
+				slice = 0;
+			else if(release - now < slice)
+				slice = (unsigned long)(release - now);
+		}
+
+		// Next entry
+		ptr = (*ptr).next;
+	} while(ptr != &PCBlist[0]);
+
+	return slice < SLICE_MIN ? SLICE_MIN : slice;
+}
+
+// Make current task real-time (or normal again with period 0)
+// IN: Period, budget and deadline in ns (deadline 0 = period)
+// RET: 0 (0xFFFFFFFF on failure, e.g. if admission fails)
+unsigned long sched_setrt(unsigned long period, unsigned long budget, unsigned long deadline)
+{
+	// Back to normal task
+	if(period == 0) {
+		rt_clear(active);
+		return 0;
+	}
+
+	// Check parameters (idle task stays normal)
+	if(deadline == 0)
+		deadline = period;
+	if(active == &PCBlist[0] || budget == 0 || budget > deadline || deadline > period || period < SLICE_MIN || period > RT_PERIOD_MAX)
+		return 0xFFFFFFFF;
+
+	// Release times need the TSC
+	unsigned long long now = clock_ns();
+	if(now == 0)
+		return 0xFFFFFFFF;
+
+	// Admission control: density of all real-time tasks
+	unsigned long density = rt_ppm(budget, deadline);
+	PCBlist_t* ptr = &PCBlist[0];
+	do {
+		if(ptr != active && (*ptr).rt.period)
+			density += rt_ppm((*ptr).rt.budget, (*ptr).rt.deadline);
+
+		// Next entry
+		ptr = (*ptr).next;
+	} while(ptr != &PCBlist[0]);
+	if(density > RT_DENSITY_MAX)
+		return 0xFFFFFFFF;
+
+	// First job is released now
+	rt_clear(active);
+	(*active).rt.period = period;
+	(*active).rt.budget = budget;
+	(*active).rt.deadline = deadline;
+	(*active).rt.release = now;
+	(*active).rt.jobs = 1;
+	return 0;
+}
+
+// Real-time statistics of current task
+// IN: RT_STAT_MISSES, RT_STAT_OVERRUNS or RT_STAT_JOBS
+// RET: Counter (0xFFFFFFFF if not a real-time task)
+unsigned long sched_rtstat(unsigned long id)
+{
+	if(!(*active).rt.period)
+		return 0xFFFFFFFF;
+	if(id == RT_STAT_MISSES)
+		return (*active).rt.misses;
+	if(id == RT_STAT_OVERRUNS)
+		return (*active).rt.overruns;
+	return (*active).rt.jobs;
+}
+
 // Select ANOTHER PCB and block current one
-// IN: PID to wait for && Execution time of old task in ticks
+// IN: PID to wait for && Execution time of old task in ns
 // RET: Pointer to new PCB (0 on error)
 void* sched_block(unsigned long exec_time, unsigned long PID)
 {
@@ -55,6 +55,9 @@
 ; Timer constants
 MICROSECONDS EQU 5000
 PRESCALER EQU (1193182*MICROSECONDS/1000000)
+SLICE_NS EQU MICROSECONDS*1000
+NS_PER_SEC EQU 1000000000
+PIT_HZ EQU 1193182
 
 ;==================================================================
 ; S E C T I O N   D A T A
@@ -82,6 +85,12 @@ BITS 32
 ; Scheduler functions
 %INCLUDE 'src/scheduler.inc'
 
+; Address spaces
+%INCLUDE 'src/paging.inc'
+
+; Local APIC timer
+%INCLUDE 'src/lapic.inc'
+
 ;------------------------------------------------------------------
 ; M A C R O S
 ;------------------------------------------------------------------
@@ -98,6 +107,74 @@ BITS 32
 	POP eax
 %ENDMACRO
 
+;------------------------------------------------------------------
+; T I M E   S L I C E S
+;------------------------------------------------------------------
+
+;------------------------------------------------------------------
+; INPUT
+;   none
+; RETURN
+;   none
+; REMARKS
+;   Starts the time slice of the next task (after sched_next) with
+;   the local APIC timer, or with the PIT if there is no local APIC.
+;   The local APIC timer ends it at the next release or when the
+;   budget of a real-time task is used up
+;------------------------------------------------------------------
+slice_start:
+	CMP DWORD [lapic_mode], LAPIC_NONE
+	JE .pit
+	PUSH eax
+	PUSH ecx
+	PUSH edx
+	PUSH DWORD SLICE_NS		; default time slice
+	CALL sched_slice		; C function overwrites registers
+	ADD esp, 4			; Remove argument from stack
+	CALL lapic_arm			; no port I/O
+	POP edx
+	POP ecx
+	POP eax
+	RET
+.pit:
+	RESET_PIT
+	RET
+
+;------------------------------------------------------------------
+; INPUT
+;   none
+; RETURN
+;   eax			Execution time of the current time slice in ns
+;------------------------------------------------------------------
+slice_elapsed:
+	CMP DWORD [lapic_mode], LAPIC_NONE
+	JNE lapic_elapsed		; taken from the TSC
+	PUSH ecx
+	PUSH edx
+	PUSHFD				; Save flags
+	CLI				; disable interrupts just in case
+	XOR eax, eax			; Set eax to null
+	MOV ecx, PRESCALER
+	MOV al, 0x00			; Channel 0 read count in latch
+	OUT 0x43, al			; Write select command
+	IN al, 0x40			; read low byte
+	SHL ax, 8			; shift to high
+	IN al, 0x40			; read high byte
+	ROL ax, 8			; rollover high to low byte
+	CMP eax, ecx			; compare current value to max value 
+	JBE .no_overflow		; check for underflow
+	XOR eax, eax			; set eax to zero in case of underflow
+.no_overflow:
+	SUB ecx, eax			; subtract remaining time (eax) from max value
+	POPFD				; restore flags
+	MOV eax, NS_PER_SEC
+	MUL ecx				; pulses to ns
+	MOV ecx, PIT_HZ
+	DIV ecx
+	POP edx
+	POP ecx
+	RET
+
 ;------------------------------------------------------------------
 ; M A I N   F U N C T I O N S
 ;------------------------------------------------------------------
@@ -110,11 +187,21 @@ BITS 32
 ;------------------------------------------------------------------
 GLOBAL scheduler_newTask
 scheduler_newTask:
+	XOR edx, edx			; new task gets its own address space
+
+;------------------------------------------------------------------
+; INPUT
+;   ebx			Function address for new task
+;   edx			Page directory to share (0 for new address space)
+; RETURN
+;   eax on STACK	PID (0xFFFFFFFF on failure)
+;------------------------------------------------------------------
+scheduler_newContext:
 	;----------------------------------------------------------
 	; Create new context
 	;----------------------------------------------------------
 
-	CALL context_new		; ebx is passed thru
+	CALL context_new		; ebx & edx are passed thru
 	TEST eax, eax
 	JNZ .success			; context created
 	SYSLOG 17
@@ -166,10 +253,12 @@ scheduler_newTask:
 GLOBAL scheduler_newpThread
 scheduler_newpThread:
 	;----------------------------------------------------------
-	; Passthru newTask
+	; Passthru newTask in address space of current task
 	;----------------------------------------------------------
 
-	CALL scheduler_newTask				; ebx is passed thru (ecx and edx are lost)
+	CALL sched_getPCB				; C function overwrites registers (ebx is kept)
+	MOV edx, DWORD [eax+PCB.cr3]			; share page directory of current task
+	CALL scheduler_newContext			; ebx & edx are passed thru (ecx and edx are lost)
 	CMP DWORD [ebp+44], 0xFFFFFFFF			; eax return code already on interrupt stack
 	JE .cleanup					; newTask failed
 
@@ -177,6 +266,7 @@ scheduler_newpThread:
 	; Modify PCB for pThread return
 	;----------------------------------------------------------
 
+	PUSH DWORD [eax+PCB.cr3]			; save shared page directory
 	MOV ebx, DWORD [eax+PCB.reg_esp]		; move program stack to ebx
 	SUB ebx, 12					; reserve 3 dwords
 	MOV DWORD [eax+PCB.reg_esp], ebx		; save new stack-top
@@ -190,6 +280,15 @@ scheduler_newpThread:
 	MOV DWORD [ds:ebx+8], edx			; pthread_exit() address
 	POP ds
 
+	; The return program runs in ring 3, open its code read-only
+	POP edx						; shared page directory
+	TEST edx, edx					; paging enabled?
+	JZ .cleanup					; no
+	MOV ebx, pThread_exit+0x10000			; linear address of code
+	MOV ecx, pThread_exit_end-pThread_exit		; code size
+	MOV eax, PD_USER_RO				; read-only for ring 3
+	CALL pd_user					; can't fail, the kernel image lies in the stack tables
+
 	;----------------------------------------------------------
 	; pThread prepared
 	;----------------------------------------------------------
@@ -210,6 +309,7 @@ pThread_exit:
 	; Kill task in case of failure
 	MOV eax, SYS_EXIT
 	INT 0x80
+pThread_exit_end:
 
 ;------------------------------------------------------------------
 ; INPUT
@@ -306,7 +406,7 @@ scheduler_exit:
 	; Prepare for next task
 	;----------------------------------------------------------
 
-	RESET_PIT			; Reconfigure PIT -> resets counter so the next task isn't handicapped
+	CALL slice_start		; New time slice so the next task isn't handicapped
 	POP eax				; Restore new PCB value
 	SYSLOG 4
 	JMP context_set			; Set next task -> eax is passed thru
@@ -334,28 +434,8 @@ scheduler_yield:
 	; Calculate execution time
 	;----------------------------------------------------------
 
-	PUSHFD			; Save flags
-	CLI			; disable interrupts just in case
-	XOR eax, eax		; Set eax to null
-	MOV ebx, PRESCALER
-	MOV al, 0x00		; Channel 0 read count in latch
-	OUT 0x43, al		; Write select command
-	IN al, 0x40		; read low byte
-	SHL ax, 8		; shift to high
-	IN al, 0x40		; read high byte
-	ROL ax, 8		; rollover high to low byte
-	CMP eax, ebx		; compare current value to max value 
-	JBE .no_overflow	; check for underflow
-	XOR eax, eax		; set eax to zero in case of underflow
-.no_overflow:
-	SUB ebx, eax		; subtract remaining time (eax) from max value
-	POPFD			; restore flags
-
-	;----------------------------------------------------------
-	; Reconfigure PIT
-	;----------------------------------------------------------
-
-	RESET_PIT		; resets counter on timer interrupt and on active yield so the next task handicapped
+	CALL slice_elapsed	; execution time in ns
+	MOV ebx, eax
 
 	;----------------------------------------------------------
 	; Search current and next PCB & update active
@@ -370,6 +450,12 @@ scheduler_yield:
 	ADD esp, 4		; Remove argument from stack
 	POP ebx			; Restore current PCB ptr
 
+	;----------------------------------------------------------
+	; Start new time slice
+	;----------------------------------------------------------
+
+	CALL slice_start	; on timer interrupt and on active yield so the next task isn't handicapped
+
 	;----------------------------------------------------------
 	; Switch context
 	;----------------------------------------------------------
@@ -392,28 +478,8 @@ scheduler_waitpid:
 	;----------------------------------------------------------
 
 	PUSH ebx			; Save PID
-	PUSHFD				; Save flags
-	CLI				; disable interrupts just in case
-	XOR eax, eax			; Set eax to null
-	MOV edx, PRESCALER
-	MOV al, 0x00			; Channel 0 read count in latch
-	OUT 0x43, al			; Write select command
-	IN al, 0x40			; read low byte
-	SHL ax, 8			; shift to high
-	IN al, 0x40			; read high byte
-	ROL ax, 8			; rollover high to low byte
-	CMP eax, edx			; compare current value to max value 
-	JBE .no_overflow		; check for underflow
-	XOR eax, eax			; set eax to zero in case of underflow
-.no_overflow:
-	SUB edx, eax			; subtract remaining time (eax) from max value
-	POPFD				; restore flags
-
-	;----------------------------------------------------------
-	; Reconfigure PIT
-	;----------------------------------------------------------
-
-	RESET_PIT			; resets counter on timer interrupt and on active yield so the next task handicapped
+	CALL slice_elapsed		; execution time in ns
+	MOV edx, eax
 
 	;----------------------------------------------------------
 	; Search current and next PCB & update active
@@ -439,12 +505,63 @@ scheduler_waitpid:
 	ADD esp, 8			; Restore stack
 	POP ebx				; Restore current PCB ptr
 
+	;----------------------------------------------------------
+	; Start new time slice
+	;----------------------------------------------------------
+
+	CALL slice_start		; on timer interrupt and on active yield so the next task isn't handicapped
+
 	;----------------------------------------------------------
 	; Switch context
 	;----------------------------------------------------------
 
 	JMP context_switch		; Jump to context switch eax & ebx are passed thru
 
+;------------------------------------------------------------------
+; (ONLY FROM USER MODE thru INT)
+; INPUT
+;   ebx			Period in ns (0 -> normal task again)
+;   ecx			Budget in ns per period
+;   edx			Relative deadline in ns (0 -> period)
+; RETURN
+;   eax on STACK	0 (0xFFFFFFFF on failure or if admission fails)
+; REMARKS
+;   The task is scheduled earliest deadline first ahead of normal
+;   tasks and ends each job with sched_yield
+;------------------------------------------------------------------
+GLOBAL scheduler_setRT
+scheduler_setRT:
+	PUSH edx			; Move parameter deadline to stack
+	PUSH ecx			; Move parameter budget to stack
+	PUSH ebx			; Move parameter period to stack
+	CALL sched_setrt		; C function overwrites registers
+	ADD esp, 12			; Remove arguments from stack
+	MOV DWORD [ebp+44], eax		; save eax return code in interrupt stack
+	RET				; return to interrupt handler
+
+;------------------------------------------------------------------
+; (ONLY FROM USER MODE thru INT)
+; INPUT
+;   none
+; RETURN
+;   eax on STACK	Deadline misses (0xFFFFFFFF if not real-time)
+;   ebx on STACK	Jobs throttled at their budget (overruns)
+;   ecx on STACK	Jobs released
+;------------------------------------------------------------------
+GLOBAL scheduler_rtStat
+scheduler_rtStat:
+	PUSH DWORD 0			; misses
+	CALL sched_rtstat		; C function overwrites registers
+	MOV DWORD [ebp+44], eax		; save eax in interrupt stack
+	MOV DWORD [esp], 1		; overruns
+	CALL sched_rtstat
+	MOV DWORD [ebp+32], eax		; save ebx in interrupt stack
+	MOV DWORD [esp], 2		; jobs
+	CALL sched_rtstat
+	MOV DWORD [ebp+40], eax		; save ecx in interrupt stack
+	ADD esp, 4			; Remove argument from stack
+	RET				; return to interrupt handler
+
 ;------------------------------------------------------------------
 ; INPUT
 ;   none
@@ -458,11 +575,27 @@ scheduler_start:
 	;----------------------------------------------------------
 
 	MOV ebx, idle_task+0x10000	; add linear offset (privCS-userCS)
-	CALL context_new		; create new context -> ebx is passed thru
+	XOR edx, edx			; own address space for its stack
+	CALL context_new		; create new context
 	TEST eax, eax			; check if it worked
-	JNZ .success			; if it did
+	JZ .idle_error			; no
+
+	; The idle task runs in ring 3, open its code read-only
+	MOV edx, DWORD [eax+PCB.cr3]	; address space of idle task
+	TEST edx, edx			; paging enabled?
+	JZ .success			; no
+	PUSH eax			; Save PCB ptr
+	MOV ebx, idle_task+0x10000	; linear address of code
+	MOV ecx, idle_task_end-idle_task	; code size
+	MOV eax, PD_USER_RO		; read-only for ring 3
+	CALL pd_user
+	MOV ecx, eax			; keep return code
+	POP eax				; Restore PCB ptr
+	TEST ecx, ecx			; check if it worked
+	JZ .success			; if it did
 
 	; Error creating idle PCB -> critical error
+.idle_error:
 	SYSLOG 17, "IDLE"
 	CLI				; Clear interrupt flag
 	HLT				; Halt system until interrupt -> should never occur
@@ -486,12 +619,6 @@ scheduler_start:
 	JMP $				; loop endlessly
 .idle_setup:
 
-	;----------------------------------------------------------
-	; Configure PIT for the first time
-	;----------------------------------------------------------
-
-	RESET_PIT
-
 	;----------------------------------------------------------
 	; Set first active
 	;----------------------------------------------------------
@@ -499,6 +626,12 @@ scheduler_start:
 	PUSH DWORD 0			; dummy value for current execution time -> task will be killed anyways
 	CALL sched_next			; C function overwrites registers, selct next PCB
 	ADD esp, 4			; Remove parameter from stack
+
+	;----------------------------------------------------------
+	; Start the first time slice
+	;----------------------------------------------------------
+
+	CALL slice_start		; eax is passed thru
 	SYSLOG 8
 	JMP context_set			; Set next task -> eax is passed thru
 
@@ -512,4 +645,5 @@ idle_task:
 	MOV eax, SYS_YIELD
 	INT 0x80
 	JMP idle_task
+idle_task_end:
 
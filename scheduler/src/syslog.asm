@@ -26,7 +26,7 @@
 ;==================================================================
 
 STARTPOS EQU 0x800000 ; at 8 MiB (+ 128 KiB data segment offset) -> 0x820000
-ENDPOS EQU 0xFFFFFF ; till 16 MiB
+ENDPOS EQU 0xEFFFFF ; till 15 MiB (page directories above)
 NEWLINE EQU 10
 
 ;==================================================================
@@ -60,6 +60,7 @@ string_16 db "** Scheduler Interrupt"
 string_17 db "-- Failed to create context"
 string_18 db "-- Failed to allocate space for PCBlist"
 string_19 db "## Failed to allocate space for"
+string_20 db "-- Page fault outside of ELF image"
 string_last EQU $
 
 ;------------------------------------------------------------------
@@ -67,10 +68,10 @@ string_last EQU $
 ;------------------------------------------------------------------
 
 ; Shortcut string access
-stringtable dd string_00, string_01, string_02, string_03, string_04, string_05, string_06, string_07, string_08, string_09, string_10, string_11, string_12, string_13, string_14, string_15, string_16, string_17, string_18, string_19
+stringtable dd string_00, string_01, string_02, string_03, string_04, string_05, string_06, string_07, string_08, string_09, string_10, string_11, string_12, string_13, string_14, string_15, string_16, string_17, string_18, string_19, string_20
 
 ; String lengths
-stringlength dd string_01-string_00, string_02-string_01, string_03-string_02, string_04-string_03, string_05-string_04, string_06-string_05, string_07-string_06, string_08-string_07, string_09-string_08, string_10-string_09, string_11-string_10, string_12-string_11, string_13-string_12, string_14-string_13, string_15-string_14, string_16-string_15, string_17-string_16, string_18-string_17, string_19-string_18, string_last-string_19
+stringlength dd string_01-string_00, string_02-string_01, string_03-string_02, string_04-string_03, string_05-string_04, string_06-string_05, string_07-string_06, string_08-string_07, string_09-string_08, string_10-string_09, string_11-string_10, string_12-string_11, string_13-string_12, string_14-string_13, string_15-string_14, string_16-string_15, string_17-string_16, string_18-string_17, string_19-string_18, string_20-string_19, string_last-string_20
 
 ;------------------------------------------------------------------
 ; D A T A   S T O R E
@@ -0,0 +1,87 @@
+#!/bin/bash
+#
+# boottime.sh - boot a floppy image headless in QEMU several times and
+# report min/median/max TSC ticks per boot phase
+#
+# usage: boottime.sh <image.flp> [runs] [timeout in seconds]
+#
+# The start code of the program prints the boot-timing table as a
+# line "BOOTTIME stage0=<hex> stage1=<hex> ..." on the serial port
+# (see libkernel/src/boottime.s), each phase lasts until the next
+# reached one starts. Phases that were not reached are printed as
+# "-" and left out of the statistics.
+#
+
+IMAGE=$1
+RUNS=${2:-10}
+TIMEOUT=${3:-20}
+QEMU=${QEMU:-qemu-system-x86_64}
+
+if [ -z "$IMAGE" ] || [ ! -f "$IMAGE" ]; then
+    echo "usage: $0 <image.flp> [runs] [timeout]" >&2
+    exit 1
+fi
+
+LOG=$(mktemp)
+trap 'rm -f $LOG $LOG.run' EXIT
+
+for run in $(seq 1 $RUNS); do
+    rm -f $LOG.run
+    $QEMU -drive file=$IMAGE,index=0,if=floppy,format=raw,snapshot=on \
+          -m 1024M -display none -no-reboot \
+          -serial file:$LOG.run -monitor none &
+    pid=$!
+    for i in $(seq 1 $((TIMEOUT * 10))); do
+        grep -q '^BOOTTIME.*main=' $LOG.run 2>/dev/null && break
+        sleep 0.1
+    done
+    kill $pid 2>/dev/null
+    wait $pid 2>/dev/null
+    if ! grep -a '^BOOTTIME' $LOG.run | tr -d '\r' >> $LOG; then
+        echo "run $run: no BOOTTIME line within ${TIMEOUT}s" >&2
+    fi
+done
+
+# durations of the phases in ticks, in boot order
+awk '
+function hex(s,    i, v) {
+    v = 0
+    for (i = 1; i <= length(s); i++)
+        v = v * 16 + index("0123456789ABCDEF", toupper(substr(s, i, 1))) - 1
+    return v
+}
+{
+    n = 0
+    for (i = 2; i <= NF; i++) {
+        split($i, kv, "=")
+        if (i < NF && !(kv[1] in seen)) {
+            seen[kv[1]] = 1
+            order[phases++] = kv[1]
+        }
+        if (kv[2] == "-") continue      # phase not reached
+        name[n] = kv[1]
+        t[n] = hex(kv[2])
+        n++
+    }
+    if (n == 0) next
+    for (i = 0; i < n; i++) {
+        p = (i < n - 1) ? name[i] : "total"
+        d = (i < n - 1) ? t[i+1] - t[i] : t[n-1] - t[0]
+        val[p, cnt[p]++] = d
+    }
+}
+END {
+    printf "%-10s %5s %16s %16s %16s\n", "phase", "runs", "min", "median", "max"
+    order[phases++] = "total"
+    for (j = 0; j < phases; j++) {
+        p = order[j]
+        m = cnt[p]
+        if (m == 0) continue
+        for (i = 0; i < m; i++) {
+            x = val[p, i]
+            for (k = i; k > 0 && v[k-1] > x; k--) v[k] = v[k-1]
+            v[k] = x
+        }
+        printf "%-10s %5d %16.0f %16.0f %16.0f\n", p, m, v[0], v[int((m-1)/2)], v[m-1]
+    }
+}' $LOG
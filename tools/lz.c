@@ -0,0 +1,255 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Systemnahe Programmierung (SNP)
+ *
+ * lz.c - LZ compression of boot images
+ *
+ * Byte oriented LZ77 codec in the style of the LZ4 block format, the
+ * same format as pgftdemo/src/lz.c. The output is a list of sequences,
+ * each made of
+ *   token      - literal count (high nibble), match length - 4 (low nibble),
+ *                a nibble of 15 is continued by bytes up to a byte != 255
+ *   literals   - bytes copied unchanged
+ *   offset     - 16 bit little endian distance of the match
+ * The last sequence only holds literals. The boot loader decodes it
+ * with lz_decode in dasboot/lzdec.s.
+ *
+ *===================================================================*/
+
+#include <string.h>
+#include "lz.h"
+
+
+/* last position + 1 of each hashed 4-byte sequence, 0 if none */
+static uint32_t lz_table[1 << LZ_HASH_BITS];
+
+
+static uint32_t
+lz_read32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+} /* end of lz_read32 */
+
+
+static uint32_t
+lz_hash(uint32_t v)
+{
+    return (v * 2654435761U) >> (32 - LZ_HASH_BITS);
+} /* end of lz_hash */
+
+
+/* append the extra length bytes of a nibble of 15, returns 0 if dst
+ * is full
+ */
+static int
+lz_put_length(uint8_t *dst, uint32_t *op, uint32_t max, uint32_t len)
+{
+    for(len -= 15; len >= 255; len -= 255) {
+        if(*op >= max) {
+            return 0;
+        } /* end if */
+        dst[(*op)++] = 255;
+    } /* end for */
+    if(*op >= max) {
+        return 0;
+    } /* end if */
+    dst[(*op)++] = len;
+    return 1;
+} /* end of lz_put_length */
+
+
+/* append a sequence of lit_len literals followed by a match of
+ * match_len bytes at distance offset, match_len 0 ends the output,
+ * returns 0 if dst is full
+ */
+static int
+lz_put_sequence(uint8_t *dst, uint32_t *op, uint32_t max, const uint8_t *lit,
+                uint32_t lit_len, uint32_t offset, uint32_t match_len)
+{
+    uint32_t ml = match_len ? match_len - LZ_MIN_MATCH : 0;
+
+    if(*op >= max) {
+        return 0;
+    } /* end if */
+    dst[(*op)++] = ((lit_len < 15 ? lit_len : 15) << 4) | (ml < 15 ? ml : 15);
+    if(lit_len >= 15 && !lz_put_length(dst, op, max, lit_len)) {
+        return 0;
+    } /* end if */
+
+    if(*op + lit_len > max) {
+        return 0;
+    } /* end if */
+    memcpy(dst + *op, lit, lit_len);
+    *op += lit_len;
+
+    if(match_len == 0) {
+        return 1;
+    } /* end if */
+
+    if(*op + 2 > max) {
+        return 0;
+    } /* end if */
+    dst[(*op)++] = offset;
+    dst[(*op)++] = offset >> 8;
+    if(ml >= 15 && !lz_put_length(dst, op, max, ml)) {
+        return 0;
+    } /* end if */
+    return 1;
+} /* end of lz_put_sequence */
+
+
+/* compress len bytes at src into dst, returns the compressed size or
+ * 0 if it would exceed max bytes
+ */
+uint32_t
+lz_compress(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t max)
+{
+    uint32_t ip = 0;
+    uint32_t anchor = 0;
+    uint32_t op = 0;
+
+    memset(lz_table, 0, sizeof(lz_table));
+
+    while(ip + LZ_MIN_MATCH <= len) {
+        uint32_t seq = lz_read32(src + ip);
+        uint32_t h = lz_hash(seq);
+        uint32_t ref = lz_table[h];
+        lz_table[h] = ip + 1;
+
+        if(ref == 0 || ip - (ref - 1) > LZ_MAX_OFFSET || lz_read32(src + ref - 1) != seq) {
+            ip++;
+            continue;
+        } /* end if */
+        ref--;
+
+        uint32_t match_len = LZ_MIN_MATCH;
+        while(ip + match_len < len && src[ref + match_len] == src[ip + match_len]) {
+            match_len++;
+        } /* end while */
+
+        if(!lz_put_sequence(dst, &op, max, src + anchor, ip - anchor, ip - ref, match_len)) {
+            return 0;
+        } /* end if */
+        ip += match_len;
+        anchor = ip;
+    } /* end while */
+
+    if(!lz_put_sequence(dst, &op, max, src + anchor, len - anchor, 0, 0)) {
+        return 0;
+    } /* end if */
+    return op;
+} /* end of lz_compress */
+
+
+/* decompress the stream src of len bytes into dst, returns the
+ * decompressed size or 0 if the stream is corrupt or exceeds max bytes
+ */
+uint32_t
+lz_decompress(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t max)
+{
+    uint32_t ip = 0;
+    uint32_t op = 0;
+
+    while(ip < len) {
+        uint32_t token = src[ip++];
+        uint32_t b;
+
+        uint32_t lit_len = token >> 4;
+        if(lit_len == 15) {
+            do {
+                if(ip >= len) {
+                    return 0;
+                } /* end if */
+                b = src[ip++];
+                lit_len += b;
+            } while(b == 255);
+        } /* end if */
+        if(ip + lit_len > len || op + lit_len > max) {
+            return 0;
+        } /* end if */
+        memcpy(dst + op, src + ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+        if(ip >= len) {
+            break;
+        } /* end if */
+
+        if(ip + 2 > len) {
+            return 0;
+        } /* end if */
+        uint32_t offset = src[ip] | (src[ip + 1] << 8);
+        ip += 2;
+        uint32_t match_len = token & 15;
+        if(match_len == 15) {
+            do {
+                if(ip >= len) {
+                    return 0;
+                } /* end if */
+                b = src[ip++];
+                match_len += b;
+            } while(b == 255);
+        } /* end if */
+        match_len += LZ_MIN_MATCH;
+        if(offset == 0 || offset > op || op + match_len > max) {
+            return 0;
+        } /* end if */
+        for(uint32_t i = 0; i < match_len; i++, op++) {
+            dst[op] = dst[op - offset];
+        } /* end for */
+    } /* end while */
+
+    return op;
+} /* end of lz_decompress */
+
+
+/* return how far above the start of its output the compressed stream
+ * src of len bytes has to be placed to be decoded in place: each byte
+ * written must lie below the next byte still to be read
+ */
+uint32_t
+lz_inplace_offset(const uint8_t *src, uint32_t len)
+{
+    uint32_t ip = 0;
+    uint32_t op = 0;
+    uint32_t offs = 0;
+
+    while(ip < len) {
+        uint32_t token = src[ip++];
+        uint32_t b;
+
+        uint32_t lit_len = token >> 4;
+        if(lit_len == 15) {
+            do {
+                b = src[ip++];
+                lit_len += b;
+            } while(b == 255 && ip < len);
+        } /* end if */
+
+        /* the last literal is written before its byte is read */
+        ip += lit_len;
+        op += lit_len;
+        if(op + 1 > ip && op + 1 - ip > offs) {
+            offs = op + 1 - ip;
+        } /* end if */
+        if(ip >= len) {
+            break;
+        } /* end if */
+
+        ip += 2;
+        uint32_t match_len = token & 15;
+        if(match_len == 15) {
+            do {
+                b = src[ip++];
+                match_len += b;
+            } while(b == 255 && ip < len);
+        } /* end if */
+
+        op += match_len + LZ_MIN_MATCH;
+        if(op > ip && op - ip > offs) {
+            offs = op - ip;
+        } /* end if */
+    } /* end while */
+
+    return (offs + LZ_INPLACE_ALIGN - 1) & ~(LZ_INPLACE_ALIGN - 1);
+} /* end of lz_inplace_offset */
@@ -0,0 +1,24 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Systemnahe Programmierung (SNP)
+ *
+ * lz.h - LZ compression of boot images
+ *
+ *===================================================================*/
+
+#ifndef _LZ_H
+#define _LZ_H           1
+
+#include <inttypes.h>
+
+#define LZ_MIN_MATCH                   4    // shortest match encoded
+#define LZ_HASH_BITS                  16    // size of the match finder table
+#define LZ_MAX_OFFSET             0xffff
+#define LZ_INPLACE_ALIGN              16    // alignment of the in-place offset
+
+extern uint32_t lz_compress(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t max);
+extern uint32_t lz_decompress(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t max);
+extern uint32_t lz_inplace_offset(const uint8_t *src, uint32_t len);
+
+#endif  /* _LZ_H */
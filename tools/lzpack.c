@@ -0,0 +1,102 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Systemnahe Programmierung (SNP)
+ *
+ * lzpack.c - Compress a kernel image for the boot loader
+ *
+ * The packed image starts with a header sector holding the signature
+ * 'DHBZ', the size of the image, the size of the compressed stream
+ * and the offset above the load address the boot loader reads the
+ * stream to, so it can be decompressed in place. The stream follows
+ * in the next sectors. Images which do not get smaller or which do
+ * not fit below the BIOS data area are copied unchanged.
+ *
+ *===================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "lz.h"
+
+
+#define SECTOR_SIZE                512
+#define LOAD_ADDR              0x10000      // program location of dasboot
+#define LOAD_END               0x9fc00      // start of extended BIOS data
+#define MAX_IMAGE_SIZE  (LOAD_END-LOAD_ADDR)
+
+
+typedef struct lz_header {
+    char          lh_sig[4];                      // offset  0  0x00
+    uint32_t      lh_size;                        //         4  0x04
+    uint32_t      lh_csize;                       //         8  0x08
+    uint32_t      lh_offset;                      //        12  0x0c
+    char          lh_spare[SECTOR_SIZE-16];       //        16  0x10
+} lz_header_t;
+
+
+static uint8_t image[MAX_IMAGE_SIZE];
+static uint8_t packed[MAX_IMAGE_SIZE];
+
+
+int
+main(int argc, char *argv[])
+{
+    FILE *fp;
+    size_t len;
+    uint32_t csize;
+    lz_header_t header;
+
+    if(argc != 3) {
+        fprintf(stderr, "Usage: lzpack image packedimage\n");
+        exit(EXIT_FAILURE);
+    } /* end if */
+
+    if((fp = fopen(argv[1], "rb")) == NULL) {
+        perror("fopen");
+        exit(EXIT_FAILURE);
+    } /* end if */
+    len = fread(image, 1, sizeof(image), fp);
+    if(!feof(fp)) {
+        fprintf(stderr, "ERROR: image %s larger than %d bytes\n", argv[1], MAX_IMAGE_SIZE);
+        fclose(fp);
+        exit(EXIT_FAILURE);
+    } /* end if */
+    fclose(fp);
+
+    memset(&header, 0, sizeof(header));
+    csize = lz_compress(image, len, packed, len);
+    if(csize > 0) {
+        /* the stream is read in whole sectors to a sector boundary */
+        uint32_t offset = lz_inplace_offset(packed, csize);
+        offset = (offset + SECTOR_SIZE - 1) & ~(SECTOR_SIZE - 1);
+        uint32_t end = LOAD_ADDR + offset + ((csize + SECTOR_SIZE - 1) & ~(SECTOR_SIZE - 1));
+        if((end <= LOAD_END) && (csize + SECTOR_SIZE < len)) {
+            memcpy(header.lh_sig, "DHBZ", 4);
+            header.lh_size = len;
+            header.lh_csize = csize;
+            header.lh_offset = offset;
+        } /* end if */
+    } /* end if */
+
+    if((fp = fopen(argv[2], "wb")) == NULL) {
+        perror("fopen");
+        exit(EXIT_FAILURE);
+    } /* end if */
+    if(header.lh_csize > 0) {
+        printf("%s: %zu -> %u bytes, stream at +0x%x\n", argv[1], len,
+               header.lh_csize, header.lh_offset);
+        fwrite(&header, sizeof(header), 1, fp);
+        fwrite(packed, 1, csize, fp);
+    } else {
+        printf("%s: %zu bytes, stored\n", argv[1], len);
+        fwrite(image, 1, len, fp);
+    } /* end if */
+    if(fclose(fp) != 0) {
+        perror("fclose");
+        exit(EXIT_FAILURE);
+    } /* end if */
+
+    exit(EXIT_SUCCESS);
+} /* end of main */
@@ -10,6 +10,14 @@
  *
  * $Id:$
  *
+ * Version 2 of the format stores the files at page aligned offsets,
+ * the first one at offset 0, followed by a page holding a hashed
+ * directory with a checksum for each file. The boot loader copies
+ * files and directory to 0x100000, so a file can be mapped into a
+ * page table without copying and looked up by name. The table of
+ * contents keeps the header of version 1 which the boot loader reads,
+ * version 1 images can still be listed.
+ *
  *===================================================================*/
 
 #include <stdio.h>
@@ -24,13 +32,21 @@
 #include <fcntl.h>
 #include <stdbool.h>
 #include <libgen.h>
+#include "lz.h"
 
 
-#define MAX_FILE_ENTRIES            16
-#define MAX_FILE_NAME               16
-#define RAM_DISK_SIZE       (1024*1024)     // 1 MB
-#define ADDR_ALIGN                  16
+#define MAX_FILE_ENTRIES            16      // version 1
+#define MAX_FILE_NAME               16      // version 1
+#define RAM_DISK_SIZE       (1024*1024)     // default capacity, 1 MB
 #define READ_BUFFER_SIZE          8192
+#define FL_COMPRESSED             0x01      // files are stored compressed
+
+#define RD_VERSION                   2
+#define RD_PAGE_SIZE              4096      // alignment of file extents
+#define RD_MAX_FILES                60
+#define RD_MAX_NAME                 32
+#define RD_HASH_SIZE                64      // directory hash buckets
+#define RD_NONE                 0xffff      // end of a hash chain
 
 
 typedef struct file_entry {
@@ -48,11 +64,41 @@ typedef struct file_list {
     uint32_t      fl_size;                        //        12  0x0c
     uint32_t      fl_mtime;                       //        16  0x10
     uint16_t      fl_start_sector;                //        20  0x14
-    char          fl_spare[10];                   //        22  0x16
-    file_entry_t  fl_files[MAX_FILE_ENTRIES];     //        32  0x20
+    uint8_t       fl_flags;                       //        22  0x16
+    uint8_t       fl_version;                     //        23  0x17
+    uint32_t      fl_csize;                       //        24  0x18
+    uint32_t      fl_coffs;                       //        28  0x1c
+    union {
+        file_entry_t  fl_files[MAX_FILE_ENTRIES]; //        32  0x20  version 1
+        struct {
+            uint32_t  fl_dir_offset;              //        32  0x20  version 2
+            uint32_t  fl_capacity;                //        36  0x24
+        };
+    };
 } file_list_t;
 
 
+typedef struct rd_entry {
+    char        re_name[RD_MAX_NAME];           // offset  0  0x00
+    uint32_t    re_addr;                        //        32  0x20
+    uint32_t    re_size;                        //        36  0x24
+    uint32_t    re_mtime;                       //        40  0x28
+    uint32_t    re_crc;                         //        44  0x2c
+    uint16_t    re_next;                        //        48  0x30
+    char        re_spare[14];                   //        50  0x32
+} rd_entry_t;
+
+
+typedef struct rd_dir {
+    char        rd_sig[8];                      // offset  0  0x00
+    uint32_t    rd_num;                         //         8  0x08
+    uint32_t    rd_hash_size;                   //        12  0x0c
+    uint16_t    rd_hash[RD_HASH_SIZE];          //        16  0x10
+    char        rd_spare[48];                   //       144  0x90
+    rd_entry_t  rd_files[RD_MAX_FILES];         //       192  0xc0
+} rd_dir_t;
+
+
 
 
 char *
@@ -73,7 +119,7 @@ map_file_to_memory(size_t *len, int fd, const char *file)
     /* map file specified by file descriptor fd into memory with read/write
      * access.
      */
-    addr = mmap(NULL, *len, PROT_WRITE, MAP_SHARED, fd, 0);
+    addr = mmap(NULL, *len, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
     if(addr == MAP_FAILED) {
         perror("mmap");
         return 0;
@@ -86,175 +132,418 @@ map_file_to_memory(size_t *len, int fd, const char *file)
 } /* end of map_file_to_memory */
 
 
-void
-copy_filename(file_entry_t *fep, char *file)
+uint32_t
+crc32(const uint8_t *buf, uint32_t len)
 {
-    size_t len;
-    char *s = basename(file);
+    uint32_t crc = 0xffffffff;
+
+    for(uint32_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for(int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+        } /* end for */
+    } /* end for */
 
-    memset(fep->fe_name, ' ', MAX_FILE_NAME);
-    len = strlen(s);
-    memcpy(fep->fe_name, s, (len < MAX_FILE_NAME) ? len : MAX_FILE_NAME);
-} /* end of copy_filename */
+    return ~crc;
+} /* end of crc32 */
 
 
 uint32_t
-read_file_to_buffer(file_entry_t *fep, char *file, char *addr, uint32_t offset)
+rd_hash(const char *name)
+{
+    uint32_t h = 2166136261U;
+
+    for(int i = 0; (i < RD_MAX_NAME) && (name[i] != '\0'); i++) {
+        h = (h ^ (uint8_t)name[i]) * 16777619U;
+    } /* end for */
+
+    return h % RD_HASH_SIZE;
+} /* end of rd_hash */
+
+
+/* look up name in the directory dp, returns the entry or NULL
+ */
+rd_entry_t *
+rd_lookup(rd_dir_t *dp, const char *name)
+{
+    uint16_t i = dp->rd_hash[rd_hash(name)];
+
+    while((i != RD_NONE) && (i < RD_MAX_FILES)) {
+        rd_entry_t *rep = &dp->rd_files[i];
+        if(strncmp(rep->re_name, name, RD_MAX_NAME) == 0) {
+            return rep;
+        } /* end if */
+        i = rep->re_next;
+    } /* end while */
+
+    return NULL;
+} /* end of rd_lookup */
+
+
+/* read file into the ramdisk at addr + offset and add it to the
+ * directory, returns false on error
+ */
+bool
+read_file_to_ramdisk(rd_dir_t *dp, char *file, char *addr,
+                     uint32_t offset, uint32_t capacity)
 {
     struct stat sb;
     int fd;
     char *ptr;
     ssize_t cc;
+    rd_entry_t *rep = &dp->rd_files[dp->rd_num];
+    char *s = basename(file);
 
     if((fd = open(file, O_RDONLY)) < 0) {
         perror("open");
-        return 0;
+        return false;
     } /* end if */
 
     if(fstat(fd, &sb) < 0) {
         perror("fstat");
         close(fd);
-        return 0;
+        return false;
+    } /* end if */
+    if((sb.st_size > capacity) || (offset > capacity - sb.st_size)) {
+        fprintf(stderr, "ERROR: file %s exceeds ramdisk capacity\n", file);
+        close(fd);
+        return false;
     } /* end if */
-    fep->fe_size = sb.st_size;
-    fep->fe_mtime = sb.st_mtime;
-    fep->fe_addr = offset;
-    copy_filename(fep, file);
+    if(rd_lookup(dp, s) != NULL) {
+        fprintf(stderr, "ERROR: duplicate file name %s\n", s);
+        close(fd);
+        return false;
+    } /* end if */
+
+    memset(rep, 0, sizeof(rd_entry_t));
+    strncpy(rep->re_name, s, RD_MAX_NAME);
+    rep->re_size = sb.st_size;
+    rep->re_mtime = sb.st_mtime;
+    rep->re_addr = offset;
 
     printf("   0x%06x  %6d (0x%06x)   %10d %s",
-           offset, fep->fe_size, fep->fe_size,
-           fep->fe_mtime, ctime((time_t *)&fep->fe_mtime));
+           offset, rep->re_size, rep->re_size,
+           rep->re_mtime, ctime((time_t *)&rep->re_mtime));
 
+    /* read the file straight into the mapped disk image */
     ptr = addr + offset;
     do {
         if((cc = read(fd, ptr, READ_BUFFER_SIZE)) < 0) {
             perror("read");
             close(fd);
-            return 0;
+            return false;
         } /* end if */
         ptr += cc;
     } while(cc > 0);
+    rep->re_crc = crc32((uint8_t *)addr + offset, rep->re_size);
 
-    offset = offset + sb.st_size;
-    if(offset & (ADDR_ALIGN-1)) {
-        offset = (offset & ~(ADDR_ALIGN-1)) + ADDR_ALIGN;
-    } /* end if */
+    uint32_t h = rd_hash(rep->re_name);
+    rep->re_next = dp->rd_hash[h];
+    dp->rd_hash[h] = dp->rd_num;
+    dp->rd_num++;
 
     if(close(fd) < 0) {
         perror("close");
-        return 0;
+        return false;
     } /* end if */
 
-    return offset;
-} /* end of read_file_to_buffer */
+    return true;
+} /* end of read_file_to_ramdisk */
+
+
+/* compress size bytes at addr in place, returns false if the data
+ * does not get smaller
+ */
+bool
+compress_ramdisk(file_list_t *flp, char *addr, uint32_t size)
+{
+    uint8_t *cbuf;
+    uint32_t csize;
+
+    if((cbuf = malloc(size)) == NULL) {
+        perror("malloc");
+        return false;
+    } /* end if */
+
+    csize = lz_compress((uint8_t *)addr, size, cbuf, size);
+    if(csize > 0) {
+        flp->fl_flags |= FL_COMPRESSED;
+        flp->fl_csize = csize;
+        flp->fl_coffs = lz_inplace_offset(cbuf, csize);
+        memcpy(addr, cbuf, csize);
+        memset(addr + csize, 0, size - csize);
+        printf("compressed size: %d (0x%x) bytes, offset 0x%x\n",
+               csize, csize, flp->fl_coffs);
+    } /* end if */
+
+    free(cbuf);
+    return csize > 0;
+} /* end of compress_ramdisk */
 
 
 int
-main(int argc, char *argv[])
+write_ramdisk(char *img_addr, size_t img_len, int toc, int pos,
+              uint32_t capacity, bool compress, int nfiles, char *files[])
 {
-    char *buf;
-    char *img_addr;
+    file_list_t file_list;
+    rd_dir_t *dp;
     uint32_t addr_offset;
-    int fd;
-    uint32_t fe_index;
+    size_t img_toc_offs = (size_t)toc << 9;
+    size_t img_start_offs = (size_t)pos << 9;
+    char *addr = img_addr + img_start_offs;
+
+    if((img_toc_offs+sizeof(file_list) > img_len) ||
+       (img_start_offs >= img_len)) {
+        fprintf(stderr, "ERROR: attempt to write TOC/files outside disk image\n");
+        return EXIT_FAILURE;
+    } /* end if */
+    if(capacity > img_len - img_start_offs) {
+        capacity = img_len - img_start_offs;
+    } /* end if */
+    if((img_start_offs < img_toc_offs) && (capacity > img_toc_offs - img_start_offs)) {
+        capacity = img_toc_offs - img_start_offs;
+    } /* end if */
+    if(nfiles > RD_MAX_FILES) {
+        fprintf(stderr, "ERROR: more than %d files\n", RD_MAX_FILES);
+        return EXIT_FAILURE;
+    } /* end if */
+
+    if((dp = calloc(1, sizeof(rd_dir_t))) == NULL) {
+        perror("calloc");
+        return EXIT_FAILURE;
+    } /* end if */
+    memcpy(dp->rd_sig, "RDDIR2  ", 8);
+    dp->rd_hash_size = RD_HASH_SIZE;
+    memset(dp->rd_hash, 0xff, sizeof(dp->rd_hash));
+
+    addr_offset = 0;
+    for(int i = 0; i < nfiles; i++) {
+        printf("%2d %s:\n", dp->rd_num, files[i]);
+        if(!read_file_to_ramdisk(dp, files[i], addr, addr_offset, capacity)) {
+            free(dp);
+            return EXIT_FAILURE;
+        } /* end if */
+        addr_offset += dp->rd_files[i].re_size;
+        addr_offset = (addr_offset + RD_PAGE_SIZE-1) & ~(RD_PAGE_SIZE-1);
+    } /* end for */
+
+    if(addr_offset + RD_PAGE_SIZE > capacity) {
+        fprintf(stderr, "ERROR: files exceed ramdisk capacity of %d bytes\n", capacity);
+        free(dp);
+        return EXIT_FAILURE;
+    } /* end if */
+    memset(addr + addr_offset, 0, RD_PAGE_SIZE);
+    memcpy(addr + addr_offset, dp, sizeof(rd_dir_t));
+    printf("%d file entries x %zd bytes, of which %d entries are used\n",
+           RD_MAX_FILES, sizeof(rd_entry_t), dp->rd_num);
+    printf("total size: %d (0x%x) bytes\n", addr_offset + RD_PAGE_SIZE,
+           addr_offset + RD_PAGE_SIZE);
+
+    memset(&file_list, 0, sizeof(file_list));
+    memcpy(file_list.fl_sig, "RAMDISK ", 8);
+    file_list.fl_num = dp->rd_num;
+    file_list.fl_size = addr_offset + RD_PAGE_SIZE;
+    file_list.fl_mtime = (uint32_t)time(NULL);
+    file_list.fl_start_sector = (uint16_t)pos;
+    file_list.fl_version = RD_VERSION;
+    file_list.fl_dir_offset = addr_offset;
+    file_list.fl_capacity = capacity;
+    if(compress) {
+        compress_ramdisk(&file_list, addr, file_list.fl_size);
+    } /* end if */
+    memcpy(img_addr+img_toc_offs, &file_list, sizeof(file_list));
+
+    free(dp);
+    return EXIT_SUCCESS;
+} /* end of write_ramdisk */
+
+
+void
+print_entry(const char *name, uint32_t addr, uint32_t size, uint32_t mtime)
+{
+    time_t t = mtime;
+
+    printf("  %-*.*s  0x%06x  %6d (0x%06x)   %10d %s",
+           RD_MAX_NAME, RD_MAX_NAME, name, addr, size, size, mtime, ctime(&t));
+} /* end of print_entry */
+
+
+/* return the data of the ramdisk described by flp, decompressed into
+ * a buffer to free by the caller if it is stored compressed
+ */
+char *
+ramdisk_data(file_list_t *flp, char *img_addr, size_t img_len, char **buf)
+{
+    size_t img_start_offs = (size_t)flp->fl_start_sector << 9;
+    uint32_t size = (flp->fl_flags & FL_COMPRESSED) ? flp->fl_csize : flp->fl_size;
+
+    *buf = NULL;
+    if((img_start_offs > img_len) || (size > img_len - img_start_offs)) {
+        fprintf(stderr, "ERROR: ramdisk outside disk image\n");
+        return NULL;
+    } /* end if */
+    if((flp->fl_flags & FL_COMPRESSED) == 0) {
+        return img_addr + img_start_offs;
+    } /* end if */
+
+    if((*buf = malloc(flp->fl_size)) == NULL) {
+        perror("malloc");
+        return NULL;
+    } /* end if */
+    if(lz_decompress((uint8_t *)img_addr + img_start_offs, size,
+                     (uint8_t *)*buf, flp->fl_size) != flp->fl_size) {
+        fprintf(stderr, "ERROR: corrupt compressed ramdisk\n");
+        free(*buf);
+        *buf = NULL;
+    } /* end if */
+    return *buf;
+} /* end of ramdisk_data */
+
+
+int
+list_ramdisk(char *img_addr, size_t img_len, int toc, const char *name)
+{
+    size_t img_toc_offs = (size_t)toc << 9;
+    file_list_t *flp = (file_list_t *)(img_addr+img_toc_offs);
+    char sig_str[9];
+    char *data, *buf;
     int status = EXIT_SUCCESS;
-    bool file_error;
-    file_list_t file_list;
 
-    if((argc > 4) && (argc < (MAX_FILE_ENTRIES+4))) {
-        if((fd = open(argv[1], O_RDWR)) < 0) {
-            perror("open");
-            status = EXIT_FAILURE;
-        } else {
-            if((buf = malloc(RAM_DISK_SIZE)) == NULL) {
-                // TODO: error handling
-            } /* end if */
-            memset(buf, 0, RAM_DISK_SIZE);
-
-            fe_index = 0;
-            file_error = false;
-            addr_offset = 0;
-            for(int i = 4; i < argc; i++) {
-                printf("%2d %s:\n", fe_index, argv[i]);
-                addr_offset = read_file_to_buffer(&file_list.fl_files[fe_index],
-                                                  argv[i], buf, addr_offset);
-                file_error = (addr_offset == 0);
-                if(file_error == true) {
-                    break;
-                } /* end if */
-                fe_index++;
+    if(img_toc_offs+sizeof(file_list_t) > img_len) {
+        fprintf(stderr, "ERROR: TOC outside disk image\n");
+        return EXIT_FAILURE;
+    } /* end if */
+
+    memcpy(sig_str, flp->fl_sig, 8);
+    sig_str[8] = '\0';
+    printf("signature: '%s'\n", sig_str);
+    printf("start sector: %d\n", flp->fl_start_sector);
+    if(flp->fl_flags & FL_COMPRESSED) {
+        printf("compressed: %d of %d bytes, offset 0x%x\n",
+               flp->fl_csize, flp->fl_size, flp->fl_coffs);
+    } /* end if */
+
+    if(flp->fl_version != RD_VERSION) {
+        /* version 1, the file entries follow the header */
+        if(flp->fl_num <= MAX_FILE_ENTRIES) {
+            file_entry_t *fep;
+            for(int i = 0; i < flp->fl_num; i++) {
+                fep = &flp->fl_files[i];
+                char fname[MAX_FILE_NAME+1];
+                memcpy(fname, fep->fe_name, MAX_FILE_NAME);
+                fname[MAX_FILE_NAME] = '\0';
+                print_entry(fname, fep->fe_addr, fep->fe_size, fep->fe_mtime);
             } /* end for */
-            printf("total size: %d (0x%x) bytes\n", addr_offset, addr_offset);
-
-            if(!file_error && (addr_offset <= RAM_DISK_SIZE)) {
-                size_t img_len;
-                if((img_addr = map_file_to_memory(&img_len, fd, argv[1])) != NULL) {
-                    printf("%d file entries x %zd bytes, " \
-                           "of which %d entries are used\n",
-                           MAX_FILE_ENTRIES, sizeof(file_entry_t), fe_index);
-                    memcpy(file_list.fl_sig, "RAMDISK ", 8);
-                    file_list.fl_num = fe_index;
-                    file_list.fl_size = addr_offset;
-                    file_list.fl_mtime = (uint32_t)time(NULL);
-                    file_list.fl_start_sector = (uint16_t)atoi(argv[3]);
-
-                    int img_toc_offs = atoi(argv[2]) << 9;
-                    int img_start_offs = file_list.fl_start_sector << 9;
-                    if((img_toc_offs+sizeof(file_list) <= img_len) &&
-                       (img_start_offs+addr_offset <= img_len)) {
-                        memcpy(img_addr+img_toc_offs, &file_list, sizeof(file_list));
-                        memcpy(img_addr+img_start_offs, buf, addr_offset);
-                    } else {
-                        fprintf(stderr, "ERROR: attempt to write TOC/files outside disk image\n");
-                        status = EXIT_FAILURE;
-                    } /* end if */
-                } /* end if */
-            } else {
-                // TODO: error handling
-            } /* end if */
-
-            if(close(fd) < 0) {
-                perror("close");
-                status = EXIT_FAILURE;
-            } /* end if */
-
-            free(buf);
         } /* end if */
-    } else if(argc == 3) {
-        if((fd = open(argv[1], O_RDWR)) < 0) {
-            perror("open");
+        return status;
+    } /* end if */
+
+    printf("version: %d, capacity: %d bytes\n", flp->fl_version, flp->fl_capacity);
+    if((data = ramdisk_data(flp, img_addr, img_len, &buf)) == NULL) {
+        return EXIT_FAILURE;
+    } /* end if */
+    if(flp->fl_dir_offset + sizeof(rd_dir_t) > flp->fl_size) {
+        fprintf(stderr, "ERROR: directory outside ramdisk\n");
+        free(buf);
+        return EXIT_FAILURE;
+    } /* end if */
+
+    rd_dir_t *dp = (rd_dir_t *)(data + flp->fl_dir_offset);
+    if(name != NULL) {
+        rd_entry_t *rep = rd_lookup(dp, name);
+        if(rep == NULL) {
+            fprintf(stderr, "%s: not found\n", name);
             status = EXIT_FAILURE;
         } else {
-            size_t img_len;
-            if((img_addr = map_file_to_memory(&img_len, fd, argv[1])) != NULL) {
-                int img_toc_offs = atoi(argv[2]) << 9;
-                file_list_t *flp = (file_list_t *)(img_addr+img_toc_offs);
-                char sig_str[9];
-                memcpy(sig_str, flp->fl_sig, 8);
-                sig_str[8] = '\0';
-                printf("signature: '%s'\n", sig_str);
-                printf("start sector: %d\n", flp->fl_start_sector);
-                if(flp->fl_num <= MAX_FILE_ENTRIES) {
-                    file_entry_t *fep;
-                    for(int i = 0; i < flp->fl_num; i++) {
-                        fep = &flp->fl_files[i];
-                        char name[MAX_FILE_NAME+1];
-                        memcpy(name, fep->fe_name, MAX_FILE_NAME);
-                        name[MAX_FILE_NAME] = '\0';
-                        printf("  %s  0x%06x  %6d (0x%06x)   %10d %s",
-                               name, fep->fe_addr, fep->fe_size, fep->fe_size,
-                               fep->fe_mtime, ctime((time_t *)&fep->fe_mtime));
-                    } /* end for */
-                } /* end if */
-            } /* end if */
+            print_entry(rep->re_name, rep->re_addr, rep->re_size, rep->re_mtime);
+        } /* end if */
+        free(buf);
+        return status;
+    } /* end if */
+
+    for(uint32_t i = 0; (i < dp->rd_num) && (i < RD_MAX_FILES); i++) {
+        rd_entry_t *rep = &dp->rd_files[i];
+        bool ok = (rep->re_addr < flp->fl_dir_offset) &&
+                  (rep->re_size <= flp->fl_dir_offset - rep->re_addr) &&
+                  (crc32((uint8_t *)data + rep->re_addr, rep->re_size) == rep->re_crc);
+        print_entry(rep->re_name, rep->re_addr, rep->re_size, rep->re_mtime);
+        printf("    crc32 0x%08x %s\n", rep->re_crc, ok ? "ok" : "BAD");
+        if(!ok) {
+            status = EXIT_FAILURE;
         } /* end if */
+    } /* end for */
+
+    free(buf);
+    return status;
+} /* end of list_ramdisk */
+
+
+void
+usage(void)
+{
+    fprintf(stderr, "Usage: ramdisk [-z] [-s kbytes] diskimage toc pos file1 file2...\n");
+    fprintf(stderr, "       ramdisk diskimage toc [name]\n");
+    fprintf(stderr, "Note: The maximum number of files is %d\n", RD_MAX_FILES);
+} /* end of usage */
+
+
+int
+main(int argc, char *argv[])
+{
+    char *img_addr;
+    size_t img_len;
+    int fd;
+    int opt;
+    int status = EXIT_SUCCESS;
+    bool compress = false;
+    uint32_t capacity = RAM_DISK_SIZE;
+
+    /* -z stores the files compressed, the boot loader decompresses
+     * them in place, -s sets the capacity of the ramdisk in kbytes
+     */
+    while((opt = getopt(argc, argv, "zs:")) != -1) {
+        switch(opt) {
+            case 'z':
+                compress = true;
+                break;
+            case 's':
+                capacity = strtoul(optarg, NULL, 0) << 10;
+                break;
+            default:
+                usage();
+                exit(EXIT_FAILURE);
+        } /* end switch */
+    } /* end while */
+    argc -= optind - 1;
+    argv += optind - 1;
+
+    if((argc < 3) || (argc == 4 && compress)) {
+        usage();
+        exit(EXIT_FAILURE);
+    } /* end if */
+
+    if((fd = open(argv[1], O_RDWR)) < 0) {
+        perror("open");
+        exit(EXIT_FAILURE);
+    } /* end if */
+
+    if((img_addr = map_file_to_memory(&img_len, fd, argv[1])) == NULL) {
+        status = EXIT_FAILURE;
+    } else if(argc > 4) {
+        status = write_ramdisk(img_addr, img_len, atoi(argv[2]), atoi(argv[3]),
+                               capacity, compress, argc-4, &argv[4]);
     } else {
-        fprintf(stderr, "Usage: ramdisk diskimage toc pos file1 file2...\n");
-        fprintf(stderr, "Note: The maximum number of files is %d\n", MAX_FILE_ENTRIES);
+        status = list_ramdisk(img_addr, img_len, atoi(argv[2]),
+                              (argc == 4) ? argv[3] : NULL);
+    } /* end if */
+
+    if(img_addr != NULL) {
+        munmap(img_addr, img_len);
+    } /* end if */
+    if(close(fd) < 0) {
+        perror("close");
         status = EXIT_FAILURE;
     } /* end if */
 
     exit(status);
 } /* end of main */
-
-